@@ -0,0 +1,355 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "bench.h"
+#include "grammar.h"
+
+#define DEFAULT_MIN_TIME_MS 200
+#define DEFAULT_WIDTH 3
+#define DEFAULT_DEPTH 2
+#define N_LINES 1024
+#define MAX_SIZES 16
+
+static TAILQ_HEAD(, bench) bench_list = TAILQ_HEAD_INITIALIZER(bench_list);
+
+void bench_register(struct bench *bench)
+{
+	TAILQ_INSERT_TAIL(&bench_list, bench, next);
+}
+
+/*
+ * Count the allocations by replacing the glibc allocator with wrappers.
+ * This is not possible with the sanitizers, which replace it too.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define BENCH_SANITIZER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BENCH_SANITIZER
+#endif
+#endif
+
+static size_t bench_allocs;
+
+#if defined(__GLIBC__) && !defined(BENCH_SANITIZER)
+#define BENCH_COUNT_ALLOCS
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+	bench_allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	bench_allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	bench_allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+	__libc_free(ptr);
+}
+#endif
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* xorshift64, to get the same lines at each run */
+static uint64_t rand_next(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+
+	return x;
+}
+
+static void free_lines(const char **lines, size_t n)
+{
+	size_t i;
+
+	if (lines == NULL)
+		return;
+	for (i = 0; i < n; i++)
+		free((char *)lines[i]);
+	free(lines);
+}
+
+static void bench_ctx_free(struct bench_ctx *ctx)
+{
+	ec_node_free(ctx->grammar);
+	free_lines(ctx->lines, ctx->n_lines);
+	free_lines(ctx->partial_lines, ctx->n_lines);
+	free_lines(ctx->invalid_lines, ctx->n_lines);
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+/*
+ * The partial line stops at the first letter of the second token, and
+ * the last token of the invalid line is replaced.
+ */
+static int bench_lines(struct bench_ctx *ctx, size_t i, const char *sample)
+{
+	const char *sp;
+	char *line;
+	int len;
+
+	line = strdup(sample);
+	if (line == NULL)
+		return -1;
+	ctx->lines[i] = line;
+
+	sp = strchr(sample, ' ');
+	len = sp == NULL ? (int)strlen(sample) : (int)(sp - sample) + 2;
+	if (asprintf(&line, "%.*s", len, sample) < 0)
+		return -1;
+	ctx->partial_lines[i] = line;
+
+	sp = strrchr(sample, ' ');
+	len = sp == NULL ? (int)strlen(sample) : (int)(sp - sample);
+	if (asprintf(&line, "%.*s invalid", len, sample) < 0)
+		return -1;
+	ctx->invalid_lines[i] = line;
+
+	return 0;
+}
+
+static int bench_ctx_init(struct bench_ctx *ctx, const struct ec_test_grammar_params *params)
+{
+	struct ec_strvec *samples = NULL;
+	struct ec_node *cmdlist;
+	uint64_t state = 42;
+	size_t i, n;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->size = params->n_cmds;
+	ctx->n_lines = N_LINES;
+
+	samples = ec_strvec();
+	if (samples == NULL)
+		goto fail;
+	cmdlist = ec_test_grammar(params, samples);
+	if (cmdlist == NULL)
+		goto fail;
+	ctx->grammar = ec_node_sh_lex(EC_NO_ID, cmdlist);
+	ctx->lines = calloc(N_LINES, sizeof(*ctx->lines));
+	ctx->partial_lines = calloc(N_LINES, sizeof(*ctx->partial_lines));
+	ctx->invalid_lines = calloc(N_LINES, sizeof(*ctx->invalid_lines));
+	if (ctx->grammar == NULL || ctx->lines == NULL || ctx->partial_lines == NULL
+	    || ctx->invalid_lines == NULL)
+		goto fail;
+
+	for (i = 0; i < N_LINES; i++) {
+		n = rand_next(&state) % ec_strvec_len(samples);
+		if (bench_lines(ctx, i, ec_strvec_val(samples, n)) < 0)
+			goto fail;
+	}
+
+	ec_strvec_free(samples);
+
+	return 0;
+
+fail:
+	ec_strvec_free(samples);
+	bench_ctx_free(ctx);
+	return -1;
+}
+
+static bool bench_selected(const struct bench *bench, int argc, char **argv)
+{
+	int i;
+
+	if (argc == 0)
+		return true;
+	for (i = 0; i < argc; i++) {
+		if (strstr(bench->name, argv[i]) != NULL)
+			return true;
+	}
+
+	return false;
+}
+
+static int bench_run(struct bench *bench, struct bench_ctx *ctx, uint64_t min_ns)
+{
+	uint64_t start, elapsed;
+	struct rusage ru;
+	size_t allocs;
+	size_t ops;
+
+	if (bench->init != NULL && bench->init(ctx) < 0) {
+		fprintf(stderr, "%s: init failed: %s\n", bench->name, strerror(errno));
+		return -1;
+	}
+
+	/* the first operation may fill caches, do not measure it */
+	if (bench->run(ctx, 0) < 0)
+		goto fail;
+
+	allocs = bench_allocs;
+	start = now_ns();
+	ops = 0;
+	do {
+		if (bench->run(ctx, ops + 1) < 0)
+			goto fail;
+		ops++;
+		elapsed = now_ns() - start;
+	} while (elapsed < min_ns);
+	allocs = bench_allocs - allocs;
+
+	if (bench->exit != NULL)
+		bench->exit(ctx);
+
+	getrusage(RUSAGE_SELF, &ru);
+	printf("%-24s %8zu %10zu %14.1f", bench->name, ctx->size, ops, (double)elapsed / ops);
+#ifdef BENCH_COUNT_ALLOCS
+	printf(" %12.1f", (double)allocs / ops);
+#else
+	printf(" %12s", "-");
+#endif
+	printf(" %12ld\n", ru.ru_maxrss);
+	fflush(stdout);
+
+	return 0;
+
+fail:
+	fprintf(stderr, "%s: run failed: %s\n", bench->name, strerror(errno));
+	if (bench->exit != NULL)
+		bench->exit(ctx);
+	return -1;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-s SIZE]... [-w WIDTH] [-d DEPTH] [-t MS] [NAME]...\n", prog);
+	printf("Run the benchmarks whose name contains one of the NAME arguments.\n");
+	printf("  -s SIZE   Number of commands of the grammar (default: 100, 1000,\n");
+	printf("            10000 and 100000). Can be given several times.\n");
+	printf("  -w WIDTH  Maximum number of alternatives or options in a\n");
+	printf("            command (default: %d).\n", DEFAULT_WIDTH);
+	printf("  -d DEPTH  Maximum nesting depth of a command (default: %d).\n",
+	       DEFAULT_DEPTH);
+	printf("  -t MS     Minimal duration of each benchmark (default: %d).\n",
+	       DEFAULT_MIN_TIME_MS);
+}
+
+int main(int argc, char **argv)
+{
+	struct ec_test_grammar_params params = {
+		.seed = 42,
+		.width = DEFAULT_WIDTH,
+		.depth = DEFAULT_DEPTH,
+		.flags = EC_TEST_GRAMMAR_CMD,
+	};
+	size_t sizes[MAX_SIZES] = {100, 1000, 10000, 100000};
+	uint64_t min_ns = DEFAULT_MIN_TIME_MS * 1000000ULL;
+	size_t n_sizes = 4, i;
+	struct bench_ctx ctx;
+	struct bench *bench;
+	bool user_sizes = false;
+	int ret = 0, opt;
+
+	while ((opt = getopt(argc, argv, "hs:w:d:t:")) != -1) {
+		switch (opt) {
+		case 's':
+			if (!user_sizes) {
+				user_sizes = true;
+				n_sizes = 0;
+			}
+			if (n_sizes == MAX_SIZES || atol(optarg) <= 0) {
+				usage(argv[0]);
+				return 1;
+			}
+			sizes[n_sizes++] = atol(optarg);
+			break;
+		case 'w':
+			if (atoi(optarg) <= 0) {
+				usage(argv[0]);
+				return 1;
+			}
+			params.width = atoi(optarg);
+			break;
+		case 'd':
+			params.depth = atoi(optarg);
+			break;
+		case 't':
+			min_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (ec_init() < 0) {
+		fprintf(stderr, "cannot init ecoli: %s\n", strerror(errno));
+		return 1;
+	}
+
+	printf("%-24s %8s %10s %14s %12s %12s\n",
+	       "name",
+	       "size",
+	       "ops",
+	       "ns/op",
+	       "allocs/op",
+	       "maxrss_kb");
+
+	for (i = 0; i < n_sizes; i++) {
+		params.n_cmds = sizes[i];
+		if (bench_ctx_init(&ctx, &params) < 0) {
+			fprintf(stderr, "cannot build grammar: %s\n", strerror(errno));
+			ret = 1;
+			break;
+		}
+
+		TAILQ_FOREACH (bench, &bench_list, next) {
+			if (!bench_selected(bench, argc - optind, argv + optind))
+				continue;
+			if (bench->max_size != 0 && ctx.size > bench->max_size) {
+				printf("%-24s %8zu %10s\n", bench->name, ctx.size, "skipped");
+				continue;
+			}
+			if (bench_run(bench, &ctx, min_ns) < 0)
+				ret = 1;
+		}
+
+		bench_ctx_free(&ctx);
+	}
+
+	ec_exit();
+
+	return ret;
+}
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+/**
+ * @defgroup ecoli_bench Benchmarks
+ * @{
+ *
+ * @brief Helpers for microbenchmarks
+ *
+ * Each benchmark runs one operation in a loop, on a grammar whose size
+ * is given on the command line. The harness reports the time and the
+ * number of allocations per operation, and the peak RSS of the process.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/queue.h>
+
+#include <ecoli.h>
+
+/**
+ * The context passed to the benchmark callbacks.
+ */
+struct bench_ctx {
+	size_t size; /**< Number of commands of the grammar. */
+	/** The grammar: a sh_lex node whose child is an or of all commands. */
+	struct ec_node *grammar;
+	const char **lines; /**< Valid command lines, in pseudo-random order. */
+	const char **partial_lines; /**< Lines to complete, in pseudo-random order. */
+	const char **invalid_lines; /**< Lines that do not match, in pseudo-random order. */
+	size_t n_lines; /**< Number of elements in the line arrays. */
+	void *priv; /**< Private data of the benchmark. */
+};
+
+/**
+ * A benchmark.
+ */
+struct bench {
+	TAILQ_ENTRY(bench) next; /**< Next in list. */
+	const char *name; /**< Benchmark name, used to filter them. */
+	/** Prepare the benchmark (optional), return -1 on error. */
+	int (*init)(struct bench_ctx *ctx);
+	/** Run the i-th operation, return -1 on error. */
+	int (*run)(struct bench_ctx *ctx, size_t i);
+	/** Free the resources allocated by init (optional). */
+	void (*exit)(struct bench_ctx *ctx);
+	/** Largest grammar size the benchmark is run on, 0 for no limit. */
+	size_t max_size;
+};
+
+/**
+ * Register a benchmark.
+ *
+ * @param bench
+ *   The benchmark to register.
+ */
+void bench_register(struct bench *bench);
+
+/**
+ * Register a benchmark at startup.
+ *
+ * @param bench
+ *   The struct bench to register.
+ */
+#define BENCH_REGISTER(bench)                                                                      \
+	static void bench_init_##bench(void);                                                      \
+	static void __attribute__((constructor, used)) bench_init_##bench(void)                    \
+	{                                                                                          \
+		bench_register(&bench);                                                            \
+	}
+
+/**
+ * Get the i-th line of an array of the context, wrapping around.
+ */
+#define BENCH_LINE(ctx, array, i) ((ctx)->array[(i) % (ctx)->n_lines])
+
+/** @} */
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/* the tables contain one entry per command, keyed by the command name */
+struct table_priv {
+	struct ec_htable *htable;
+	struct ec_dict *dict;
+	char **keys;
+	size_t n_keys;
+};
+
+static int key_index(const struct bench_ctx *ctx, size_t i)
+{
+	return (i * 2654435761u) % ctx->size;
+}
+
+static void table_exit(struct bench_ctx *ctx)
+{
+	struct table_priv *priv = ctx->priv;
+	size_t i;
+
+	if (priv == NULL)
+		return;
+
+	ec_htable_free(priv->htable);
+	ec_dict_free(priv->dict);
+	for (i = 0; i < priv->n_keys; i++)
+		free(priv->keys[i]);
+	free(priv->keys);
+	free(priv);
+	ctx->priv = NULL;
+}
+
+static int table_init(struct bench_ctx *ctx)
+{
+	struct table_priv *priv;
+	size_t i;
+
+	priv = calloc(1, sizeof(*priv));
+	if (priv == NULL)
+		return -1;
+	ctx->priv = priv;
+
+	priv->htable = ec_htable();
+	priv->dict = ec_dict();
+	priv->keys = calloc(ctx->size, sizeof(*priv->keys));
+	if (priv->htable == NULL || priv->dict == NULL || priv->keys == NULL)
+		goto fail;
+
+	for (i = 0; i < ctx->size; i++) {
+		if (asprintf(&priv->keys[i], "cmd%zu", i) < 0)
+			goto fail;
+		priv->n_keys++;
+		if (ec_htable_set(priv->htable, priv->keys[i], strlen(priv->keys[i]), NULL, NULL)
+		    < 0)
+			goto fail;
+		if (ec_dict_set(priv->dict, priv->keys[i], NULL, NULL) < 0)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	table_exit(ctx);
+	return -1;
+}
+
+static int htable_get_run(struct bench_ctx *ctx, size_t i)
+{
+	struct table_priv *priv = ctx->priv;
+	const char *key = priv->keys[key_index(ctx, i)];
+
+	if (!ec_htable_has_key(priv->htable, key, strlen(key)))
+		return -1;
+
+	return 0;
+}
+
+static struct bench htable_get_bench = {
+	.name = "htable_get",
+	.init = table_init,
+	.run = htable_get_run,
+	.exit = table_exit,
+};
+
+BENCH_REGISTER(htable_get_bench);
+
+static int htable_set_del_run(struct bench_ctx *ctx, size_t i)
+{
+	struct table_priv *priv = ctx->priv;
+	char key[32];
+
+	snprintf(key, sizeof(key), "new%zu", i);
+	if (ec_htable_set(priv->htable, key, strlen(key), NULL, NULL) < 0)
+		return -1;
+	if (ec_htable_del(priv->htable, key, strlen(key)) < 0)
+		return -1;
+
+	return 0;
+}
+
+static struct bench htable_set_del_bench = {
+	.name = "htable_set_del",
+	.init = table_init,
+	.run = htable_set_del_run,
+	.exit = table_exit,
+};
+
+BENCH_REGISTER(htable_set_del_bench);
+
+static int dict_get_run(struct bench_ctx *ctx, size_t i)
+{
+	struct table_priv *priv = ctx->priv;
+
+	if (!ec_dict_has_key(priv->dict, priv->keys[key_index(ctx, i)]))
+		return -1;
+
+	return 0;
+}
+
+static struct bench dict_get_bench = {
+	.name = "dict_get",
+	.init = table_init,
+	.run = dict_get_run,
+	.exit = table_exit,
+};
+
+BENCH_REGISTER(dict_get_bench);
+
+static int dict_set_run(struct bench_ctx *ctx, size_t i)
+{
+	struct table_priv *priv = ctx->priv;
+
+	return ec_dict_set(priv->dict, priv->keys[key_index(ctx, i)], NULL, NULL);
+}
+
+static struct bench dict_set_bench = {
+	.name = "dict_set",
+	.init = table_init,
+	.run = dict_set_run,
+	.exit = table_exit,
+};
+
+BENCH_REGISTER(dict_set_bench);
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include "bench.h"
+
+static int interact_helps_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_interact_help *helps;
+	ssize_t n;
+
+	n = ec_interact_get_helps(ctx->grammar, BENCH_LINE(ctx, partial_lines, i), &helps);
+	if (n < 0)
+		return -1;
+	ec_interact_free_helps(helps, n);
+
+	return 0;
+}
+
+static struct bench interact_helps_bench = {
+	.name = "interact_helps",
+	.run = interact_helps_run,
+};
+
+BENCH_REGISTER(interact_helps_bench);
+
+static int interact_error_helps_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_interact_help *helps;
+	size_t char_idx;
+	ssize_t n;
+
+	n = ec_interact_get_error_helps(
+		ctx->grammar, BENCH_LINE(ctx, invalid_lines, i), &helps, &char_idx
+	);
+	if (n < 0)
+		return -1;
+	ec_interact_free_helps(helps, n);
+
+	return 0;
+}
+
+static struct bench interact_error_helps_bench = {
+	.name = "interact_error_helps",
+	.run = interact_error_helps_run,
+};
+
+BENCH_REGISTER(interact_error_helps_bench);
@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+static int parse_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_pnode *p;
+
+	p = ec_parse(ctx->grammar, BENCH_LINE(ctx, lines, i));
+	if (p == NULL)
+		return -1;
+	ec_pnode_free(p);
+
+	return 0;
+}
+
+static struct bench parse_bench = {
+	.name = "parse",
+	.run = parse_run,
+};
+
+BENCH_REGISTER(parse_bench);
+
+static int parse_matches_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_strvec *vec;
+	int ret;
+
+	vec = EC_STRVEC(BENCH_LINE(ctx, lines, i));
+	if (vec == NULL)
+		return -1;
+	ret = ec_parse_matches(ctx->grammar, vec);
+	ec_strvec_free(vec);
+
+	return ret < 0 ? -1 : 0;
+}
+
+static struct bench parse_matches_bench = {
+	.name = "parse_matches",
+	.run = parse_matches_run,
+};
+
+BENCH_REGISTER(parse_matches_bench);
+
+static int complete_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_comp *comp;
+
+	comp = ec_complete(ctx->grammar, BENCH_LINE(ctx, partial_lines, i));
+	if (comp == NULL)
+		return -1;
+	ec_comp_free(comp);
+
+	return 0;
+}
+
+static struct bench complete_bench = {
+	.name = "complete",
+	.run = complete_run,
+};
+
+BENCH_REGISTER(complete_bench);
+
+static int parse_memo_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_strvec *vec;
+	struct ec_pnode *p;
+
+	vec = EC_STRVEC(BENCH_LINE(ctx, lines, i));
+	if (vec == NULL)
+		return -1;
+	p = ec_parse_strvec_flags(ctx->grammar, vec, EC_PARSE_MEMO);
+	ec_strvec_free(vec);
+	if (p == NULL)
+		return -1;
+	ec_pnode_free(p);
+
+	return 0;
+}
+
+static struct bench parse_memo_bench = {
+	.name = "parse_memo",
+	.run = parse_memo_run,
+};
+
+BENCH_REGISTER(parse_memo_bench);
+
+static int complete_memo_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_strvec *vec;
+	struct ec_comp *comp;
+
+	vec = EC_STRVEC(BENCH_LINE(ctx, partial_lines, i));
+	if (vec == NULL)
+		return -1;
+	comp = ec_complete_strvec_flags(ctx->grammar, vec, EC_PARSE_MEMO);
+	ec_strvec_free(vec);
+	if (comp == NULL)
+		return -1;
+	ec_comp_free(comp);
+
+	return 0;
+}
+
+static struct bench complete_memo_bench = {
+	.name = "complete_memo",
+	.run = complete_memo_run,
+};
+
+BENCH_REGISTER(complete_memo_bench);
+
+#define BACKTRACK_CMDS 16
+#define BACKTRACK_ARGS 16
+
+struct backtrack {
+	struct ec_node *grammar;
+	struct ec_strvec *vec;
+};
+
+/*
+ * The commands share a long list of arguments and only differ by their
+ * last token: without memoization, the arguments are parsed again for
+ * each command. The grammar does not depend on the size.
+ */
+static int backtrack_init(struct bench_ctx *ctx)
+{
+	static const char *const args_vals[] = {"on", "42", "off"};
+	struct backtrack *bt;
+	struct ec_node *args;
+	char name[16];
+	size_t i;
+
+	bt = calloc(1, sizeof(*bt));
+	if (bt == NULL)
+		return -1;
+	ctx->priv = bt;
+
+	args = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "set"),
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, "on"),
+				ec_node_str(EC_NO_ID, "off"),
+				ec_node_int(EC_NO_ID, 0, 1000, 10)
+			),
+			0,
+			0
+		)
+	);
+	bt->grammar = ec_node("or", EC_NO_ID);
+	bt->vec = EC_STRVEC("set");
+	if (args == NULL || bt->grammar == NULL || bt->vec == NULL)
+		goto fail;
+
+	for (i = 0; i < BACKTRACK_CMDS; i++) {
+		snprintf(name, sizeof(name), "end%zu", i);
+		if (ec_node_or_add(
+			    bt->grammar,
+			    EC_NODE_SEQ(EC_NO_ID, ec_node_clone(args), ec_node_str(EC_NO_ID, name))
+		    )
+		    < 0)
+			goto fail;
+	}
+	for (i = 0; i < BACKTRACK_ARGS; i++) {
+		if (ec_strvec_add(bt->vec, args_vals[i % 3]) < 0)
+			goto fail;
+	}
+	if (ec_strvec_add(bt->vec, name) < 0)
+		goto fail;
+
+	ec_node_free(args);
+
+	return 0;
+
+fail:
+	ec_node_free(args);
+	ec_node_free(bt->grammar);
+	ec_strvec_free(bt->vec);
+	free(bt);
+	ctx->priv = NULL;
+	return -1;
+}
+
+static int backtrack_run(struct bench_ctx *ctx, ec_parse_flag_t flags)
+{
+	struct backtrack *bt = ctx->priv;
+	struct ec_pnode *p;
+
+	p = ec_parse_strvec_flags(bt->grammar, bt->vec, flags);
+	if (p == NULL)
+		return -1;
+	if (!ec_pnode_matches(p)) {
+		ec_pnode_free(p);
+		errno = EINVAL;
+		return -1;
+	}
+	ec_pnode_free(p);
+
+	return 0;
+}
+
+static void backtrack_exit(struct bench_ctx *ctx)
+{
+	struct backtrack *bt = ctx->priv;
+
+	ec_node_free(bt->grammar);
+	ec_strvec_free(bt->vec);
+	free(bt);
+	ctx->priv = NULL;
+}
+
+static int parse_backtrack_run(struct bench_ctx *ctx, size_t i)
+{
+	(void)i;
+	return backtrack_run(ctx, 0);
+}
+
+static struct bench parse_backtrack_bench = {
+	.name = "parse_backtrack",
+	.init = backtrack_init,
+	.run = parse_backtrack_run,
+	.exit = backtrack_exit,
+};
+
+BENCH_REGISTER(parse_backtrack_bench);
+
+static int parse_backtrack_memo_run(struct bench_ctx *ctx, size_t i)
+{
+	(void)i;
+	return backtrack_run(ctx, EC_PARSE_MEMO);
+}
+
+static struct bench parse_backtrack_memo_bench = {
+	.name = "parse_backtrack_memo",
+	.init = backtrack_init,
+	.run = parse_backtrack_memo_run,
+	.exit = backtrack_exit,
+};
+
+BENCH_REGISTER(parse_backtrack_memo_bench);
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include "bench.h"
+
+static int sh_lex_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_strvec *vec;
+
+	vec = ec_strvec_sh_lex_str(BENCH_LINE(ctx, lines, i), EC_STRVEC_STRICT, NULL);
+	if (vec == NULL)
+		return -1;
+	ec_strvec_free(vec);
+
+	return 0;
+}
+
+static struct bench sh_lex_bench = {
+	.name = "strvec_sh_lex",
+	.run = sh_lex_run,
+};
+
+BENCH_REGISTER(sh_lex_bench);
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * The list of commands is exported once, and imported at each operation.
+ * The sh_lex node has no configuration schema, it cannot be exported.
+ *
+ * libyaml loads the whole document in memory, about 36kB per command:
+ * the import of 100k commands would need several GB, so it is skipped.
+ */
+static int yaml_import_init(struct bench_ctx *ctx)
+{
+	char path[] = "/tmp/ecoli_bench_XXXXXX";
+	struct ec_node *cmdlist;
+	FILE *f = NULL;
+	int fd;
+
+	if (ec_node_get_child(ctx->grammar, 0, &cmdlist) < 0)
+		return -1;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return -1;
+	f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		goto fail;
+	}
+	if (ec_yaml_export(f, cmdlist) < 0)
+		goto fail;
+	if (fclose(f) < 0) {
+		f = NULL;
+		goto fail;
+	}
+	f = NULL;
+
+	ctx->priv = strdup(path);
+	if (ctx->priv == NULL)
+		goto fail;
+
+	return 0;
+
+fail:
+	if (f != NULL)
+		fclose(f);
+	unlink(path);
+	return -1;
+}
+
+static int yaml_import_run(struct bench_ctx *ctx, size_t i)
+{
+	struct ec_node *node;
+
+	(void)i;
+
+	node = ec_yaml_import(ctx->priv);
+	if (node == NULL)
+		return -1;
+	ec_node_free(node);
+
+	return 0;
+}
+
+static void yaml_import_exit(struct bench_ctx *ctx)
+{
+	unlink(ctx->priv);
+	free(ctx->priv);
+	ctx->priv = NULL;
+}
+
+static struct bench yaml_import_bench = {
+	.name = "yaml_import",
+	.init = yaml_import_init,
+	.run = yaml_import_run,
+	.exit = yaml_import_exit,
+	.max_size = 10000,
+};
+
+BENCH_REGISTER(yaml_import_bench);
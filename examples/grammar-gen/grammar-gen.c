@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli.h>
+
+#include "grammar.h"
+
+static struct ec_test_grammar_params params = {
+	.seed = 0,
+	.n_cmds = 100,
+	.width = 3,
+	.depth = 3,
+};
+static char *output_file;
+static char *lines_file;
+
+static const char short_options[] = "h" /* help */
+				    "n:" /* commands */
+				    "w:" /* width */
+				    "d:" /* depth */
+				    "s:" /* seed */
+				    "c" /* cmd */
+				    "o:" /* output-file */
+				    "l:" /* lines-file */
+	;
+
+#define OPT_HELP "help"
+#define OPT_COMMANDS "commands"
+#define OPT_WIDTH "width"
+#define OPT_DEPTH "depth"
+#define OPT_SEED "seed"
+#define OPT_CMD "cmd"
+#define OPT_OUTPUT_FILE "output-file"
+#define OPT_LINES_FILE "lines-file"
+
+static const struct option long_options[] = {
+	{OPT_HELP, 0, NULL, 'h'},
+	{OPT_COMMANDS, 1, NULL, 'n'},
+	{OPT_WIDTH, 1, NULL, 'w'},
+	{OPT_DEPTH, 1, NULL, 'd'},
+	{OPT_SEED, 1, NULL, 's'},
+	{OPT_CMD, 0, NULL, 'c'},
+	{OPT_OUTPUT_FILE, 1, NULL, 'o'},
+	{OPT_LINES_FILE, 1, NULL, 'l'},
+	{NULL, 0, NULL, 0}
+};
+
+static void usage(const char *prgname)
+{
+	fprintf(stderr,
+		"%s [options]\n"
+		"Generate a grammar shaped like a network OS command line, and\n"
+		"export it in YAML. The output can be used by ecoli-parse-yaml.\n"
+		"  -h\n"
+		"  --" OPT_HELP "\n"
+		"      Show this help.\n"
+		"  -n <count>\n"
+		"  --" OPT_COMMANDS "=<count>\n"
+		"      Set the number of commands (default: 100).\n"
+		"  -w <width>\n"
+		"  --" OPT_WIDTH "=<width>\n"
+		"      Set the maximum number of alternatives or options (default: 3).\n"
+		"  -d <depth>\n"
+		"  --" OPT_DEPTH "=<depth>\n"
+		"      Set the maximum nesting depth of a command (default: 3).\n"
+		"  -s <seed>\n"
+		"  --" OPT_SEED "=<seed>\n"
+		"      Set the seed of the pseudo-random generator (default: 0).\n"
+		"  -c\n"
+		"  --" OPT_CMD "\n"
+		"      Use cmd nodes for some commands.\n"
+		"  -o <output-file>\n"
+		"  --" OPT_OUTPUT_FILE "=<file>\n"
+		"      Set the YAML output file (default: standard output).\n"
+		"  -l <lines-file>\n"
+		"  --" OPT_LINES_FILE "=<file>\n"
+		"      Write one valid command line per command in this file.\n",
+		prgname);
+}
+
+static int parse_args(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, short_options, long_options, NULL)) != EOF) {
+		switch (opt) {
+		case 'h': /* help */
+			usage(argv[0]);
+			exit(0);
+
+		case 'n': /* commands */
+			params.n_cmds = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'w': /* width */
+			params.width = strtoul(optarg, NULL, 10);
+			if (params.width == 0) {
+				fprintf(stderr, "Invalid width\n");
+				return -1;
+			}
+			break;
+
+		case 'd': /* depth */
+			params.depth = strtoul(optarg, NULL, 10);
+			break;
+
+		case 's': /* seed */
+			params.seed = strtoull(optarg, NULL, 0);
+			break;
+
+		case 'c': /* cmd */
+			params.flags |= EC_TEST_GRAMMAR_CMD;
+			break;
+
+		case 'o': /* output-file */
+			output_file = optarg;
+			break;
+
+		case 'l': /* lines-file */
+			lines_file = optarg;
+			break;
+
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int write_file(const char *path, const struct ec_node *node, const struct ec_strvec *lines)
+{
+	FILE *f;
+	size_t i;
+	int ret;
+
+	f = path == NULL ? stdout : fopen(path, "w");
+	if (f == NULL) {
+		fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (node != NULL) {
+		fprintf(f, "---\n");
+		ret = ec_yaml_export(f, node);
+	} else {
+		ret = 0;
+		for (i = 0; i < ec_strvec_len(lines); i++)
+			fprintf(f, "%s\n", ec_strvec_val(lines, i));
+	}
+
+	if (path != NULL && fclose(f) < 0)
+		ret = -1;
+	if (ret < 0)
+		fprintf(stderr, "Cannot write %s\n", path == NULL ? "output" : path);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct ec_strvec *lines = NULL;
+	struct ec_node *node = NULL;
+
+	if (parse_args(argc, argv) < 0)
+		return 1;
+
+	if (ec_init() < 0) {
+		fprintf(stderr, "cannot init ecoli: %s\n", strerror(errno));
+		return 1;
+	}
+
+	lines = ec_strvec();
+	if (lines == NULL)
+		goto fail;
+
+	node = ec_test_grammar(&params, lines);
+	if (node == NULL) {
+		fprintf(stderr, "Failed to generate the grammar: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	if (write_file(output_file, node, NULL) < 0)
+		goto fail;
+	if (lines_file != NULL && write_file(lines_file, NULL, lines) < 0)
+		goto fail;
+
+	ec_strvec_free(lines);
+	ec_node_free(node);
+
+	return 0;
+
+fail:
+	ec_strvec_free(lines);
+	ec_node_free(node);
+	return 1;
+}
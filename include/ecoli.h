@@ -22,6 +22,7 @@
 #pragma once
 
 #include <ecoli/assert.h>
+#include <ecoli/atom.h>
 #include <ecoli/complete.h>
 #include <ecoli/config.h>
 #include <ecoli/dict.h>
@@ -56,6 +57,7 @@
 #include <ecoli/node_str.h>
 #include <ecoli/node_subset.h>
 #include <ecoli/parse.h>
+#include <ecoli/regex.h>
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 #include <ecoli/utils.h>
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+/**
+ * @defgroup ecoli_atom Atoms
+ * @{
+ *
+ * @brief Interned strings
+ *
+ * An atom is the unique copy of a string, stored in a global table: two
+ * atoms are equal if and only if their pointers are equal. Node
+ * identifiers are atoms, see ec_node_id(), so they can be compared
+ * without strcmp().
+ */
+
+#pragma once
+
+/**
+ * Get the atom of a string, creating it if needed.
+ *
+ * The reference must be released with ec_atom_put().
+ *
+ * @param str
+ *   The string to intern.
+ * @return
+ *   The atom, or NULL on error (errno is set).
+ */
+const char *ec_atom_get(const char *str);
+
+/**
+ * Release a reference to an atom.
+ *
+ * The atom is freed when its last reference is released.
+ *
+ * @param atom
+ *   The atom returned by ec_atom_get(). Nothing is done if it is NULL.
+ */
+void ec_atom_put(const char *atom);
+
+/**
+ * Get the atom of a string, without creating it.
+ *
+ * No reference is taken: the atom is valid as long as a reference is
+ * held somewhere, for instance by a node whose identifier it is.
+ *
+ * @param str
+ *   The string to look for.
+ * @return
+ *   The atom, or NULL if the string is not interned (errno is set to
+ *   ENOENT).
+ */
+const char *ec_atom_lookup(const char *str);
+
+/** @} */
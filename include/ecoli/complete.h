@@ -29,6 +29,8 @@
 #include <sys/queue.h>
 #include <sys/types.h>
 
+#include <ecoli/parse.h>
+
 struct ec_node;
 struct ec_comp_item;
 struct ec_comp_group;
@@ -92,6 +94,29 @@ struct ec_comp *ec_complete(const struct ec_node *node, const char *str);
  */
 struct ec_comp *ec_complete_strvec(const struct ec_node *node, const struct ec_strvec *strvec);
 
+/**
+ * Get the list of completions from a string vector input, with options.
+ *
+ * This is the same as ec_complete_strvec(), with additional flags
+ * controlling how the input is parsed during the completion. See
+ * ec_parse_strvec_flags(). The result is identical.
+ *
+ * @param node
+ *   The grammar graph.
+ * @param strvec
+ *   The input string vector.
+ * @param flags
+ *   A logical OR of ec_parse_flag_t options.
+ * @return
+ *   A pointer to the completion list on success, or NULL
+ *   on error (errno is set).
+ */
+struct ec_comp *ec_complete_strvec_flags(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags
+);
+
 /**
  * Return a new string vector based on the provided one using completion to
  * expand non-ambiguous tokens to their full value.
@@ -224,6 +249,21 @@ struct ec_comp_group *ec_comp_get_cur_group(const struct ec_comp *comp);
  */
 struct ec_dict *ec_comp_get_attrs(const struct ec_comp *comp);
 
+/**
+ * Get the memoization counters of a completion.
+ *
+ * The counters are all zero if the completion list was not returned by
+ * ec_complete_strvec_flags() with the EC_PARSE_MEMO flag.
+ *
+ * @param comp
+ *   The completion list.
+ * @param stats
+ *   The structure where the counters are stored.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_comp_get_memo_stats(const struct ec_comp *comp, struct ec_parse_memo_stats *stats);
+
 /**
  * Add an item in completion list.
  *
@@ -33,6 +33,16 @@ struct ec_dict_elt_ref;
  */
 struct ec_dict *ec_dict(void);
 
+/**
+ * Get a shared empty hash table.
+ *
+ * This hash table is read-only: it must not be modified nor freed.
+ *
+ * @return
+ *   The empty hash table.
+ */
+const struct ec_dict *ec_dict_empty(void);
+
 /**
  * Get a value from the hash table.
  *
@@ -49,6 +49,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/queue.h>
 #include <sys/types.h>
@@ -70,6 +71,7 @@ struct ec_strvec;
 struct ec_dict;
 struct ec_config;
 struct ec_config_schema;
+struct ec_node_deps;
 
 /**
  * Register a node type at library load.
@@ -297,6 +299,94 @@ typedef int (*ec_node_get_child_t)(
 	unsigned int *refs
 );
 
+/**
+ * Return values of ec_node_get_first().
+ */
+enum ec_node_first {
+	/** All the matches start with one of the returned tokens. */
+	EC_NODE_FIRST_LITERAL,
+	/**
+	 * The node can match an empty prefix of any input. The other
+	 * matches start with one of the returned tokens.
+	 */
+	EC_NODE_FIRST_NULLABLE,
+	/** The tokens that can start a match are not known. */
+	EC_NODE_FIRST_ANY,
+};
+
+/**
+ * The state of a call to ec_node_get_first().
+ */
+struct ec_node_first_state {
+	/** The tokens are added here. It can contain duplicates. */
+	struct ec_strvec *tokens;
+	/** The recursion depth, updated by ec_node_get_first(). */
+	unsigned int depth;
+	/** If not NULL, the browsed nodes are added here (internal use). */
+	struct ec_node_deps *deps;
+};
+
+/**
+ * Get the literal tokens that can start a match.
+ *
+ * This function pointer should not be called directly. The
+ * ec_node_get_first() helper should be used instead.
+ *
+ * Add to first->tokens the tokens that can be the first one of an input
+ * matched by this node, and return an enum ec_node_first value telling
+ * if this set is exhaustive. The children are browsed using
+ * ec_node_get_first(), passing the same first argument. It is used by
+ * some nodes to skip the children that cannot match an input.
+ *
+ * The result must only depend on the configuration of the node and on
+ * the result of ec_node_get_first() for its children.
+ *
+ * If this callback is set to NULL in the node type, the node is
+ * considered as EC_NODE_FIRST_ANY.
+ *
+ * On error, a negative value is returned and errno is set.
+ */
+typedef int (*ec_node_get_first_t)(const struct ec_node *, struct ec_node_first_state *first);
+
+/**
+ * Check if a string vector matches the given grammar graph.
+ *
+ * This function pointer should not be called directly. The helpers
+ * ec_parse_matches() or ec_match_child() should be used instead.
+ *
+ * This is the same as the parse() callback, except that no parsing
+ * tree is built. The implementation of this method for a node that
+ * manages children will call ec_match_child(child, child_strvec).
+ *
+ * If this callback is set to NULL in the node type, the node is parsed
+ * in a temporary parsing tree. Node types flagged with
+ * EC_NODE_TYPE_F_PSTATE_DEPENDENT cannot be matched without a parsing
+ * tree, and should not implement it.
+ *
+ * @param node
+ *   The grammar graph.
+ * @param strvec
+ *   The string vector to be matched.
+ * @return
+ *   On success, return the number of consumed items in the string vector
+ *   (can be 0) or EC_PARSE_NOMATCH if the node cannot parse the string
+ *   vector. On error, a negative value is returned and errno is set.
+ */
+typedef int (*ec_node_match_t)(const struct ec_node *node, const struct ec_strvec *strvec);
+
+/**
+ * Node type flags.
+ */
+enum ec_node_type_flags {
+	/**
+	 * The result of the parse() method does not only depend on the
+	 * input string vector, but also on the current parsing state (for
+	 * instance on the nodes that were already parsed). The result of
+	 * such a node, and of its ancestors, is never memoized.
+	 */
+	EC_NODE_TYPE_F_PSTATE_DEPENDENT = 1 << 0,
+};
+
 /**
  * A structure describing a grammar node type.
  *
@@ -320,6 +410,9 @@ struct ec_node_type {
 	/** Get children count. */
 	ec_node_get_children_count_t get_children_count;
 	ec_node_get_child_t get_child; /**< Get the i-th child. */
+	enum ec_node_type_flags flags; /**< Node type flags. */
+	ec_node_get_first_t get_first; /**< Get the tokens that can start a match. */
+	ec_node_match_t match; /**< Match a string vector without parsing tree. */
 };
 
 /**
@@ -496,6 +589,27 @@ size_t ec_node_get_children_count(const struct ec_node *node);
  */
 int ec_node_get_child(const struct ec_node *node, size_t i, struct ec_node **child);
 
+/**
+ * Get the literal tokens that can start a match.
+ *
+ * See ec_node_get_first_t for details. When the depth is greater than
+ * EC_NODE_FIRST_MAX_DEPTH, the node is considered as EC_NODE_FIRST_ANY,
+ * so loops in the grammar graph are not an issue.
+ *
+ * @param node
+ *   The grammar node.
+ * @param first
+ *   The state of the call. For the first call, the depth is 0, the
+ *   deps field is NULL, and the tokens are added to the tokens field.
+ * @return
+ *   An enum ec_node_first value on success, or a negative value on
+ *   error (errno is set).
+ */
+int ec_node_get_first(const struct ec_node *node, struct ec_node_first_state *first);
+
+/** Maximum recursion depth of ec_node_get_first(). */
+#define EC_NODE_FIRST_MAX_DEPTH 8
+
 /**
  * Get the type of a node.
  *
@@ -525,7 +639,8 @@ struct ec_dict *ec_node_attrs(const struct ec_node *node);
  * @param node
  *   The grammar node.
  * @return
- *   The node identifier string.
+ *   The node identifier string. It is an atom (see ec_atom_get()): two
+ *   nodes have the same identifier if these pointers are equal.
  */
 const char *ec_node_id(const struct ec_node *node);
 
@@ -550,6 +665,82 @@ char *ec_node_desc(const struct ec_node *node);
  */
 void ec_node_dump(FILE *out, const struct ec_node *node);
 
+/**
+ * Profiling counters of a grammar node.
+ *
+ * They are only updated when the profiling is enabled with
+ * ec_node_stats_enable(). The times include the calls to ec_parse_child(),
+ * ec_match_child() and ec_complete_child() on this node. If a node is
+ * reached recursively from itself, its total time is counted several
+ * times.
+ */
+struct ec_node_stats {
+	uint64_t parse_calls; /**< Number of parsings of the node. */
+	uint64_t parse_match; /**< Number of parsings that matched. */
+	uint64_t parse_nomatch; /**< Number of parsings that did not match. */
+	uint64_t complete_calls; /**< Number of completions of the node. */
+	uint64_t total_ns; /**< Time spent in the node and its children. */
+	uint64_t self_ns; /**< Time spent in the node, excluding its children. */
+	uint64_t allocs; /**< Allocations of the parsing tree, excluding the children. */
+};
+
+/**
+ * Enable or disable the profiling counters of all the grammar nodes.
+ *
+ * When disabled (the default), the parsing and the completion do not
+ * update any counter.
+ *
+ * @param enable
+ *   True to enable the counters.
+ */
+void ec_node_stats_enable(bool enable);
+
+/**
+ * Get the profiling counters of a grammar node.
+ *
+ * @param node
+ *   The grammar node.
+ * @param stats
+ *   The structure where the counters are stored. They are all zero if
+ *   the node was not parsed or completed while profiling.
+ */
+void ec_node_get_stats(const struct ec_node *node, struct ec_node_stats *stats);
+
+/**
+ * Reset the profiling counters of all the nodes of a grammar tree.
+ *
+ * @param node
+ *   The grammar tree.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_node_stats_reset(struct ec_node *node);
+
+/**
+ * Output formats of ec_node_stats_dump().
+ */
+enum ec_node_stats_format {
+	EC_NODE_STATS_TEXT, /**< One line per node, with a header. */
+	EC_NODE_STATS_JSON, /**< A JSON array with one object per node. */
+};
+
+/**
+ * Dump the profiling counters of a grammar tree.
+ *
+ * The nodes that were parsed or completed while profiling are dumped,
+ * sorted by decreasing self time.
+ *
+ * @param out
+ *   The stream where the dump is sent.
+ * @param node
+ *   The grammar tree.
+ * @param format
+ *   The output format.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_node_stats_dump(FILE *out, const struct ec_node *node, enum ec_node_stats_format format);
+
 /**
  * Find a node from its identifier string.
  *
@@ -565,6 +756,21 @@ void ec_node_dump(FILE *out, const struct ec_node *node);
  */
 struct ec_node *ec_node_find(struct ec_node *node, const char *id);
 
+/**
+ * Find a node from its identifier atom.
+ *
+ * Same as ec_node_find(), but the identifier is an atom, see ec_atom_get(),
+ * so it is compared by pointer.
+ *
+ * @param node
+ *   The grammar tree.
+ * @param atom
+ *   The identifier atom to match.
+ * @return
+ *   A node matching the identifier.
+ */
+struct ec_node *ec_node_find_atom(struct ec_node *node, const char *atom);
+
 /**
  * Create an iterator on a grammar tree.
  *
@@ -645,6 +851,10 @@ struct ec_node_iter *ec_node_iter_get_parent(struct ec_node_iter *iter);
 /**
  * Check the type of a node.
  *
+ * The types are compared by pointer, then by name, so that a node whose
+ * type was overridden (see EC_NODE_TYPE_REGISTER_OVERRIDE()) has the
+ * type of the same name.
+ *
  * @param node
  *   The grammar node.
  * @param type
@@ -27,4 +27,20 @@
  */
 struct ec_node *ec_node_any(const char *id, const char *attr);
 
+/**
+ * Create a "any" node matching a token kind.
+ *
+ * This node matches 1 string in the vector, if its kind is the given
+ * one, see ec_strvec_get_kind(). The kinds are usually set by a lexer
+ * node, like "re_lex".
+ *
+ * @param id
+ *   The node identifier.
+ * @param kind
+ *   The token kind to match, not 0.
+ * @return
+ *   The ecoli node.
+ */
+struct ec_node *ec_node_any_kind(const char *id, unsigned int kind);
+
 /** @} */
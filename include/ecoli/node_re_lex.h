@@ -13,6 +13,11 @@
 
 struct ec_node *ec_node_re_lex(const char *id, struct ec_node *child);
 
+/*
+ * Add a pattern to the lexer. The patterns are tried in the order they
+ * were added. The kind of the kept tokens (see ec_strvec_get_kind()) is
+ * the index of their pattern plus one.
+ */
 int ec_node_re_lex_add(
 	struct ec_node *gen_node,
 	const char *pattern,
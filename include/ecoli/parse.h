@@ -26,6 +26,8 @@
 #include <sys/queue.h>
 #include <sys/types.h>
 
+#include <ecoli/dict.h>
+
 struct ec_node;
 
 /** Parse tree node. */
@@ -139,6 +141,93 @@ struct ec_pnode *ec_parse(const struct ec_node *node, const char *str);
  */
 struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec);
 
+/**
+ * Options for ec_parse_strvec_flags() and ec_complete_strvec_flags().
+ */
+typedef enum {
+	/**
+	 * Memoize the result of each grammar node for a given position in
+	 * the input. When a node is parsed again at the same position (for
+	 * instance when an ec_node_or() or an ec_node_seq() backtracks),
+	 * the result is reused instead of being computed again.
+	 *
+	 * The memoization table is owned by the top-level call. Results that
+	 * depend on the parsing state (see EC_NODE_TYPE_F_PSTATE_DEPENDENT)
+	 * are never memoized.
+	 */
+	EC_PARSE_MEMO = 0x1,
+	/**
+	 * Allocate the parsing nodes and their matched string vectors from
+	 * an arena owned by the top-level call. The nodes that are freed
+	 * during the parsing are reused, and the memory of the whole tree
+	 * is released at once when the root is freed.
+	 *
+	 * The nodes of such a tree must not be used after the root is freed,
+	 * even if they were unlinked from it. Use ec_pnode_dup() to get an
+	 * independent copy.
+	 */
+	EC_PARSE_ARENA = 0x2,
+	/**
+	 * When the input matches, index the parsing tree by node
+	 * identifier, so that ec_pnode_find(), ec_pnode_find_next(),
+	 * ec_pnode_count() and their atom variants do a lookup instead of
+	 * a depth-first search. This is useful when the tree is searched
+	 * many times, for instance by a command callback.
+	 *
+	 * The index is dropped when the tree is modified, the searches then
+	 * fall back to a depth-first search. It is ignored by the
+	 * completion functions.
+	 */
+	EC_PARSE_INDEX = 0x4,
+} ec_parse_flag_t;
+
+/**
+ * Parse a string vector using a grammar tree, with options.
+ *
+ * This is the same as ec_parse_strvec(), with additional flags
+ * controlling how the parsing is done. The result is identical.
+ *
+ * @param node
+ *   The grammar node.
+ * @param strvec
+ *   The input string vector.
+ * @param flags
+ *   A logical OR of ec_parse_flag_t options.
+ * @return
+ *   A parsing tree, or NULL on error (errno is set).
+ */
+struct ec_pnode *ec_parse_strvec_flags(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags
+);
+
+/**
+ * Memoization counters.
+ *
+ * See EC_PARSE_MEMO.
+ */
+struct ec_parse_memo_stats {
+	size_t lookups; /**< Number of lookups in the memoization table. */
+	size_t hits; /**< Number of lookups that returned a stored result. */
+	size_t entries; /**< Number of results stored in the table. */
+};
+
+/**
+ * Get the memoization counters of a parsing tree.
+ *
+ * The counters are all zero if the tree was not returned by
+ * ec_parse_strvec_flags() with the EC_PARSE_MEMO flag.
+ *
+ * @param pnode
+ *   A node of the parsing tree.
+ * @param stats
+ *   The structure where the counters are stored.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_pnode_get_memo_stats(const struct ec_pnode *pnode, struct ec_parse_memo_stats *stats);
+
 /**
  * Return value of ec_parse_child() when input does not match grammar.
  */
@@ -174,6 +263,129 @@ int ec_parse_child(
 	const struct ec_strvec *strvec
 );
 
+/**
+ * Check if a string vector matches a grammar tree.
+ *
+ * This gives the same result as ec_parse_strvec() followed by
+ * ec_pnode_len(), but no parsing tree is built when all the nodes
+ * of the grammar implement the match() callback of their type. It is
+ * useful when the caller only needs to know if the input matches.
+ *
+ * If the grammar contains nodes that depend on the parsing state (see
+ * EC_NODE_TYPE_F_PSTATE_DEPENDENT), a full parsing is done.
+ *
+ * @param node
+ *   The grammar node.
+ * @param strvec
+ *   The input string vector.
+ * @return
+ *   On success: the number of matched elements in the input string
+ *   vector (which can be 0), or EC_PARSE_NOMATCH if the input does not
+ *   match the grammar. On error, -1 is returned, and errno is set.
+ */
+int ec_parse_matches(const struct ec_node *node, const struct ec_strvec *strvec);
+
+/**
+ * Check if a string vector matches a grammar tree, from a parent node.
+ *
+ * This function is called from the match() method of an intermediate
+ * node (like ec_node_seq, ec_node_or, ...), the same way
+ * ec_parse_child() is called from the parse() method.
+ *
+ * If the node type does not implement the match() method, the node
+ * is parsed in a temporary parsing tree. If the node depends on the
+ * parsing state, -1 is returned and errno is set to ENOTSUP:
+ * ec_parse_matches() then falls back to a full parsing.
+ *
+ * @param node
+ *   The grammar node.
+ * @param strvec
+ *   The input string vector.
+ * @return
+ *   On success: the number of matched elements in the input string
+ *   vector (which can be 0), or EC_PARSE_NOMATCH if the input does not
+ *   match the grammar. On error, -1 is returned, and errno is set.
+ */
+int ec_match_child(const struct ec_node *node, const struct ec_strvec *strvec);
+
+/**
+ * Callbacks invoked by ec_parse_strvec_visit().
+ *
+ * Each callback receives a grammar node of the successful parsing, the
+ * input string vector, the span of tokens matched by the node in it
+ * (start index and number of tokens), and the opaque pointer passed to
+ * ec_parse_strvec_visit(). Under a lexer node (sh_lex, re_lex), the
+ * string vector is the one of the tokens produced by the lexer that are
+ * matched by the child. A callback can be NULL.
+ */
+struct ec_parse_visitor {
+	/**
+	 * Called when entering a node, before its children. Return 0 to
+	 * visit the children, a positive value to skip them, or a negative
+	 * value to stop the visit (errno should be set).
+	 */
+	int (*enter)(
+		const struct ec_node *node,
+		const struct ec_strvec *strvec,
+		size_t start,
+		size_t len,
+		void *opaque
+	);
+	/**
+	 * Called when leaving a node, after its children, even if they
+	 * were skipped. Return 0 to continue, or a negative value to stop
+	 * the visit (errno should be set).
+	 */
+	int (*leave)(
+		const struct ec_node *node,
+		const struct ec_strvec *strvec,
+		size_t start,
+		size_t len,
+		void *opaque
+	);
+};
+
+/**
+ * Parse a string vector and walk the result with callbacks.
+ *
+ * This is a convenience wrapper: the parsing tree is built as with
+ * ec_parse_strvec_flags() and the EC_PARSE_ARENA flag, then walked
+ * depth-first, then released at once. Events are not streamed during
+ * the parsing: the nodes that depend on the parsing state (once, cond)
+ * need the tree of their ancestors, and backtracking discards subtrees
+ * that were already built. As a consequence, a node that is backtracked
+ * never generates an event, and the memory usage is the one of a
+ * parsing tree allocated from an arena. Nothing is kept from one call
+ * to another.
+ *
+ * This is useful when the caller only needs to process some nodes of
+ * the parsing, for instance the ones with a given id, without managing
+ * the lifetime of the tree.
+ *
+ * @param node
+ *   The grammar node.
+ * @param strvec
+ *   The input string vector.
+ * @param flags
+ *   A logical OR of ec_parse_flag_t options.
+ * @param visitor
+ *   The callbacks.
+ * @param opaque
+ *   A user pointer passed to the callbacks.
+ * @return
+ *   The number of matched elements in the input string vector (which
+ *   can be 0), or EC_PARSE_NOMATCH if the input does not match the
+ *   grammar: in this case, no callback is invoked. On error, or if a
+ *   callback stops the visit, -1 is returned, and errno is set.
+ */
+int ec_parse_strvec_visit(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags,
+	const struct ec_parse_visitor *visitor,
+	void *opaque
+);
+
 /**
  * Link a parsing node to a parsing tree.
  *
@@ -314,14 +526,40 @@ void ec_pnode_del_last_child(struct ec_pnode *pnode);
  *
  * Attributes are key/values that are stored in a dictionary
  * and attached to a node in the parsing tree. An attribute can be
- * added to a node by the parsing or completion method of an ec_node.
+ * added to a node by the parsing or completion method of an ec_node,
+ * with ec_pnode_set_attr().
+ *
+ * The dictionary is only allocated when the first attribute is set.
+ * Until then, a shared empty dictionary is returned.
  *
  * @param pnode
  *   A node in the parsing tree.
  * @return
- *   The dictionary containing the attributes.
+ *   The read-only dictionary containing the attributes.
  */
-struct ec_dict *ec_pnode_get_attrs(const struct ec_pnode *pnode);
+const struct ec_dict *ec_pnode_get_attrs(const struct ec_pnode *pnode);
+
+/**
+ * Set an attribute of a node in a parsing tree.
+ *
+ * @param pnode
+ *   A node in the parsing tree.
+ * @param key
+ *   The key of the attribute.
+ * @param val
+ *   The value of the attribute.
+ * @param free_cb
+ *   The function used to free the value, or NULL.
+ * @return
+ *   0 on success, or -1 on error (errno is set). On error, the value
+ *   is freed using free_cb.
+ */
+int ec_pnode_set_attr(
+	struct ec_pnode *pnode,
+	const char *key,
+	void *val,
+	ec_dict_elt_free_t free_cb
+);
 
 /**
  * Dump a parsing tree.
@@ -388,6 +626,59 @@ const struct ec_pnode *ec_pnode_find_next(
  */
 unsigned int ec_pnode_count(const struct ec_pnode *root, const char *id);
 
+/**
+ * Find a node from its identifier atom.
+ *
+ * Same as ec_pnode_find(), but the identifier is an atom, see
+ * ec_atom_get(), so it is compared by pointer. This is faster when
+ * the same identifier is searched many times.
+ *
+ * @param root
+ *   The node of the parsing tree where the search starts.
+ * @param atom
+ *   The node identifier atom to match.
+ * @return
+ *   The first node matching the identifier, or NULL if not found.
+ */
+const struct ec_pnode *ec_pnode_find_atom(const struct ec_pnode *root, const char *atom);
+
+/**
+ * Find the next node matching an identifier atom.
+ *
+ * Same as ec_pnode_find_next(), but the identifier is an atom.
+ *
+ * @param root
+ *   The root of the search, as passed to ec_pnode_find_atom().
+ * @param prev
+ *   The node returned by the previous search.
+ * @param atom
+ *   The node identifier atom to match.
+ * @param iter_children
+ *   True to iterate the children of "prev", false to skip them.
+ * @return
+ *   The next node matching the identifier, or NULL if not found.
+ */
+const struct ec_pnode *ec_pnode_find_next_atom(
+	const struct ec_pnode *root,
+	const struct ec_pnode *prev,
+	const char *atom,
+	bool iter_children
+);
+
+/**
+ * Count node occurrences in a parse subtree, from an identifier atom.
+ *
+ * Same as ec_pnode_count(), but the identifier is an atom.
+ *
+ * @param root
+ *   The node of the parsing tree where the search starts.
+ * @param atom
+ *   The node identifier atom to match.
+ * @return
+ *   The number of nodes matching the identifier.
+ */
+unsigned int ec_pnode_count_atom(const struct ec_pnode *root, const char *atom);
+
 /**
  * Iterate among parse tree
  *
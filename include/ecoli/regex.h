@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+/**
+ * @defgroup ecoli_regex Regular expressions
+ * @{
+ *
+ * @brief Match strings against POSIX extended regular expressions
+ *
+ * The expressions are compiled by the first backend that supports them:
+ * - "dfa": a deterministic automaton, matching in linear time without
+ *   allocation. It supports literals, ".", bracket expressions (except
+ *   collating elements and equivalence classes), groups, alternations,
+ *   the "*", "+", "?" and "{m,n}" repetitions, and "^" and "$" at the
+ *   start and end of the top-level alternatives. In a multibyte locale,
+ *   it only supports expressions that match ASCII characters, and ranges
+ *   if the characters are sorted by code point, as in C.UTF-8.
+ * - "posix": the regcomp(3) and regexec(3) functions of the C library,
+ *   which support everything else.
+ *
+ * Unlike regexec(3), the match functions are anchored: the expression
+ * matches the whole string, or its beginning.
+ *
+ * A list of expressions can be compiled together, to find which one
+ * matches in a single pass over the string, as a tokenizer does.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Flags of ec_regex().
+ */
+enum ec_regex_flags {
+	/** Always use the "posix" backend. */
+	EC_REGEX_POSIX = 1 << 0,
+};
+
+/**
+ * A compiled regular expression.
+ */
+struct ec_regex;
+
+/**
+ * Compile a POSIX extended regular expression.
+ *
+ * @param pattern
+ *   The regular expression.
+ * @param flags
+ *   A mask of enum ec_regex_flags.
+ * @return
+ *   The compiled expression, to be freed with ec_regex_free(), or NULL
+ *   on error (errno is set to EINVAL if the expression is invalid).
+ */
+struct ec_regex *ec_regex(const char *pattern, unsigned int flags);
+
+/**
+ * Compile a list of POSIX extended regular expressions.
+ *
+ * The "dfa" backend is used if it supports all the expressions, and if
+ * there are at most 64 of them.
+ *
+ * @param patterns
+ *   The regular expressions.
+ * @param n
+ *   The number of expressions, at least 1.
+ * @param flags
+ *   A mask of enum ec_regex_flags.
+ * @return
+ *   The compiled expressions, to be freed with ec_regex_free(), or NULL
+ *   on error (errno is set to EINVAL if an expression is invalid).
+ */
+struct ec_regex *ec_regex_list(const char *const *patterns, size_t n, unsigned int flags);
+
+/**
+ * Free a compiled regular expression.
+ *
+ * @param re
+ *   The compiled expression. Nothing is done if it is NULL.
+ */
+void ec_regex_free(struct ec_regex *re);
+
+/**
+ * Get the name of the backend of a compiled regular expression.
+ *
+ * @param re
+ *   The compiled expression.
+ * @return
+ *   "dfa" or "posix".
+ */
+const char *ec_regex_backend(const struct ec_regex *re);
+
+/**
+ * Check if a string matches a regular expression.
+ *
+ * @param re
+ *   The compiled expression.
+ * @param str
+ *   The string.
+ * @return
+ *   True if the whole string matches the expression, or one of the
+ *   expressions of a list.
+ */
+bool ec_regex_match(const struct ec_regex *re, const char *str);
+
+/**
+ * Find the longest beginning of a string matching a regular expression.
+ *
+ * @param re
+ *   The compiled expression.
+ * @param str
+ *   The string.
+ * @param len
+ *   The length of the match is stored here.
+ * @return
+ *   True if a beginning of the string, maybe empty, matches the
+ *   expression, or one of the expressions of a list.
+ */
+bool ec_regex_match_prefix(const struct ec_regex *re, const char *str, size_t *len);
+
+/**
+ * Find the first expression of a list matching a beginning of a string.
+ *
+ * Empty matches are ignored. This is the next token of the string, if
+ * the expressions describe the tokens by order of priority.
+ *
+ * @param re
+ *   The compiled expressions.
+ * @param str
+ *   The string.
+ * @param index
+ *   The index of the expression in the list is stored here.
+ * @param len
+ *   The length of its longest match is stored here.
+ * @return
+ *   True if an expression matches a non-empty beginning of the string.
+ */
+bool ec_regex_match_token(const struct ec_regex *re, const char *str, size_t *index, size_t *len);
+
+/** @} */
@@ -73,8 +73,11 @@ typedef enum {
 } ec_strvec_flag_t;
 
 /**
- * All elements of the vector returned by ec_strvec_sh_lex_str() have two
- * attributes accessible via ec_strvec_get_attrs().
+ * @deprecated The elements that have a span, like the ones returned by
+ * ec_strvec_sh_lex_str(), still have two attributes accessible via
+ * ec_strvec_get_attrs(), which duplicate it. They are built on the first
+ * call, and will be removed at the next version bump: use
+ * ec_strvec_get_span() instead.
  */
 /** The start index in the original line passed to ec_strvec_sh_lex_str(). */
 #define EC_STRVEC_ATTR_START "start"
@@ -84,6 +87,9 @@ typedef enum {
 /**
  * Split a string into multiple tokens following basic shell lexing rules.
  *
+ * The span of each token in the string is available with
+ * ec_strvec_get_span().
+ *
  * @param str
  *   The string to split.
  * @param flags
@@ -98,6 +104,59 @@ typedef enum {
 struct ec_strvec *
 ec_strvec_sh_lex_str(const char *str, ec_strvec_flag_t flags, char *unclosed_quote);
 
+/**
+ * The state of an incremental shell lexer.
+ *
+ * It remembers the line it has read, with its tokens, so that the same
+ * line extended with a few characters is lexed without reading it again,
+ * as when the user types on an interactive command line.
+ */
+struct ec_strvec_sh_lexer;
+
+/**
+ * Create an incremental shell lexer.
+ *
+ * @return
+ *   The lexer, to be freed with ec_strvec_sh_lexer_free(), or NULL on
+ *   error (errno is set).
+ */
+struct ec_strvec_sh_lexer *ec_strvec_sh_lexer(void);
+
+/**
+ * Free an incremental shell lexer.
+ *
+ * @param lexer
+ *   The lexer. Nothing is done if it is NULL.
+ */
+void ec_strvec_sh_lexer_free(struct ec_strvec_sh_lexer *lexer);
+
+/**
+ * Split a string into tokens, like ec_strvec_sh_lex_str().
+ *
+ * If the string starts with the previous string given to this lexer,
+ * only the new characters are read. Else, the lexer is reset and the
+ * whole string is read.
+ *
+ * @param lexer
+ *   The incremental lexer.
+ * @param str
+ *   The string to split.
+ * @param flags
+ *   Options for controlling behavior.
+ * @param unclosed_quote
+ *   If not NULL and if the provided string has an unterminated quote. The
+ *   opening quote will be stored here.
+ *
+ * @return
+ *   The new strvec object, or NULL on error (errno is set).
+ */
+struct ec_strvec *ec_strvec_sh_lex_resume(
+	struct ec_strvec_sh_lexer *lexer,
+	const char *str,
+	ec_strvec_flag_t flags,
+	char *unclosed_quote
+);
+
 /**
  * Set a string in the vector at specified index.
  *
@@ -124,6 +183,22 @@ int ec_strvec_set(struct ec_strvec *strvec, size_t idx, const char *s);
  */
 int ec_strvec_add(struct ec_strvec *strvec, const char *s);
 
+/**
+ * Reserve room for strings in a vector.
+ *
+ * The vector grows by itself when strings are added, but reserving the
+ * room for a known number of strings avoids reallocations.
+ *
+ * @param strvec
+ *   The pointer to the string vector.
+ * @param size
+ *   The number of strings the vector can hold without reallocation,
+ *   including the ones it already holds.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_strvec_reserve(struct ec_strvec *strvec, size_t size);
+
 /**
  * Delete the last entry in the string vector.
  *
@@ -206,6 +281,70 @@ const char *ec_strvec_val(const struct ec_strvec *strvec, size_t idx);
  */
 const struct ec_dict *ec_strvec_get_attrs(const struct ec_strvec *strvec, size_t idx);
 
+/**
+ * Get the span of a vector element in the line it was lexed from.
+ *
+ * @param strvec
+ *   The pointer to the string vector.
+ * @param idx
+ *   The index of the string.
+ * @param start
+ *   If not NULL, the offset of the first character of the token in the
+ *   line is stored here.
+ * @param end
+ *   If not NULL, the offset after the last character of the token is
+ *   stored here.
+ * @return
+ *   0 on success, or -1 on error (errno is set to ENOENT if the element
+ *   has no span).
+ */
+int ec_strvec_get_span(const struct ec_strvec *strvec, size_t idx, size_t *start, size_t *end);
+
+/**
+ * Set the span of a vector element in the line it was lexed from.
+ *
+ * @param strvec
+ *   The pointer to the string vector.
+ * @param idx
+ *   The index of the string.
+ * @param start
+ *   The offset of the first character of the token in the line.
+ * @param end
+ *   The offset after the last character of the token.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_strvec_set_span(struct ec_strvec *strvec, size_t idx, size_t start, size_t end);
+
+/**
+ * Get the kind of a vector element.
+ *
+ * The kind is a small integer tag set by lexers, and checked by parsers
+ * without the cost of a dictionary lookup.
+ *
+ * @param strvec
+ *   The pointer to the string vector.
+ * @param idx
+ *   The index of the string.
+ * @return
+ *   The kind of the string, or 0 if it has none or on error.
+ */
+unsigned int ec_strvec_get_kind(const struct ec_strvec *strvec, size_t idx);
+
+/**
+ * Set the kind of a vector element.
+ *
+ * @param strvec
+ *   The pointer to the string vector.
+ * @param idx
+ *   The index of the string.
+ * @param kind
+ *   The kind, 0 to unset it.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_strvec_set_kind(struct ec_strvec *strvec, size_t idx, unsigned int kind);
+
 /**
  * Set the attributes of a vector element.
  *
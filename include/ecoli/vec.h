@@ -34,9 +34,52 @@ typedef void (*ec_vec_elt_copy_t)(void *dst, void *src);
 /** Create a new vector. */
 struct ec_vec *ec_vec(size_t elt_size, size_t size, ec_vec_elt_copy_t copy, ec_vec_elt_free_t free);
 
+/**
+ * Reserve room for elements in a vector.
+ *
+ * The vector doubles its size when it is full, but reserving the room
+ * for a known number of elements avoids reallocations.
+ *
+ * @param vec
+ *   The vector.
+ * @param size
+ *   The number of elements the vector can hold without reallocation,
+ *   including the ones it already holds.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_vec_reserve(struct ec_vec *vec, size_t size);
+
+/**
+ * Release the room reserved for elements that were not added.
+ *
+ * @param vec
+ *   The vector.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_vec_shrink(struct ec_vec *vec);
+
 /** Add reference to a vector. */
 int ec_vec_add_by_ref(struct ec_vec *vec, void *ptr);
 
+/**
+ * Add the elements of an array to a vector.
+ *
+ * Like ec_vec_add_by_ref(), the elements are copied with memcpy(), and
+ * the vector owns them.
+ *
+ * @param vec
+ *   The vector.
+ * @param array
+ *   The array of elements, of the size given to ec_vec().
+ * @param n
+ *   The number of elements in the array.
+ * @return
+ *   0 on success or -1 on error (errno is set).
+ */
+int ec_vec_add_array(struct ec_vec *vec, const void *array, size_t n);
+
 /** Add opaque element to a vector. */
 int ec_vec_add_ptr(struct ec_vec *vec, void *elt);
 
@@ -52,6 +95,43 @@ int ec_vec_add_u64(struct ec_vec *vec, uint64_t elt);
 /** Get element located at an offset. */
 int ec_vec_get(void *ptr, const struct ec_vec *vec, size_t idx);
 
+/**
+ * Get a pointer to the element located at an offset, without copying it.
+ *
+ * The pointer is valid until the vector is modified.
+ *
+ * @param vec
+ *   The vector.
+ * @param idx
+ *   The offset of the element.
+ * @return
+ *   The pointer to the element, or NULL if the offset is out of bounds.
+ */
+void *ec_vec_at(const struct ec_vec *vec, size_t idx);
+
+/**
+ * Get a pointer to the elements of a vector, stored contiguously.
+ *
+ * The pointer is valid until the vector is modified.
+ *
+ * @param vec
+ *   The vector.
+ * @return
+ *   The pointer to the first element, or NULL if the vector is empty.
+ */
+void *ec_vec_data(const struct ec_vec *vec);
+
+/**
+ * Iterate the elements of a vector, without copying them.
+ *
+ * @param ptr
+ *   The pointer that will be set to each element.
+ * @param vec
+ *   The vector, which must not be modified during the iteration.
+ */
+#define EC_VEC_FOREACH(ptr, vec)                                                                   \
+	for (size_t __ec_vec_idx = 0; (ptr = ec_vec_at(vec, __ec_vec_idx)) != NULL; __ec_vec_idx++)
+
 /** Duplicate a vector. */
 struct ec_vec *ec_vec_dup(const struct ec_vec *vec);
 /** Duplicate a portion of a vector. */
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/atom.h>
+#include <ecoli/htable.h>
+#include <ecoli/init.h>
+
+struct ec_atom {
+	unsigned int refcnt;
+	char str[];
+};
+
+/* string -> struct ec_atom, the table does not own the atoms */
+static struct ec_htable *ec_atom_table;
+
+static struct ec_atom *ec_atom_from_str(const char *str)
+{
+	return (struct ec_atom *)(str - offsetof(struct ec_atom, str));
+}
+
+const char *ec_atom_lookup(const char *str)
+{
+	struct ec_atom *atom = NULL;
+
+	if (str == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (ec_atom_table != NULL)
+		atom = ec_htable_get(ec_atom_table, str, strlen(str) + 1);
+	if (atom == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	return atom->str;
+}
+
+const char *ec_atom_get(const char *str)
+{
+	struct ec_atom *atom = NULL;
+	size_t len;
+
+	if (str == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	len = strlen(str) + 1;
+	if (ec_atom_table == NULL) {
+		ec_atom_table = ec_htable();
+		if (ec_atom_table == NULL)
+			return NULL;
+	}
+
+	atom = ec_htable_get(ec_atom_table, str, len);
+	if (atom != NULL) {
+		atom->refcnt++;
+		return atom->str;
+	}
+
+	atom = malloc(sizeof(*atom) + len);
+	if (atom == NULL)
+		return NULL;
+	atom->refcnt = 1;
+	memcpy(atom->str, str, len);
+
+	if (ec_htable_set(ec_atom_table, str, len, atom, NULL) < 0) {
+		free(atom);
+		return NULL;
+	}
+
+	return atom->str;
+}
+
+void ec_atom_put(const char *str)
+{
+	struct ec_atom *atom;
+	size_t len;
+
+	if (str == NULL)
+		return;
+
+	atom = ec_atom_from_str(str);
+	if (--atom->refcnt > 0)
+		return;
+
+	/* the atom may survive the table, see ec_atom_exit_func() */
+	len = strlen(str) + 1;
+	if (ec_atom_table != NULL && ec_htable_get(ec_atom_table, str, len) == atom)
+		ec_htable_del(ec_atom_table, str, len);
+	free(atom);
+}
+
+/*
+ * Atoms created before ec_init() were hashed with the default seed:
+ * move them to a new table.
+ */
+static int ec_atom_init_func(void)
+{
+	struct ec_htable_elt_ref *iter;
+	struct ec_htable *table;
+
+	table = ec_htable();
+	if (table == NULL)
+		return -1;
+
+	for (iter = ec_htable_iter(ec_atom_table); iter != NULL;
+	     iter = ec_htable_iter_next(iter)) {
+		if (ec_htable_set(table,
+				  ec_htable_iter_get_key(iter),
+				  ec_htable_iter_get_key_len(iter),
+				  ec_htable_iter_get_val(iter),
+				  NULL)
+		    < 0) {
+			ec_htable_free(table);
+			return -1;
+		}
+	}
+
+	ec_htable_free(ec_atom_table);
+	ec_atom_table = table;
+
+	return 0;
+}
+
+/*
+ * Atoms that are still referenced are not freed: they stay valid, but
+ * are not interned anymore.
+ */
+static void ec_atom_exit_func(void)
+{
+	ec_htable_free(ec_atom_table);
+	ec_atom_table = NULL;
+}
+
+/* after the hash table seed initialization */
+static struct ec_init ec_atom_init = {
+	.init = ec_atom_init_func,
+	.exit = ec_atom_exit_func,
+	.priority = 60,
+};
+
+EC_INIT_REGISTER(ec_atom_init);
@@ -20,6 +20,9 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+#include "parse_private.h"
+
 EC_LOG_TYPE_REGISTER(comp);
 
 struct ec_comp_item {
@@ -55,6 +58,7 @@ struct ec_comp {
 	struct ec_comp_group *cur_group;
 	struct ec_comp_group_list groups;
 	struct ec_dict *attrs;
+	struct ec_parse_ctx *ctx;
 };
 
 struct ec_comp *ec_comp(void)
@@ -96,6 +100,18 @@ struct ec_dict *ec_comp_get_attrs(const struct ec_comp *comp)
 	return comp->attrs;
 }
 
+int ec_comp_get_memo_stats(const struct ec_comp *comp, struct ec_parse_memo_stats *stats)
+{
+	if (comp == NULL || stats == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ec_parse_ctx_get_memo_stats(comp->ctx, stats);
+
+	return 0;
+}
+
 int ec_complete_child(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -103,6 +119,8 @@ int ec_complete_child(
 )
 {
 	struct ec_pnode *child_pstate, *cur_pstate;
+	bool profile = ec_node_stats_enabled;
+	struct ec_node_stats_probe probe;
 	struct ec_comp_group *cur_group;
 	ec_complete_t complete_cb;
 	int ret;
@@ -114,7 +132,7 @@ int ec_complete_child(
 
 	/* save previous parse state, prepare child state */
 	cur_pstate = comp->cur_pstate;
-	child_pstate = ec_pnode(node);
+	child_pstate = ec_pnode_alloc(node, comp->ctx);
 	if (child_pstate == NULL)
 		return -1;
 
@@ -125,7 +143,11 @@ int ec_complete_child(
 	comp->cur_group = NULL;
 
 	/* fill the comp struct with items */
+	if (profile)
+		ec_node_stats_enter(&probe);
 	ret = complete_cb(node, comp, strvec);
+	if (profile)
+		ec_node_stats_leave(node, &probe, EC_NODE_STATS_OP_COMPLETE, ret);
 
 	/* restore parent parse state */
 	if (cur_pstate != NULL) {
@@ -142,7 +164,11 @@ int ec_complete_child(
 	return 0;
 }
 
-struct ec_comp *ec_complete_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+struct ec_comp *ec_complete_strvec_flags(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags
+)
 {
 	struct ec_comp *comp = NULL;
 	int ret;
@@ -151,7 +177,14 @@ struct ec_comp *ec_complete_strvec(const struct ec_node *node, const struct ec_s
 	if (comp == NULL)
 		goto fail;
 
+	if (flags != 0) {
+		comp->ctx = ec_parse_ctx(flags);
+		if (comp->ctx == NULL)
+			goto fail;
+	}
+
 	ret = ec_complete_child(node, comp, strvec);
+	ec_parse_ctx_done(comp->ctx);
 	if (ret < 0)
 		goto fail;
 
@@ -162,6 +195,11 @@ fail:
 	return NULL;
 }
 
+struct ec_comp *ec_complete_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_complete_strvec_flags(node, strvec, 0);
+}
+
 struct ec_comp *ec_complete(const struct ec_node *node, const char *str)
 {
 	struct ec_strvec *strvec = NULL;
@@ -588,6 +626,7 @@ void ec_comp_free(struct ec_comp *comp)
 		ec_comp_group_free(grp);
 	}
 	ec_dict_free(comp->attrs);
+	ec_parse_ctx_free(comp->ctx);
 	free(comp);
 }
 
@@ -37,11 +37,22 @@ struct ec_dict {
 	struct ec_htable htable;
 };
 
+static struct ec_dict empty_dict = {
+	.htable = {
+		.list = TAILQ_HEAD_INITIALIZER(empty_dict.htable.list),
+	},
+};
+
 struct ec_dict *ec_dict(void)
 {
 	return (struct ec_dict *)ec_htable();
 }
 
+const struct ec_dict *ec_dict_empty(void)
+{
+	return &empty_dict;
+}
+
 bool ec_dict_has_key(const struct ec_dict *dict, const char *key)
 {
 	return ec_htable_has_key(&dict->htable, key, _strlen(key) + 1);
@@ -64,6 +75,9 @@ int ec_dict_set(struct ec_dict *dict, const char *key, void *val, ec_dict_elt_fr
 
 void ec_dict_free(struct ec_dict *dict)
 {
+	if (dict == NULL)
+		return;
+
 	ec_htable_free(&dict->htable);
 }
 
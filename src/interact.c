@@ -254,20 +254,26 @@ ssize_t ec_interact_get_helps(
 )
 {
 	const struct ec_comp_group *grp, *prev_grp = NULL;
+	struct ec_strvec *line_vec = NULL;
 	struct ec_comp_item *item;
 	struct ec_comp *cmpl = NULL;
-	struct ec_pnode *parse = NULL;
 	unsigned int count = 0;
 	struct ec_interact_help *helps = NULL;
+	int ret;
 
 	*helps_out = NULL;
 
 	/* check if the current line matches */
-	parse = ec_parse(node, line);
-	if (ec_pnode_matches(parse))
+	line_vec = ec_strvec();
+	if (line_vec == NULL)
+		goto fail;
+	if (ec_strvec_add(line_vec, line) < 0)
+		goto fail;
+	ret = ec_parse_matches(node, line_vec);
+	if (ret >= 0 && ret != EC_PARSE_NOMATCH)
 		count = 1;
-	ec_pnode_free(parse);
-	parse = NULL;
+	ec_strvec_free(line_vec);
+	line_vec = NULL;
 
 	/* complete at current cursor position */
 	cmpl = ec_complete(node, line);
@@ -314,7 +320,7 @@ ssize_t ec_interact_get_helps(
 	return count;
 
 fail:
-	ec_pnode_free(parse);
+	ec_strvec_free(line_vec);
 	ec_comp_free(cmpl);
 	if (helps != NULL) {
 		while (count--) {
@@ -335,14 +341,11 @@ ssize_t ec_interact_get_error_helps(
 )
 {
 	struct ec_strvec *line_vec_partial = NULL;
-	const struct ec_strvec *parsed_vec = NULL;
 	struct ec_strvec *line_vec = NULL;
-	struct ec_pnode *parse = NULL;
 	struct ec_comp *comp = NULL;
-	const struct ec_dict *attrs;
 	struct ec_node *cmdlist;
 	char *line_copy = NULL;
-	size_t parsed_vec_len;
+	int parsed_len;
 	int ret = 0;
 	size_t len;
 	int i;
@@ -380,35 +383,24 @@ ssize_t ec_interact_get_error_helps(
 		if (ec_strvec_add(line_vec_partial, "") < 0)
 			goto fail;
 
-		/* try to parse and complete this strvec */
-		parse = ec_parse_strvec(cmdlist, line_vec_partial);
-		if (parse == NULL)
+		/* try to match and complete this strvec */
+		parsed_len = ec_parse_matches(cmdlist, line_vec_partial);
+		if (parsed_len < 0)
 			goto fail;
 		comp = ec_complete_strvec(cmdlist, line_vec_partial);
 		if (comp == NULL)
 			goto fail;
 
-		/* get the length of the parsed vec, if any */
-		parsed_vec = ec_pnode_get_strvec(parse);
-		if (parsed_vec != NULL)
-			parsed_vec_len = ec_strvec_len(parsed_vec);
-		else
-			parsed_vec_len = 0;
-
 		/* if it matches or if it completes, return the helps */
-		if ((ec_pnode_matches(parse) && (int)parsed_vec_len == i)
-		    || ec_comp_count(comp, EC_COMP_ALL) > 0) {
+		if (parsed_len == i || ec_comp_count(comp, EC_COMP_ALL) > 0) {
 			/* get the position of the error and store it in char_idx */
 			if (i == (int)len) {
-				attrs = ec_strvec_get_attrs(line_vec, i - 1);
-				if (attrs == NULL)
+				if (ec_strvec_get_span(line_vec, i - 1, NULL, char_idx) < 0)
 					goto fail;
-				*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_END) + 1;
+				(*char_idx)++;
 			} else {
-				attrs = ec_strvec_get_attrs(line_vec, i);
-				if (attrs == NULL)
+				if (ec_strvec_get_span(line_vec, i, char_idx, NULL) < 0)
 					goto fail;
-				*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_START);
 			}
 
 			/* build the partial line string */
@@ -418,8 +410,6 @@ ssize_t ec_interact_get_error_helps(
 			goto out;
 		}
 
-		ec_pnode_free(parse);
-		parse = NULL;
 		ec_comp_free(comp);
 		comp = NULL;
 		ec_strvec_free(line_vec_partial);
@@ -432,7 +422,6 @@ out:
 	ec_strvec_free(line_vec_partial);
 	ec_strvec_free(line_vec);
 	free(line_copy);
-	ec_pnode_free(parse);
 	ec_comp_free(comp);
 	return ret;
 
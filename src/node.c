@@ -4,22 +4,29 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include <ecoli/atom.h>
 #include <ecoli/config.h>
 #include <ecoli/dict.h>
 #include <ecoli/htable.h>
+#include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_int.h>
 #include <ecoli/node_or.h>
 #include <ecoli/node_seq.h>
 #include <ecoli/node_str.h>
+#include <ecoli/parse.h>
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node);
 
 /* These states are used to mark the grammar graph when freeing, to
@@ -38,9 +45,17 @@ enum ec_node_free_state {
 struct ec_node {
 	const struct ec_node_type *type; /**< The node type. */
 	struct ec_config *config; /**< Node configuration. */
-	char *id; /**< Node identifier (EC_NO_ID if none). */
+	const char *id; /**< Node identifier atom (EC_NO_ID if none). */
 	struct ec_dict *attrs; /**< Attributes of the node. */
 	unsigned int refcnt; /**< Reference counter. */
+	struct ec_node_stats *stats; /**< Profiling counters, allocated on first use. */
+	unsigned int tracked; /**< Number of ec_node_track() calls not undone. */
+	/** Data computed from this node, invalidated when it is reconfigured. */
+	struct {
+		struct ec_node_deps **table;
+		size_t len;
+		size_t size;
+	} deps;
 	struct {
 		enum ec_node_free_state state; /**< State of loop detection. */
 		unsigned int refcnt; /**< Number of reachable references
@@ -50,6 +65,9 @@ struct ec_node {
 
 struct ec_node_type_list node_type_list = TAILQ_HEAD_INITIALIZER(node_type_list);
 
+/* name -> type, built at init, the types registered before are only in the list */
+static struct ec_htable *node_type_table;
+
 static int __ec_node_get_child(
 	const struct ec_node *node,
 	size_t i,
@@ -61,6 +79,14 @@ const struct ec_node_type *ec_node_type_lookup(const char *name)
 {
 	struct ec_node_type *type;
 
+	if (node_type_table != NULL) {
+		type = ec_htable_get(node_type_table, name, strlen(name) + 1);
+		if (type != NULL)
+			return type;
+		errno = ENOENT;
+		return NULL;
+	}
+
 	TAILQ_FOREACH (type, &node_type_list, next) {
 		if (!strcmp(name, type->name))
 			return type;
@@ -77,6 +103,10 @@ int ec_node_type_register(struct ec_node_type *type, bool override)
 		return -1;
 	}
 
+	if (node_type_table != NULL
+	    && ec_htable_set(node_type_table, type->name, strlen(type->name) + 1, type, NULL) < 0)
+		return -1;
+
 	TAILQ_INSERT_HEAD(&node_type_list, type, next);
 
 	return 0;
@@ -107,7 +137,7 @@ struct ec_node *ec_node_from_type(const struct ec_node_type *type, const char *i
 	node->type = type;
 	node->refcnt = 1;
 
-	node->id = strdup(id);
+	node->id = ec_atom_get(id);
 	if (node->id == NULL)
 		goto fail;
 
@@ -125,7 +155,7 @@ struct ec_node *ec_node_from_type(const struct ec_node_type *type, const char *i
 fail:
 	if (node != NULL) {
 		ec_dict_free(node->attrs);
-		free(node->id);
+		ec_atom_put(node->id);
 	}
 	free(node);
 
@@ -181,7 +211,9 @@ static void mark_freeable(struct ec_node *node, enum ec_node_free_state mark)
 	size_t i, n;
 	int ret;
 
-	if (mark == node->free.state)
+	/* a node that is not freeable can be reached again with the
+	 * freeable mark while unwinding a loop: keep it not freeable */
+	if (mark == node->free.state || node->free.state == EC_NODE_FREE_STATE_NOT_FREEABLE)
 		return;
 
 	if (node->refcnt > node->free.refcnt)
@@ -217,6 +249,96 @@ static void reset_mark(struct ec_node *node)
 	}
 }
 
+/*
+ * The nodes do not reference the data computed from them, but a
+ * shared flag telling if it is still valid: the data and the nodes can
+ * be freed in any order.
+ */
+struct ec_node_deps {
+	unsigned int refcnt;
+	bool changed; /* a node was reconfigured, or the data was freed */
+};
+
+static void node_deps_put(struct ec_node_deps *deps)
+{
+	if (--deps->refcnt == 0)
+		free(deps);
+}
+
+struct ec_node_deps *ec_node_deps(void)
+{
+	struct ec_node_deps *deps;
+
+	deps = calloc(1, sizeof(*deps));
+	if (deps == NULL)
+		return NULL;
+	deps->refcnt = 1;
+
+	return deps;
+}
+
+void ec_node_deps_free(struct ec_node_deps *deps)
+{
+	if (deps == NULL)
+		return;
+
+	deps->changed = true;
+	node_deps_put(deps);
+}
+
+int ec_node_deps_add(struct ec_node_deps *deps, const struct ec_node *node)
+{
+	/* the list of a node is not part of its configuration */
+	struct ec_node *n = (struct ec_node *)node;
+	struct ec_node_deps **table;
+	size_t i, j, size;
+
+	if (n->deps.len > 0 && n->deps.table[n->deps.len - 1] == deps)
+		return 0;
+
+	/* forget the data that was freed or invalidated */
+	for (i = 0, j = 0; i < n->deps.len; i++) {
+		if (n->deps.table[i]->changed)
+			node_deps_put(n->deps.table[i]);
+		else
+			n->deps.table[j++] = n->deps.table[i];
+	}
+	n->deps.len = j;
+
+	if (n->deps.len == n->deps.size) {
+		size = n->deps.size == 0 ? 4 : n->deps.size * 2;
+		table = realloc(n->deps.table, size * sizeof(*table));
+		if (table == NULL)
+			return -1;
+		n->deps.table = table;
+		n->deps.size = size;
+	}
+	deps->refcnt++;
+	n->deps.table[n->deps.len++] = deps;
+
+	return 0;
+}
+
+bool ec_node_deps_changed(const struct ec_node_deps *deps)
+{
+	return deps->changed;
+}
+
+/* invalidate the data computed from a node, and forget it */
+static void node_deps_invalidate(struct ec_node *node)
+{
+	size_t i;
+
+	for (i = 0; i < node->deps.len; i++) {
+		node->deps.table[i]->changed = true;
+		node_deps_put(node->deps.table[i]);
+	}
+	free(node->deps.table);
+	node->deps.table = NULL;
+	node->deps.len = 0;
+	node->deps.size = 0;
+}
+
 /* free a node, taking care of loops in the node graph */
 void ec_node_free(struct ec_node *node)
 {
@@ -256,7 +378,7 @@ void ec_node_free(struct ec_node *node)
 		assert(n == 0 || node->type->free_priv != NULL);
 		if (node->type->free_priv != NULL)
 			node->type->free_priv(node);
-		free(node->id);
+		ec_atom_put(node->id);
 		ec_dict_free(node->attrs);
 	}
 
@@ -267,6 +389,8 @@ void ec_node_free(struct ec_node *node)
 	node->free.state = EC_NODE_FREE_STATE_NONE;
 	node->free.refcnt = 0;
 
+	node_deps_invalidate(node);
+	free(node->stats);
 	free(node);
 }
 
@@ -305,6 +429,64 @@ int ec_node_get_child(const struct ec_node *node, size_t i, struct ec_node **chi
 	return __ec_node_get_child(node, i, child, &refs);
 }
 
+int ec_node_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	int ret;
+
+	if (node->type->get_first == NULL || first->depth > EC_NODE_FIRST_MAX_DEPTH)
+		return EC_NODE_FIRST_ANY;
+
+	if (first->deps != NULL && ec_node_deps_add(first->deps, node) < 0)
+		return -1;
+
+	first->depth++;
+	ret = node->type->get_first(node, first);
+	first->depth--;
+
+	return ret;
+}
+
+void ec_node_track(struct ec_node *node)
+{
+	node->tracked++;
+}
+
+void ec_node_untrack(struct ec_node *node)
+{
+	node->tracked--;
+}
+
+bool ec_node_is_tracked(const struct ec_node *node)
+{
+	return node->tracked > 0;
+}
+
+int ec_node_is_pstate_dependent(const struct ec_node *node, struct ec_node_deps *deps)
+{
+	struct ec_node_iter *iter_root, *iter;
+	const struct ec_node *iter_node;
+	int ret = 0;
+
+	iter_root = ec_node_iter((struct ec_node *)node);
+	if (iter_root == NULL)
+		return -1;
+
+	for (iter = iter_root; iter != NULL; iter = ec_node_iter_next(iter_root, iter, true)) {
+		iter_node = ec_node_iter_get_node(iter);
+		if (deps != NULL && ec_node_deps_add(deps, iter_node) < 0) {
+			ret = -1;
+			break;
+		}
+		if (ec_node_type(iter_node)->flags & EC_NODE_TYPE_F_PSTATE_DEPENDENT) {
+			ret = 1;
+			break;
+		}
+	}
+	ec_node_iter_free(iter_root);
+
+	return ret;
+}
+
 int ec_node_set_config(struct ec_node *node, struct ec_config *config)
 {
 	if (node->type->schema == NULL) {
@@ -318,6 +500,10 @@ int ec_node_set_config(struct ec_node *node, struct ec_config *config)
 		goto fail;
 	}
 
+	/* Before set_config(): it can browse the node again through a loop
+	 * of the grammar graph, and the data it computes then depends on
+	 * the new configuration. */
+	node_deps_invalidate(node);
 	if (node->type->set_config(node, config) < 0)
 		goto fail;
 
@@ -336,15 +522,18 @@ const struct ec_config *ec_node_get_config(const struct ec_node *node)
 	return node->config;
 }
 
-struct ec_node *ec_node_find(struct ec_node *node, const char *id)
+struct ec_node *ec_node_find_atom(struct ec_node *node, const char *atom)
 {
 	struct ec_node_iter *iter_root, *iter;
-	struct ec_node *iter_node;
+	struct ec_node *iter_node = NULL;
+
+	if (atom == NULL)
+		return NULL;
 
 	iter_root = ec_node_iter(node);
 	for (iter = iter_root; iter != NULL; iter = ec_node_iter_next(iter_root, iter, true)) {
 		iter_node = ec_node_iter_get_node(iter);
-		if (!strcmp(ec_node_id(iter_node), id))
+		if (ec_node_id(iter_node) == atom)
 			break;
 	}
 	ec_node_iter_free(iter_root);
@@ -355,6 +544,12 @@ struct ec_node *ec_node_find(struct ec_node *node, const char *id)
 	return iter_node;
 }
 
+struct ec_node *ec_node_find(struct ec_node *node, const char *id)
+{
+	/* no node has this id if it is not interned */
+	return ec_node_find_atom(node, ec_atom_lookup(id));
+}
+
 TAILQ_HEAD(ec_node_iter_list, ec_node_iter);
 
 struct ec_node_iter {
@@ -570,6 +765,233 @@ fail:
 	EC_LOG(EC_LOG_ERR, "failed to dump node\n");
 }
 
+bool ec_node_stats_enabled;
+
+/* time spent in the children of the node being profiled */
+static uint64_t stats_children_ns;
+/* allocations done by the children of the node being profiled */
+static uint64_t stats_children_allocs;
+/* allocations done since the profiling is enabled */
+static uint64_t stats_allocs;
+
+static uint64_t stats_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ec_node_stats_enable(bool enable)
+{
+	ec_node_stats_enabled = enable;
+}
+
+void ec_node_stats_count_alloc(void)
+{
+	stats_allocs++;
+}
+
+void ec_node_stats_enter(struct ec_node_stats_probe *probe)
+{
+	probe->children_ns = stats_children_ns;
+	probe->children_allocs = stats_children_allocs;
+	stats_children_ns = 0;
+	stats_children_allocs = 0;
+	probe->start_allocs = stats_allocs;
+	probe->start_ns = stats_now_ns();
+}
+
+void ec_node_stats_leave(
+	const struct ec_node *node,
+	const struct ec_node_stats_probe *probe,
+	enum ec_node_stats_op op,
+	int ret
+)
+{
+	uint64_t elapsed = stats_now_ns() - probe->start_ns;
+	uint64_t allocs = stats_allocs - probe->start_allocs;
+	struct ec_node *n = (struct ec_node *)node;
+	struct ec_node_stats *stats;
+
+	/* the counters are allocated on first use, they are lost on error */
+	if (n->stats == NULL)
+		n->stats = calloc(1, sizeof(*n->stats));
+	stats = n->stats;
+
+	if (stats != NULL) {
+		if (op == EC_NODE_STATS_OP_PARSE) {
+			stats->parse_calls++;
+			if (ret == EC_PARSE_NOMATCH)
+				stats->parse_nomatch++;
+			else if (ret >= 0)
+				stats->parse_match++;
+		} else {
+			stats->complete_calls++;
+		}
+		stats->total_ns += elapsed;
+		stats->self_ns += elapsed - stats_children_ns;
+		stats->allocs += allocs - stats_children_allocs;
+	}
+
+	/* account this call in the children of the parent */
+	stats_children_ns = probe->children_ns + elapsed;
+	stats_children_allocs = probe->children_allocs + allocs;
+}
+
+void ec_node_get_stats(const struct ec_node *node, struct ec_node_stats *stats)
+{
+	if (node->stats == NULL)
+		memset(stats, 0, sizeof(*stats));
+	else
+		*stats = *node->stats;
+}
+
+int ec_node_stats_reset(struct ec_node *node)
+{
+	struct ec_node_iter *iter_root, *iter;
+	struct ec_node *iter_node;
+
+	iter_root = ec_node_iter(node);
+	if (iter_root == NULL)
+		return -1;
+
+	for (iter = iter_root; iter != NULL; iter = ec_node_iter_next(iter_root, iter, true)) {
+		iter_node = ec_node_iter_get_node(iter);
+		free(iter_node->stats);
+		iter_node->stats = NULL;
+	}
+	ec_node_iter_free(iter_root);
+
+	return 0;
+}
+
+static int stats_cmp(const void *p1, const void *p2)
+{
+	const struct ec_node *node1 = *(const struct ec_node *const *)p1;
+	const struct ec_node *node2 = *(const struct ec_node *const *)p2;
+
+	if (node1->stats->self_ns > node2->stats->self_ns)
+		return -1;
+	return node1->stats->self_ns < node2->stats->self_ns;
+}
+
+static void stats_dump_json_str(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (; *str != '\0'; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(out, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(out, "\\u%04x", *str);
+		else
+			fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+static void stats_dump_node(FILE *out, const struct ec_node *node, enum ec_node_stats_format format)
+{
+	const struct ec_node_stats *stats = node->stats;
+
+	if (format == EC_NODE_STATS_TEXT) {
+		fprintf(out,
+			"%12" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %10" PRIu64 " %10" PRIu64 " %-10s %s\n",
+			stats->self_ns,
+			stats->total_ns,
+			stats->parse_calls,
+			stats->parse_match,
+			stats->parse_nomatch,
+			stats->complete_calls,
+			stats->allocs,
+			node->type->name,
+			node->id);
+		return;
+	}
+
+	fprintf(out, "{\"type\": ");
+	stats_dump_json_str(out, node->type->name);
+	fprintf(out, ", \"id\": ");
+	stats_dump_json_str(out, node->id);
+	fprintf(out,
+		", \"self_ns\": %" PRIu64 ", \"total_ns\": %" PRIu64 ", \"parse_calls\": %" PRIu64
+		", \"parse_match\": %" PRIu64 ", \"parse_nomatch\": %" PRIu64
+		", \"complete_calls\": %" PRIu64 ", \"allocs\": %" PRIu64 "}",
+		stats->self_ns,
+		stats->total_ns,
+		stats->parse_calls,
+		stats->parse_match,
+		stats->parse_nomatch,
+		stats->complete_calls,
+		stats->allocs);
+}
+
+int ec_node_stats_dump(FILE *out, const struct ec_node *node, enum ec_node_stats_format format)
+{
+	struct ec_node_iter *iter_root = NULL, *iter;
+	struct ec_node **table = NULL, **tmp;
+	struct ec_node *iter_node;
+	size_t i, len = 0;
+
+	if (format != EC_NODE_STATS_TEXT && format != EC_NODE_STATS_JSON) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	iter_root = ec_node_iter((struct ec_node *)node);
+	if (iter_root == NULL)
+		goto fail;
+
+	for (iter = iter_root; iter != NULL; iter = ec_node_iter_next(iter_root, iter, true)) {
+		iter_node = ec_node_iter_get_node(iter);
+		if (iter_node->stats == NULL)
+			continue;
+		tmp = realloc(table, (len + 1) * sizeof(*table));
+		if (tmp == NULL)
+			goto fail;
+		table = tmp;
+		table[len++] = iter_node;
+	}
+	ec_node_iter_free(iter_root);
+	iter_root = NULL;
+
+	if (len > 1)
+		qsort(table, len, sizeof(*table), stats_cmp);
+
+	if (format == EC_NODE_STATS_TEXT)
+		fprintf(out,
+			"%12s %12s %10s %10s %10s %10s %10s %-10s %s\n",
+			"self_ns",
+			"total_ns",
+			"parse",
+			"match",
+			"nomatch",
+			"complete",
+			"allocs",
+			"type",
+			"id");
+	else
+		fprintf(out, "[");
+
+	for (i = 0; i < len; i++) {
+		if (format == EC_NODE_STATS_JSON)
+			fprintf(out, "%s\n  ", i == 0 ? "" : ",");
+		stats_dump_node(out, table[i], format);
+	}
+
+	if (format == EC_NODE_STATS_JSON)
+		fprintf(out, "%s]\n", len == 0 ? "" : "\n");
+
+	free(table);
+	return 0;
+
+fail:
+	ec_node_iter_free(iter_root);
+	free(table);
+	return -1;
+}
+
 char *ec_node_desc(const struct ec_node *node)
 {
 	char *desc = NULL;
@@ -585,6 +1007,10 @@ char *ec_node_desc(const struct ec_node *node)
 
 int ec_node_check_type(const struct ec_node *node, const struct ec_node_type *type)
 {
+	if (node->type == type)
+		return 0;
+
+	/* the type may have been overridden */
 	if (strcmp(node->type->name, type->name)) {
 		errno = EINVAL;
 		return -1;
@@ -609,3 +1035,40 @@ void ec_node_schema_dump(FILE *out, const struct ec_node *node)
 {
 	ec_config_schema_dump(out, node->type->schema, node->type->name);
 }
+
+/* the last registered type of a name is the first in the list */
+static int ec_node_type_init_func(void)
+{
+	struct ec_node_type *type;
+	struct ec_htable *table;
+
+	table = ec_htable();
+	if (table == NULL)
+		return -1;
+
+	TAILQ_FOREACH_REVERSE (type, &node_type_list, ec_node_type_list, next) {
+		if (ec_htable_set(table, type->name, strlen(type->name) + 1, type, NULL) < 0) {
+			ec_htable_free(table);
+			return -1;
+		}
+	}
+
+	node_type_table = table;
+
+	return 0;
+}
+
+static void ec_node_type_exit_func(void)
+{
+	ec_htable_free(node_type_table);
+	node_type_table = NULL;
+}
+
+/* after the hash table seed initialization */
+static struct ec_init ec_node_type_init = {
+	.init = ec_node_type_init_func,
+	.exit = ec_node_type_exit_func,
+	.priority = 60,
+};
+
+EC_INIT_REGISTER(ec_node_type_init);
@@ -2,6 +2,8 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +21,7 @@ EC_LOG_TYPE_REGISTER(node_any);
 
 struct ec_node_any {
 	char *attr_name;
+	unsigned int kind;
 };
 
 static int ec_node_any_parse(
@@ -34,6 +37,8 @@ static int ec_node_any_parse(
 
 	if (ec_strvec_len(strvec) == 0)
 		return EC_PARSE_NOMATCH;
+	if (priv->kind != 0 && ec_strvec_get_kind(strvec, 0) != priv->kind)
+		return EC_PARSE_NOMATCH;
 	if (priv->attr_name != NULL) {
 		attrs = ec_strvec_get_attrs(strvec, 0);
 		if (attrs == NULL || !ec_dict_has_key(attrs, priv->attr_name))
@@ -43,6 +48,11 @@ static int ec_node_any_parse(
 	return 1;
 }
 
+static int ec_node_any_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_any_parse(node, NULL, strvec);
+}
+
 static void ec_node_any_free_priv(struct ec_node *node)
 {
 	struct ec_node_any *priv = ec_node_priv(node);
@@ -56,6 +66,11 @@ static const struct ec_config_schema ec_node_any_schema[] = {
 		.desc = "The optional attribute name to attach.",
 		.type = EC_CONFIG_TYPE_STRING,
 	},
+	{
+		.key = "kind",
+		.desc = "The optional token kind to match.",
+		.type = EC_CONFIG_TYPE_UINT64,
+	},
 	{
 		.type = EC_CONFIG_TYPE_NONE,
 	},
@@ -65,8 +80,18 @@ static int ec_node_any_set_config(struct ec_node *node, const struct ec_config *
 {
 	struct ec_node_any *priv = ec_node_priv(node);
 	const struct ec_config *value = NULL;
+	unsigned int kind = 0;
 	char *s = NULL;
 
+	value = ec_config_dict_get(config, "kind");
+	if (value != NULL) {
+		if (value->u64 > UINT_MAX) {
+			errno = EINVAL;
+			goto fail;
+		}
+		kind = value->u64;
+	}
+
 	value = ec_config_dict_get(config, "attr");
 	if (value != NULL) {
 		s = strdup(value->string);
@@ -76,6 +101,7 @@ static int ec_node_any_set_config(struct ec_node *node, const struct ec_config *
 
 	free(priv->attr_name);
 	priv->attr_name = s;
+	priv->kind = kind;
 
 	return 0;
 
@@ -89,6 +115,7 @@ static struct ec_node_type ec_node_any_type = {
 	.schema = ec_node_any_schema,
 	.set_config = ec_node_any_set_config,
 	.parse = ec_node_any_parse,
+	.match = ec_node_any_match,
 	.size = sizeof(struct ec_node_any),
 	.free_priv = ec_node_any_free_priv,
 };
@@ -127,3 +154,34 @@ fail:
 	ec_node_free(node);
 	return NULL;
 }
+
+struct ec_node *ec_node_any_kind(const char *id, unsigned int kind)
+{
+	struct ec_config *config = NULL;
+	struct ec_node *node = NULL;
+	int ret;
+
+	node = ec_node_from_type(&ec_node_any_type, id);
+	if (node == NULL)
+		return NULL;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	ret = ec_config_dict_set(config, "kind", ec_config_u64(kind));
+	if (ret < 0)
+		goto fail;
+
+	ret = ec_node_set_config(node, config);
+	config = NULL;
+	if (ret < 0)
+		goto fail;
+
+	return node;
+
+fail:
+	ec_config_free(config);
+	ec_node_free(node);
+	return NULL;
+}
@@ -38,6 +38,18 @@ static int ec_node_bypass_parse(
 	return ec_parse_child(priv->child, pstate, strvec);
 }
 
+static int ec_node_bypass_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	struct ec_node_bypass *priv = ec_node_priv(node);
+
+	if (priv->child == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	return ec_match_child(priv->child, strvec);
+}
+
 static int ec_node_bypass_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -126,6 +138,7 @@ static struct ec_node_type ec_node_bypass_type = {
 	.schema = ec_node_bypass_schema,
 	.set_config = ec_node_bypass_set_config,
 	.parse = ec_node_bypass_parse,
+	.match = ec_node_bypass_match,
 	.complete = ec_node_bypass_complete,
 	.size = sizeof(struct ec_node_bypass),
 	.free_priv = ec_node_bypass_free_priv,
@@ -33,6 +33,9 @@ EC_LOG_TYPE_REGISTER(node_cmd);
 
 static struct ec_node *ec_node_cmd_parser; /* the expression parser. */
 static struct ec_node *ec_node_cmd_expr; /* the expr parser without lexer. */
+static const struct ec_node_type *ec_node_cmd_seq_type;
+static const struct ec_node_type *ec_node_cmd_or_type;
+static const struct ec_node_type *ec_node_cmd_subset_type;
 
 struct ec_node_cmd {
 	char *cmd_str; /* the command string. */
@@ -167,7 +170,7 @@ static int ec_node_cmd_eval_bin_op(
 	}
 
 	if (ec_strvec_len(vec) == 0) {
-		if (!strcmp(ec_node_get_type_name(in1), "seq")) {
+		if (ec_node_type(in1) == ec_node_cmd_seq_type) {
 			if (ec_node_seq_add(in1, ec_node_clone(in2)) < 0)
 				return -1;
 			ec_node_free(in2);
@@ -181,12 +184,12 @@ static int ec_node_cmd_eval_bin_op(
 			*result = out;
 		}
 	} else if (!strcmp(ec_strvec_val(vec, 0), "|")) {
-		if (!strcmp(ec_node_get_type_name(in2), "or")) {
+		if (ec_node_type(in2) == ec_node_cmd_or_type) {
 			if (ec_node_or_add(in2, ec_node_clone(in1)) < 0)
 				return -1;
 			ec_node_free(in1);
 			*result = in2;
-		} else if (!strcmp(ec_node_get_type_name(in1), "or")) {
+		} else if (ec_node_type(in1) == ec_node_cmd_or_type) {
 			if (ec_node_or_add(in1, ec_node_clone(in2)) < 0)
 				return -1;
 			ec_node_free(in2);
@@ -200,12 +203,12 @@ static int ec_node_cmd_eval_bin_op(
 			*result = out;
 		}
 	} else if (!strcmp(ec_strvec_val(vec, 0), ",")) {
-		if (!strcmp(ec_node_get_type_name(in2), "subset")) {
+		if (ec_node_type(in2) == ec_node_cmd_subset_type) {
 			if (ec_node_subset_add(in2, ec_node_clone(in1)) < 0)
 				return -1;
 			ec_node_free(in1);
 			*result = in2;
-		} else if (!strcmp(ec_node_get_type_name(in1), "subset")) {
+		} else if (ec_node_type(in1) == ec_node_cmd_subset_type) {
 			if (ec_node_subset_add(in1, ec_node_clone(in2)) < 0)
 				return -1;
 			ec_node_free(in2);
@@ -547,6 +550,16 @@ static int ec_node_cmd_get_child(
 	return 0;
 }
 
+static int ec_node_cmd_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	struct ec_node_cmd *priv = ec_node_priv(node);
+
+	if (priv->cmd == NULL)
+		return EC_NODE_FIRST_ANY;
+
+	return ec_node_get_first(priv->cmd, first);
+}
+
 static struct ec_node_type ec_node_cmd_type = {
 	.name = "cmd",
 	.schema = ec_node_cmd_schema,
@@ -557,6 +570,7 @@ static struct ec_node_type ec_node_cmd_type = {
 	.free_priv = ec_node_cmd_free_priv,
 	.get_children_count = ec_node_cmd_get_children_count,
 	.get_child = ec_node_cmd_get_child,
+	.get_first = ec_node_cmd_get_first,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_cmd_type);
@@ -609,6 +623,14 @@ fail:
 
 static int ec_node_cmd_init_func(void)
 {
+	/* the types of the nodes built by the expression callbacks */
+	ec_node_cmd_seq_type = ec_node_type_lookup("seq");
+	ec_node_cmd_or_type = ec_node_type_lookup("or");
+	ec_node_cmd_subset_type = ec_node_type_lookup("subset");
+	if (ec_node_cmd_seq_type == NULL || ec_node_cmd_or_type == NULL
+	    || ec_node_cmd_subset_type == NULL)
+		goto fail;
+
 	ec_node_cmd_expr = ec_node_cmd_build_expr();
 	if (ec_node_cmd_expr == NULL)
 		goto fail;
@@ -2,17 +2,19 @@
  * Copyright 2019, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/queue.h>
 
+#include <ecoli/atom.h>
 #include <ecoli/complete.h>
 #include <ecoli/config.h>
 #include <ecoli/dict.h>
-#include <ecoli/htable.h>
 #include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
@@ -30,18 +32,13 @@
 #include <ecoli/parse.h>
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
+#include <ecoli/utils.h>
 
 EC_LOG_TYPE_REGISTER(node_cond);
 
 static struct ec_node *ec_node_cond_parser; /* the expression parser. */
 static struct ec_dict *ec_node_cond_functions; /* functions dictionary */
 
-struct ec_node_cond {
-	char *cond_str; /* the condition string. */
-	struct ec_pnode *parsed_cond; /* the parsed condition. */
-	struct ec_node *child; /* the child node. */
-};
-
 enum cond_result_type {
 	NODESET,
 	BOOLEAN,
@@ -55,48 +52,222 @@ enum cond_result_type {
  * - get/set variable
  */
 
+/* number of pnodes stored in the nodeset structure */
+#define NODESET_LOCAL_SIZE 4
+
+/*
+ * A set of pnodes, sorted by address. The small sets do not need any
+ * allocation. The structure can be copied, it does not point to itself.
+ */
+struct nodeset {
+	size_t len;
+	size_t size; /* size of the allocated table, 0 if the local one is used */
+	const struct ec_pnode **table; /* the allocated table */
+	const struct ec_pnode *local[NODESET_LOCAL_SIZE];
+};
+
+/*
+ * How a value can change when nodes are added to the parsing tree, as
+ * the child of the cond node does after the condition is checked during
+ * completion. Nodesets grow by inclusion, integers are never negative,
+ * and false < true.
+ */
+enum cond_mono {
+	COND_MONO_CONST, /* does not change */
+	COND_MONO_INC, /* can only increase */
+	COND_MONO_DEC, /* can only decrease */
+	COND_MONO_UNKNOWN,
+};
+
 struct cond_result {
 	enum cond_result_type type;
+	enum cond_mono mono; /* how the value can change */
+	enum cond_mono truth_mono; /* how its boolean value can change */
 	union {
-		struct ec_htable *htable;
-		char *str;
+		struct nodeset nodeset;
+		const char *str; /* owned by the instruction */
 		int64_t int64;
 		bool boolean;
 	};
 };
 
-typedef struct cond_result
-	*(cond_func_t)(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len);
+/*
+ * A function of the condition language. The arguments are freed by the
+ * caller, the function may take one of them with cond_result_move().
+ */
+typedef int (cond_func_t)(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+);
+
+/*
+ * Get how the result of a function can change, from its arguments and
+ * its result, and store it in out->mono and out->truth_mono.
+ */
+typedef void (cond_mono_t)(const struct cond_result *in, size_t in_len, struct cond_result *out);
+
+/* A function of the condition language. */
+struct cond_func {
+	const char *name;
+	cond_func_t *eval;
+	cond_mono_t *mono;
+};
+
+/* An instruction: push a constant, or call a function on the stack top. */
+struct cond_insn {
+	const struct cond_func *func; /* the function to call, or NULL to push the value */
+	size_t n_args; /* the number of arguments popped by the function */
+	struct cond_result value; /* the constant, an INT or a STR */
+	char *str; /* the string of a STR constant */
+};
+
+/* A compiled condition, in postfix order. */
+struct cond_prog {
+	struct cond_insn *insns;
+	size_t len;
+	size_t depth; /* size of the stack at the end, only used when compiling */
+	size_t stack_size; /* maximum size of the stack */
+};
+
+/* most conditions do not need a larger stack */
+#define COND_STACK_SIZE 16
+
+struct ec_node_cond {
+	char *cond_str; /* the condition string. */
+	struct cond_prog prog; /* the compiled condition. */
+	struct ec_node *child; /* the child node. */
+};
 
-static void cond_result_free(struct cond_result *res)
+static const struct ec_pnode **nodeset_data(struct nodeset *ns)
 {
-	if (res == NULL)
-		return;
+	return ns->size == 0 ? ns->local : ns->table;
+}
 
-	switch (res->type) {
-	case NODESET:
-		ec_htable_free(res->htable);
-		break;
-	case STR:
-		free(res->str);
-		break;
-	case BOOLEAN:
-	case INT:
-		break;
+static const struct ec_pnode *const *nodeset_const_data(const struct nodeset *ns)
+{
+	return ns->size == 0 ? ns->local : ns->table;
+}
+
+static void nodeset_free(struct nodeset *ns)
+{
+	free(ns->table);
+	ns->table = NULL;
+	ns->size = 0;
+	ns->len = 0;
+}
+
+static int nodeset_append(struct nodeset *ns, const struct ec_pnode *pnode)
+{
+	const struct ec_pnode **table;
+	size_t size;
+
+	if (ns->size == 0 && ns->len == NODESET_LOCAL_SIZE) {
+		size = NODESET_LOCAL_SIZE * 2;
+		table = malloc(size * sizeof(*table));
+		if (table == NULL)
+			return -1;
+		memcpy(table, ns->local, sizeof(ns->local));
+		ns->table = table;
+		ns->size = size;
+	} else if (ns->size != 0 && ns->len == ns->size) {
+		size = ns->size * 2;
+		table = realloc(ns->table, size * sizeof(*table));
+		if (table == NULL)
+			return -1;
+		ns->table = table;
+		ns->size = size;
 	}
 
-	free(res);
+	nodeset_data(ns)[ns->len++] = pnode;
+
+	return 0;
+}
+
+static int pnode_addr_cmp(const void *p1, const void *p2)
+{
+	uintptr_t a1 = (uintptr_t)*(const struct ec_pnode *const *)p1;
+	uintptr_t a2 = (uintptr_t)*(const struct ec_pnode *const *)p2;
+
+	return (a1 > a2) - (a1 < a2);
+}
+
+/* sort a nodeset whose pnodes are distinct */
+static void nodeset_sort(struct nodeset *ns)
+{
+	if (ns->len > 1)
+		qsort(nodeset_data(ns), ns->len, sizeof(struct ec_pnode *), pnode_addr_cmp);
 }
 
-static void cond_result_table_free(struct cond_result **table, size_t len)
+/* add the pnodes of src to dst, in one pass over the sorted tables */
+static int nodeset_merge(struct nodeset *dst, const struct nodeset *src)
 {
+	const struct ec_pnode *const *t1 = nodeset_const_data(dst);
+	const struct ec_pnode *const *t2 = nodeset_const_data(src);
+	struct nodeset res = {0};
+	size_t i = 0, j = 0;
+	int ret = 0;
+
+	while (ret == 0 && (i < dst->len || j < src->len)) {
+		if (j == src->len || (i < dst->len && (uintptr_t)t1[i] < (uintptr_t)t2[j])) {
+			ret = nodeset_append(&res, t1[i++]);
+		} else if (i == dst->len || (uintptr_t)t2[j] < (uintptr_t)t1[i]) {
+			ret = nodeset_append(&res, t2[j++]);
+		} else {
+			ret = nodeset_append(&res, t1[i++]);
+			j++;
+		}
+	}
+	if (ret < 0) {
+		nodeset_free(&res);
+		return -1;
+	}
+
+	nodeset_free(dst);
+	*dst = res;
+
+	return 0;
+}
+
+static bool nodeset_equal(const struct nodeset *ns1, const struct nodeset *ns2)
+{
+	const struct ec_pnode *const *t1 = nodeset_const_data(ns1);
+	const struct ec_pnode *const *t2 = nodeset_const_data(ns2);
 	size_t i;
 
-	for (i = 0; i < len; i++) {
-		cond_result_free(table[i]);
-		table[i] = NULL;
+	if (ns1->len != ns2->len)
+		return false;
+	for (i = 0; i < ns1->len; i++) {
+		if (t1[i] != t2[i])
+			return false;
 	}
-	free(table);
+
+	return true;
+}
+
+static void cond_result_clear(struct cond_result *res)
+{
+	if (res->type == NODESET)
+		nodeset_free(&res->nodeset);
+	res->type = BOOLEAN;
+	res->boolean = false;
+}
+
+static void cond_result_table_clear(struct cond_result *table, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		cond_result_clear(&table[i]);
+}
+
+/* move a result, the source is cleared without being freed */
+static void cond_result_move(struct cond_result *dst, struct cond_result *src)
+{
+	*dst = *src;
+	src->type = BOOLEAN;
+	src->boolean = false;
 }
 
 static struct ec_node *ec_node_cond_build_parser(void)
@@ -201,10 +372,19 @@ fail:
 	return NULL;
 }
 
-static struct cond_result *
-eval_root(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static void nodeset_init(struct cond_result *res)
+{
+	res->type = NODESET;
+	memset(&res->nodeset, 0, sizeof(res->nodeset));
+}
+
+static int eval_root(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
 	const struct ec_pnode *root = NULL;
 
 	(void)in;
@@ -212,70 +392,40 @@ eval_root(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
 	if (in_len != 0) {
 		EC_LOG(LOG_ERR, "root() does not take any argument\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
-	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
+	nodeset_init(out);
 	root = EC_PNODE_GET_ROOT(pstate);
-	if (ec_htable_set(out->htable, &root, sizeof(root), NULL, NULL) < 0)
-		goto fail;
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return nodeset_append(&out->nodeset, root);
 }
 
-static struct cond_result *
-eval_current(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_current(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)in;
 
 	if (in_len != 0) {
 		EC_LOG(LOG_ERR, "current() does not take any argument\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
-	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	if (ec_htable_set(out->htable, &pstate, sizeof(pstate), NULL, NULL) < 0)
-		goto fail;
-
-	cond_result_table_free(in, in_len);
-	return out;
+	nodeset_init(out);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return nodeset_append(&out->nodeset, pstate);
 }
 
 static bool boolean_value(const struct cond_result *res)
 {
 	switch (res->type) {
 	case NODESET:
-		return ec_htable_len(res->htable) > 0;
+		return res->nodeset.len > 0;
 	case BOOLEAN:
 		return res->boolean;
 	case INT:
@@ -287,39 +437,34 @@ static bool boolean_value(const struct cond_result *res)
 	return false;
 }
 
-static struct cond_result *
-eval_bool(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_bool(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)pstate;
 
 	if (in_len != 1) {
 		EC_LOG(LOG_ERR, "bool() takes one argument.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = BOOLEAN;
-	out->boolean = boolean_value(in[0]);
-
-	cond_result_table_free(in, in_len);
-	return out;
+	out->boolean = boolean_value(&in[0]);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_or(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_or(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
 	size_t i;
 
 	(void)pstate;
@@ -327,33 +472,29 @@ eval_or(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
 	if (in_len < 2) {
 		EC_LOG(LOG_ERR, "or() takes at least two arguments\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
 	/* return the first true element, or the last one */
 	for (i = 0; i < in_len; i++) {
-		if (boolean_value(in[i]))
+		if (boolean_value(&in[i]))
 			break;
 	}
 	if (i == in_len)
 		i--;
 
-	out = in[i];
-	in[i] = NULL;
-
-	cond_result_table_free(in, in_len);
-	return out;
+	cond_result_move(out, &in[i]);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_and(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_and(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
 	size_t i;
 
 	(void)pstate;
@@ -361,257 +502,346 @@ eval_and(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
 	if (in_len < 2) {
 		EC_LOG(LOG_ERR, "or() takes at least two arguments\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
 	/* return the first false element, or the last one */
 	for (i = 0; i < in_len; i++) {
-		if (!boolean_value(in[i]))
+		if (!boolean_value(&in[i]))
 			break;
 	}
 	if (i == in_len)
 		i--;
 
-	out = in[i];
-	in[i] = NULL;
-
-	cond_result_table_free(in, in_len);
-	return out;
+	cond_result_move(out, &in[i]);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_first_child(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_first_child(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
-	const struct ec_pnode *const *pparse;
+	const struct ec_pnode *const *table;
 	struct ec_pnode *parse;
+	size_t i;
 
 	(void)pstate;
 
-	if (in_len != 1 || in[0]->type != NODESET) {
+	if (in_len != 1 || in[0].type != NODESET) {
 		EC_LOG(LOG_ERR, "first_child() takes one argument of type nodeset.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
-	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	for (iter = ec_htable_iter(in[0]->htable); iter != NULL; iter = ec_htable_iter_next(iter)) {
-		pparse = ec_htable_iter_get_key(iter);
-		parse = ec_pnode_get_first_child(*pparse);
+	nodeset_init(out);
+	table = nodeset_const_data(&in[0].nodeset);
+	for (i = 0; i < in[0].nodeset.len; i++) {
+		parse = ec_pnode_get_first_child(table[i]);
 		if (parse == NULL)
 			continue;
-		if (ec_htable_set(out->htable, &parse, sizeof(parse), NULL, NULL) < 0)
+		if (nodeset_append(&out->nodeset, parse) < 0)
 			goto fail;
 	}
 
-	cond_result_table_free(in, in_len);
-	return out;
+	/* the parents are distinct, so are their first children */
+	nodeset_sort(&out->nodeset);
+
+	return 0;
 
 fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	cond_result_clear(out);
+	return -1;
 }
 
-static struct cond_result *
-eval_find(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_find(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
-	struct ec_pnode *const *pparse;
+	const struct ec_pnode *const *table;
 	const struct ec_pnode *parse;
+	struct nodeset found = {0};
 	const char *id;
+	size_t i;
 
 	(void)pstate;
 
-	if (in_len != 2 || in[0]->type != NODESET || in[1]->type != STR) {
+	if (in_len != 2 || in[0].type != NODESET || in[1].type != STR) {
 		EC_LOG(LOG_ERR, "find() takes two arguments (nodeset, str).\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
+	nodeset_init(out);
 
-	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
+	/* if the id is not interned, no node has it: the nodeset is empty */
+	id = ec_atom_lookup(in[1].str);
+	if (id == NULL)
+		return 0;
 
-	id = in[1]->str;
-	for (iter = ec_htable_iter(in[0]->htable); iter != NULL; iter = ec_htable_iter_next(iter)) {
-		pparse = ec_htable_iter_get_key(iter);
-		parse = ec_pnode_find(*pparse, id);
+	/* the subtrees may overlap, merge the nodes found in each of them */
+	table = nodeset_const_data(&in[0].nodeset);
+	for (i = 0; i < in[0].nodeset.len; i++) {
+		found.len = 0;
+		parse = ec_pnode_find_atom(table[i], id);
 		while (parse != NULL) {
-			if (ec_htable_set(out->htable, &parse, sizeof(parse), NULL, NULL) < 0)
+			if (nodeset_append(&found, parse) < 0)
 				goto fail;
-			parse = ec_pnode_find_next(*pparse, parse, id, 1);
+			parse = ec_pnode_find_next_atom(table[i], parse, id, 1);
+		}
+		nodeset_sort(&found);
+		if (i == 0) {
+			out->nodeset = found;
+			memset(&found, 0, sizeof(found));
+		} else if (nodeset_merge(&out->nodeset, &found) < 0) {
+			goto fail;
 		}
 	}
+	nodeset_free(&found);
 
-	cond_result_table_free(in, in_len);
-	return out;
+	return 0;
 
 fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	nodeset_free(&found);
+	cond_result_clear(out);
+	return -1;
 }
 
-static struct cond_result *
-eval_cmp(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_cmp(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
 	bool eq = false, gt = false;
 
 	(void)pstate;
 
-	if (in_len != 3 || in[0]->type != STR || in[1]->type != in[2]->type) {
+	if (in_len != 3 || in[0].type != STR || in[1].type != in[2].type) {
 		EC_LOG(LOG_ERR, "cmp() takes 3 arguments (str, <type>, <type>).\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (strcmp(in[0]->str, "eq") && strcmp(in[0]->str, "ne") && strcmp(in[0]->str, "gt")
-	    && strcmp(in[0]->str, "lt") && strcmp(in[0]->str, "ge") && strcmp(in[0]->str, "le")) {
+	if (strcmp(in[0].str, "eq") && strcmp(in[0].str, "ne") && strcmp(in[0].str, "gt")
+	    && strcmp(in[0].str, "lt") && strcmp(in[0].str, "ge") && strcmp(in[0].str, "le")) {
 		EC_LOG(LOG_ERR, "invalid comparison operator in cmp().\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (strcmp(in[0]->str, "eq") && strcmp(in[0]->str, "ne") && in[1]->type != INT) {
+	if (strcmp(in[0].str, "eq") && strcmp(in[0].str, "ne") && in[1].type != INT) {
 		EC_LOG(LOG_ERR, "cmp(gt|lt|ge|le, ...) is only allowed with integers.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (in[1]->type == INT) {
-		eq = in[1]->int64 == in[2]->int64;
-		gt = in[1]->int64 > in[2]->int64;
-	} else if (in[1]->type == NODESET
-		   && ec_htable_len(in[1]->htable) != ec_htable_len(in[2]->htable)) {
-		eq = false;
-	} else if (in[1]->type == NODESET) {
-		eq = true;
-		for (iter = ec_htable_iter(in[1]->htable); iter != NULL;
-		     iter = ec_htable_iter_next(iter)) {
-			if (ec_htable_get(
-				    in[2]->htable,
-				    ec_htable_iter_get_key(iter),
-				    sizeof(struct ec_pnode *)
-			    )
-			    == NULL) {
-				eq = false;
-				break;
-			}
-		}
-	} else if (in[1]->type == STR) {
-		eq = !strcmp(in[1]->str, in[2]->str);
-	} else if (in[1]->type == BOOLEAN) {
-		eq = in[1]->boolean == in[2]->boolean;
+	if (in[1].type == INT) {
+		eq = in[1].int64 == in[2].int64;
+		gt = in[1].int64 > in[2].int64;
+	} else if (in[1].type == NODESET) {
+		eq = nodeset_equal(&in[1].nodeset, &in[2].nodeset);
+	} else if (in[1].type == STR) {
+		eq = !strcmp(in[1].str, in[2].str);
+	} else if (in[1].type == BOOLEAN) {
+		eq = in[1].boolean == in[2].boolean;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = BOOLEAN;
-	if (!strcmp(in[0]->str, "eq"))
+	if (!strcmp(in[0].str, "eq"))
 		out->boolean = eq;
-	else if (!strcmp(in[0]->str, "ne"))
+	else if (!strcmp(in[0].str, "ne"))
 		out->boolean = !eq;
-	else if (!strcmp(in[0]->str, "lt"))
+	else if (!strcmp(in[0].str, "lt"))
 		out->boolean = !gt && !eq;
-	else if (!strcmp(in[0]->str, "gt"))
+	else if (!strcmp(in[0].str, "gt"))
 		out->boolean = gt && !eq;
-	else if (!strcmp(in[0]->str, "le"))
+	else if (!strcmp(in[0].str, "le"))
 		out->boolean = !gt || eq;
-	else if (!strcmp(in[0]->str, "ge"))
+	else if (!strcmp(in[0].str, "ge"))
 		out->boolean = gt || eq;
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_count(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_count(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)pstate;
 
-	if (in_len != 1 || in[0]->type != NODESET) {
+	if (in_len != 1 || in[0].type != NODESET) {
 		EC_LOG(LOG_ERR, "count() takes one argument of type nodeset.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = INT;
-	out->int64 = ec_htable_len(in[0]->htable);
+	out->int64 = in[0].nodeset.len;
 
-	cond_result_table_free(in, in_len);
-	return out;
+	return 0;
+}
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+static void mono_set(struct cond_result *out, enum cond_mono mono)
+{
+	out->mono = mono;
+	out->truth_mono = mono;
 }
 
-static struct cond_result *
-eval_func(const char *name, const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+/* variation of a combination of values that vary in the given ways */
+static enum cond_mono mono_combine(enum cond_mono m1, enum cond_mono m2)
 {
-	cond_func_t *f;
+	if (m1 == COND_MONO_CONST)
+		return m2;
+	if (m2 == COND_MONO_CONST || m1 == m2)
+		return m1;
+	return COND_MONO_UNKNOWN;
+}
 
-	f = ec_dict_get(ec_node_cond_functions, name);
-	if (f == NULL) {
-		EC_LOG(LOG_ERR, "No such function <%s>\n", name);
-		errno = ENOENT;
-		cond_result_table_free(in, in_len);
-		return NULL;
+static enum cond_mono mono_reverse(enum cond_mono m)
+{
+	if (m == COND_MONO_INC)
+		return COND_MONO_DEC;
+	if (m == COND_MONO_DEC)
+		return COND_MONO_INC;
+	return m;
+}
+
+/* root() and current() always return the same pnode */
+static void mono_const(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	(void)in;
+	(void)in_len;
+
+	mono_set(out, COND_MONO_CONST);
+}
+
+static void mono_bool(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	(void)in_len;
+
+	mono_set(out, in[0].truth_mono);
+}
+
+/* or() and and() return one of their arguments */
+static void mono_logic(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	size_t i;
+
+	out->mono = COND_MONO_CONST;
+	out->truth_mono = COND_MONO_CONST;
+	for (i = 0; i < in_len; i++) {
+		if (in[i].mono != COND_MONO_CONST)
+			out->mono = COND_MONO_UNKNOWN;
+		out->truth_mono = mono_combine(out->truth_mono, in[i].truth_mono);
 	}
+}
 
-	return f(pstate, in, in_len);
+/* the subtrees of a nodeset that does not shrink can only get new pnodes */
+static void mono_nodes(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	(void)in_len;
+
+	if (in[0].mono == COND_MONO_CONST || in[0].mono == COND_MONO_INC)
+		mono_set(out, COND_MONO_INC);
+	else
+		mono_set(out, COND_MONO_UNKNOWN);
 }
 
-static struct cond_result *
-eval_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
+static void mono_count(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	(void)in_len;
+
+	mono_set(out, in[0].mono);
+}
+
+static void mono_cmp(const struct cond_result *in, size_t in_len, struct cond_result *out)
+{
+	enum cond_mono diff;
+	bool away;
+
+	(void)in_len;
+
+	/* variation of in[1] - in[2] */
+	diff = mono_combine(in[1].mono, mono_reverse(in[2].mono));
+	if (diff == COND_MONO_CONST || diff == COND_MONO_UNKNOWN) {
+		mono_set(out, diff);
+		return;
+	}
+
+	if (!strcmp(in[0].str, "gt") || !strcmp(in[0].str, "ge")) {
+		mono_set(out, diff);
+		return;
+	}
+	if (!strcmp(in[0].str, "lt") || !strcmp(in[0].str, "le")) {
+		mono_set(out, mono_reverse(diff));
+		return;
+	}
+
+	/* integers that already differ and move away from each other */
+	away = in[1].type == INT
+		&& ((diff == COND_MONO_INC && in[1].int64 > in[2].int64)
+		    || (diff == COND_MONO_DEC && in[1].int64 < in[2].int64));
+	if (!away)
+		mono_set(out, COND_MONO_UNKNOWN);
+	else if (!strcmp(in[0].str, "eq"))
+		mono_set(out, COND_MONO_DEC);
+	else
+		mono_set(out, COND_MONO_INC);
+}
+
+static void cond_prog_free(struct cond_prog *prog)
+{
+	size_t i;
+
+	for (i = 0; i < prog->len; i++)
+		free(prog->insns[i].str);
+	free(prog->insns);
+	memset(prog, 0, sizeof(*prog));
+}
+
+/* append an instruction, and update the maximum size of the stack */
+static int cond_prog_append(struct cond_prog *prog, const struct cond_insn *insn)
+{
+	struct cond_insn *insns;
+
+	insns = realloc(prog->insns, (prog->len + 1) * sizeof(*insns));
+	if (insns == NULL)
+		return -1;
+	prog->insns = insns;
+	prog->insns[prog->len++] = *insn;
+
+	if (insn->func != NULL)
+		prog->depth -= insn->n_args;
+	prog->depth++;
+	if (prog->depth > prog->stack_size)
+		prog->stack_size = prog->depth;
+
+	return 0;
+}
+
+/* compile a parsed expression in postfix order: the arguments, then the call */
+static int compile_condition(struct cond_prog *prog, const struct ec_pnode *cond)
 {
-	const struct ec_pnode *iter;
-	struct cond_result *res = NULL;
-	struct cond_result **args = NULL;
 	const struct ec_pnode *func = NULL, *func_name = NULL, *arg_list = NULL;
 	const struct ec_pnode *value = NULL;
-	const char *id;
-	size_t n_arg = 0;
+	const struct ec_pnode *iter;
+	struct cond_insn insn;
+	const char *id, *name;
+
+	memset(&insn, 0, sizeof(insn));
 
-	/* XXX fix cast (x3) */
-	func = ec_pnode_find((void *)cond, "id_function");
+	func = ec_pnode_find(cond, "id_function");
 	if (func != NULL) {
 		EC_PNODE_FOREACH_CHILD (iter, func) {
 			id = ec_node_id(ec_pnode_get_node(iter));
@@ -621,70 +851,128 @@ eval_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
 				arg_list = iter;
 		}
 
-		iter = ec_pnode_find((void *)arg_list, "id_arg");
+		name = ec_strvec_val(ec_pnode_get_strvec(func_name), 0);
+		insn.func = ec_dict_get(ec_node_cond_functions, name);
+		if (insn.func == NULL) {
+			EC_LOG(LOG_ERR, "No such function <%s>\n", name);
+			errno = ENOENT;
+			return -1;
+		}
+
+		iter = ec_pnode_find(arg_list, "id_arg");
 		while (iter != NULL) {
-			args = realloc(args, (n_arg + 1) * sizeof(*args));
-			args[n_arg] = eval_condition(iter, pstate);
-			if (args[n_arg] == NULL)
-				goto fail;
-			n_arg++;
-			iter = ec_pnode_find_next((void *)arg_list, (void *)iter, "id_arg", 0);
+			if (compile_condition(prog, iter) < 0)
+				return -1;
+			insn.n_args++;
+			iter = ec_pnode_find_next(arg_list, iter, "id_arg", 0);
 		}
 
-		res = eval_func(
-			ec_strvec_val(ec_pnode_get_strvec(func_name), 0), pstate, args, n_arg
-		);
-		args = NULL;
-		return res;
+		return cond_prog_append(prog, &insn);
 	}
 
-	value = ec_pnode_find((void *)cond, "id_value_str");
+	value = ec_pnode_find(cond, "id_value_str");
 	if (value != NULL) {
-		res = malloc(sizeof(*res));
-		if (res == NULL)
-			goto fail;
-		res->type = STR;
-		res->str = strdup(ec_strvec_val(ec_pnode_get_strvec(value), 0));
-		if (res->str == NULL)
-			goto fail;
-		return res;
+		insn.str = strdup(ec_strvec_val(ec_pnode_get_strvec(value), 0));
+		if (insn.str == NULL)
+			return -1;
+		insn.value.type = STR;
+		insn.value.str = insn.str;
+		if (cond_prog_append(prog, &insn) < 0) {
+			free(insn.str);
+			return -1;
+		}
+		return 0;
 	}
 
-	value = ec_pnode_find((void *)cond, "id_value_int");
+	value = ec_pnode_find(cond, "id_value_int");
 	if (value != NULL) {
-		res = malloc(sizeof(*res));
-		if (res == NULL)
-			goto fail;
-		res->type = INT;
+		insn.value.type = INT;
 		if (ec_str_parse_llint(
 			    ec_strvec_val(ec_pnode_get_strvec(value), 0),
 			    0,
 			    LLONG_MIN,
 			    LLONG_MAX,
-			    &res->int64
+			    &insn.value.int64
 		    )
 		    < 0)
-			goto fail;
-		return res;
+			return -1;
+		return cond_prog_append(prog, &insn);
 	}
 
-fail:
-	cond_result_free(res);
-	cond_result_table_free(args, n_arg);
-	return NULL;
+	errno = EINVAL;
+	return -1;
 }
 
-static int validate_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
+static int ec_node_cond_compile(struct cond_prog *prog, const char *cond_str)
 {
-	struct cond_result *res;
+	struct ec_pnode *p;
 	int ret;
 
-	res = eval_condition(cond, pstate);
-	if (res == NULL)
+	memset(prog, 0, sizeof(*prog));
+
+	p = ec_node_cond_build(cond_str);
+	if (p == NULL)
 		return -1;
 
-	ret = boolean_value(res);
-	cond_result_free(res);
+	ret = compile_condition(prog, p);
+	ec_pnode_free(p);
+	if (ret < 0) {
+		cond_prog_free(prog);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Run the program on a stack of results. Only the nodesets are
+ * allocated, unless the stack does not fit in COND_STACK_SIZE. If
+ * truth_mono is not NULL, it is set to how the result can change.
+ */
+static int validate_condition(
+	const struct cond_prog *prog,
+	const struct ec_pnode *pstate,
+	enum cond_mono *truth_mono
+)
+{
+	struct cond_result local_stack[COND_STACK_SIZE];
+	struct cond_result *stack = local_stack;
+	const struct cond_insn *insn;
+	struct cond_result res;
+	size_t i, sp = 0;
+	int ret = -1;
+
+	if (prog->stack_size > COND_STACK_SIZE) {
+		stack = calloc(prog->stack_size, sizeof(*stack));
+		if (stack == NULL)
+			return -1;
+	}
+
+	for (i = 0; i < prog->len; i++) {
+		insn = &prog->insns[i];
+		if (insn->func == NULL) {
+			stack[sp++] = insn->value;
+			continue;
+		}
+		sp -= insn->n_args;
+		ret = insn->func->eval(pstate, &stack[sp], insn->n_args, &res);
+		if (ret == 0)
+			insn->func->mono(&stack[sp], insn->n_args, &res);
+		cond_result_table_clear(&stack[sp], insn->n_args);
+		if (ret < 0)
+			goto out;
+		stack[sp++] = res;
+	}
+
+	assert(sp == 1);
+	ret = boolean_value(&stack[0]);
+	if (truth_mono != NULL)
+		*truth_mono = stack[0].truth_mono;
+
+out:
+	cond_result_table_clear(stack, sp);
+	if (stack != local_stack)
+		free(stack);
 
 	return ret;
 }
@@ -699,16 +987,16 @@ static int ec_node_cond_parse(
 	struct ec_pnode *child;
 	int ret, valid;
 
-	if (priv->child == NULL || priv->parsed_cond == NULL) {
+	if (priv->child == NULL || priv->prog.len == 0) {
 		errno = ENOENT;
 		return -1;
 	}
 
 	ret = ec_parse_child(priv->child, pstate, strvec);
-	if (ret <= 0)
+	if (ret <= 0 || ret == EC_PARSE_NOMATCH)
 		return ret;
 
-	valid = validate_condition(priv->parsed_cond, pstate);
+	valid = validate_condition(&priv->prog, pstate, NULL);
 	if (valid < 0)
 		return valid;
 
@@ -729,14 +1017,24 @@ static int ec_node_cond_complete(
 )
 {
 	struct ec_node_cond *priv = ec_node_priv(node);
+	enum cond_mono truth_mono;
+	int valid;
 
-	if (priv->child == NULL || priv->parsed_cond == NULL) {
+	if (priv->child == NULL || priv->prog.len == 0) {
 		errno = ENOENT;
 		return -1;
 	}
 
-	/* XXX eval condition */
-	/* XXX before or after completing ? configurable ? */
+	/*
+	 * The child is not parsed yet, and its nodes can change the result
+	 * of the condition. If it is false and cannot become true anymore,
+	 * the child would never match: do not complete it.
+	 */
+	valid = validate_condition(&priv->prog, ec_comp_get_cur_pstate(comp), &truth_mono);
+	if (valid < 0)
+		return -1;
+	if (valid == 0 && (truth_mono == COND_MONO_CONST || truth_mono == COND_MONO_DEC))
+		return 0;
 
 	return ec_complete_child(priv->child, comp, strvec);
 }
@@ -747,8 +1045,7 @@ static void ec_node_cond_free_priv(struct ec_node *node)
 
 	free(priv->cond_str);
 	priv->cond_str = NULL;
-	ec_pnode_free(priv->parsed_cond);
-	priv->parsed_cond = NULL;
+	cond_prog_free(&priv->prog);
 	ec_node_free(priv->child);
 }
 
@@ -772,7 +1069,7 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 {
 	struct ec_node_cond *priv = ec_node_priv(node);
 	const struct ec_config *cond = NULL;
-	struct ec_pnode *parsed_cond = NULL;
+	struct cond_prog prog = {0};
 	const struct ec_config *child;
 	char *cond_str = NULL;
 
@@ -790,14 +1087,13 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 	if (child == NULL)
 		goto fail;
 
-	/* parse expression to build the cmd child node */
-	parsed_cond = ec_node_cond_build(cond_str);
-	if (parsed_cond == NULL)
+	/* parse and compile the expression */
+	if (ec_node_cond_compile(&prog, cond_str) < 0)
 		goto fail;
 
 	/* ok, store the config */
-	ec_pnode_free(priv->parsed_cond);
-	priv->parsed_cond = parsed_cond;
+	cond_prog_free(&priv->prog);
+	priv->prog = prog;
 	free(priv->cond_str);
 	priv->cond_str = cond_str;
 	ec_node_free(priv->child);
@@ -806,7 +1102,7 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 	return 0;
 
 fail:
-	ec_pnode_free(parsed_cond);
+	cond_prog_free(&prog);
 	free(cond_str);
 	return -1;
 }
@@ -847,6 +1143,7 @@ static struct ec_node_type ec_node_cond_type = {
 	.free_priv = ec_node_cond_free_priv,
 	.get_children_count = ec_node_cond_get_children_count,
 	.get_child = ec_node_cond_get_child,
+	.flags = EC_NODE_TYPE_F_PSTATE_DEPENDENT,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_cond_type);
@@ -900,13 +1197,22 @@ static void ec_node_cond_exit_func(void)
 	ec_node_cond_functions = NULL;
 }
 
-static int add_func(const char *name, cond_func_t *f)
-{
-	return ec_dict_set(ec_node_cond_functions, name, f, NULL);
-}
+static const struct cond_func cond_functions[] = {
+	{"root", eval_root, mono_const},
+	{"current", eval_current, mono_const},
+	{"bool", eval_bool, mono_bool},
+	{"or", eval_or, mono_logic},
+	{"and", eval_and, mono_logic},
+	{"first_child", eval_first_child, mono_nodes},
+	{"find", eval_find, mono_nodes},
+	{"cmp", eval_cmp, mono_cmp},
+	{"count", eval_count, mono_count},
+};
 
 static int ec_node_cond_init_func(void)
 {
+	size_t i;
+
 	ec_node_cond_parser = ec_node_cond_build_parser();
 	if (ec_node_cond_parser == NULL)
 		goto fail;
@@ -915,24 +1221,16 @@ static int ec_node_cond_init_func(void)
 	if (ec_node_cond_functions == NULL)
 		goto fail;
 
-	if (add_func("root", eval_root) < 0)
-		goto fail;
-	if (add_func("current", eval_current) < 0)
-		goto fail;
-	if (add_func("bool", eval_bool) < 0)
-		goto fail;
-	if (add_func("or", eval_or) < 0)
-		goto fail;
-	if (add_func("and", eval_and) < 0)
-		goto fail;
-	if (add_func("first_child", eval_first_child) < 0)
-		goto fail;
-	if (add_func("find", eval_find) < 0)
-		goto fail;
-	if (add_func("cmp", eval_cmp) < 0)
-		goto fail;
-	if (add_func("count", eval_count) < 0)
-		goto fail;
+	for (i = 0; i < EC_COUNT_OF(cond_functions); i++) {
+		if (ec_dict_set(
+			    ec_node_cond_functions,
+			    cond_functions[i].name,
+			    (void *)&cond_functions[i],
+			    NULL
+		    )
+		    < 0)
+			goto fail;
+	}
 
 	return 0;
 
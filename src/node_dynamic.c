@@ -49,7 +49,7 @@ static int ec_node_dynamic_parse(
 	/* add the node pointer in the attributes, so it will be freed
 	 * when parse is freed */
 	snprintf(key, sizeof(key), "_dyn_%p", child);
-	ret = ec_dict_set(ec_pnode_get_attrs(parse), key, child, (void *)node_free);
+	ret = ec_pnode_set_attr(parse, key, child, (void *)node_free);
 	if (ret < 0) {
 		child = NULL; /* already freed */
 		goto fail;
@@ -106,6 +106,7 @@ static struct ec_node_type ec_node_dynamic_type = {
 	.parse = ec_node_dynamic_parse,
 	.complete = ec_node_dynamic_complete,
 	.size = sizeof(struct ec_node_dynamic),
+	.flags = EC_NODE_TYPE_F_PSTATE_DEPENDENT,
 };
 
 struct ec_node *ec_node_dynamic(const char *id, ec_node_dynamic_build_t build, void *opaque)
@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +15,7 @@
 #include <ecoli/node_many.h>
 #include <ecoli/node_str.h>
 #include <ecoli/parse.h>
+#include <ecoli/regex.h>
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
@@ -26,7 +26,7 @@ struct ec_node_dynlist {
 	void *opaque;
 	enum ec_node_dynlist_flags flags;
 	char *re_str;
-	regex_t re;
+	struct ec_regex *re;
 };
 
 static int ec_node_dynlist_parse(
@@ -39,7 +39,6 @@ static int ec_node_dynlist_parse(
 	struct ec_strvec *names = NULL;
 	const char *name;
 	const char *str;
-	regmatch_t pos;
 	size_t len;
 	size_t i;
 	int ret;
@@ -75,8 +74,7 @@ static int ec_node_dynlist_parse(
 	}
 
 	if (priv->re_str != NULL && priv->flags & DYNLIST_MATCH_REGEXP) {
-		if (regexec(&priv->re, str, 1, &pos, 0) == 0 && pos.rm_so == 0
-		    && pos.rm_eo == (int)strlen(str)) {
+		if (ec_regex_match(priv->re, str)) {
 			ret = 1;
 			goto end;
 		}
@@ -151,10 +149,8 @@ static void ec_node_dynlist_free_priv(struct ec_node *node)
 {
 	struct ec_node_dynlist *priv = ec_node_priv(node);
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
 }
 
 static struct ec_node_type ec_node_dynlist_type = {
@@ -163,6 +159,7 @@ static struct ec_node_type ec_node_dynlist_type = {
 	.complete = ec_node_dynlist_complete,
 	.size = sizeof(struct ec_node_dynlist),
 	.free_priv = ec_node_dynlist_free_priv,
+	.flags = EC_NODE_TYPE_F_PSTATE_DEPENDENT,
 };
 
 struct ec_node *ec_node_dynlist(
@@ -175,8 +172,6 @@ struct ec_node *ec_node_dynlist(
 {
 	struct ec_node *node = NULL;
 	struct ec_node_dynlist *priv;
-	regex_t re;
-	int ret;
 
 	if (get == NULL) {
 		errno = EINVAL;
@@ -192,15 +187,9 @@ struct ec_node *ec_node_dynlist(
 	if (priv->re_str == NULL)
 		goto fail;
 
-	ret = regcomp(&re, re_str, REG_EXTENDED);
-	if (ret != 0) {
-		if (ret == REG_ESPACE)
-			errno = ENOMEM;
-		else
-			errno = EINVAL;
+	priv->re = ec_regex(re_str, 0);
+	if (priv->re == NULL)
 		goto fail;
-	}
-	priv->re = re;
 	priv->get = get;
 	priv->opaque = opaque;
 	priv->flags = flags;
@@ -25,9 +25,15 @@ static int ec_node_empty_parse(
 	return 0;
 }
 
+static int ec_node_empty_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_empty_parse(node, NULL, strvec);
+}
+
 static struct ec_node_type ec_node_empty_type = {
 	.name = "empty",
 	.parse = ec_node_empty_parse,
+	.match = ec_node_empty_match,
 	.size = sizeof(struct ec_node_empty),
 };
 
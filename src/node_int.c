@@ -95,6 +95,11 @@ static int ec_node_int_uint_parse(
 	return 1;
 }
 
+static int ec_node_int_uint_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_int_uint_parse(node, NULL, strvec);
+}
+
 static int ec_node_uint_init_priv(struct ec_node *node)
 {
 	struct ec_node_int_uint *priv = ec_node_priv(node);
@@ -171,6 +176,7 @@ static struct ec_node_type ec_node_int_type = {
 	.schema = ec_node_int_schema,
 	.set_config = ec_node_int_set_config,
 	.parse = ec_node_int_uint_parse,
+	.match = ec_node_int_uint_match,
 	.size = sizeof(struct ec_node_int_uint),
 	.init_priv = ec_node_uint_init_priv,
 };
@@ -281,6 +287,7 @@ static struct ec_node_type ec_node_uint_type = {
 	.schema = ec_node_uint_schema,
 	.set_config = ec_node_uint_set_config,
 	.parse = ec_node_int_uint_parse,
+	.match = ec_node_int_uint_match,
 	.size = sizeof(struct ec_node_int_uint),
 };
 
@@ -17,6 +17,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(node_many);
 
 struct ec_node_many {
@@ -25,6 +27,7 @@ struct ec_node_many {
 	struct ec_node *child;
 };
 
+/* parse the child several times, or only match it if pstate is NULL */
 static int ec_node_many_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -33,7 +36,8 @@ static int ec_node_many_parse(
 {
 	struct ec_node_many *priv = ec_node_priv(node);
 	struct ec_pnode *child_parse;
-	struct ec_strvec *childvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	size_t off = 0, count;
 	int ret;
 
@@ -43,25 +47,24 @@ static int ec_node_many_parse(
 	}
 
 	for (count = 0; priv->max == 0 || count < priv->max; count++) {
-		childvec = ec_strvec_ndup(strvec, off, ec_strvec_len(strvec) - off);
-		if (childvec == NULL)
-			goto fail;
-
-		ret = ec_parse_child(priv->child, pstate, childvec);
+		childvec = ec_strvec_view(&view, strvec, off, ec_strvec_len(strvec) - off);
+		if (pstate != NULL)
+			ret = ec_parse_child(priv->child, pstate, childvec);
+		else
+			ret = ec_match_child(priv->child, childvec);
 		if (ret < 0)
-			goto fail;
-
-		ec_strvec_free(childvec);
-		childvec = NULL;
+			return -1;
 
 		if (ret == EC_PARSE_NOMATCH)
 			break;
 
 		/* it matches an empty strvec, break if priv->max == 0 to avoid an infinite loop */
 		if (ret == 0 && priv->max == 0) {
-			child_parse = ec_pnode_get_last_child(pstate);
-			ec_pnode_unlink_child(child_parse);
-			ec_pnode_free(child_parse);
+			if (pstate != NULL) {
+				child_parse = ec_pnode_get_last_child(pstate);
+				ec_pnode_unlink_child(child_parse);
+				ec_pnode_free(child_parse);
+			}
 			break;
 		}
 
@@ -69,15 +72,17 @@ static int ec_node_many_parse(
 	}
 
 	if (count < priv->min) {
-		ec_pnode_free_children(pstate);
+		if (pstate != NULL)
+			ec_pnode_free_children(pstate);
 		return EC_PARSE_NOMATCH;
 	}
 
 	return off;
+}
 
-fail:
-	ec_strvec_free(childvec);
-	return -1;
+static int ec_node_many_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_many_parse(node, NULL, strvec);
 }
 
 static int ec_node_many_complete(
@@ -88,9 +93,10 @@ static int ec_node_many_complete(
 {
 	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
 	struct ec_node_many *priv = ec_node_priv(node);
-	struct ec_strvec *childvec = NULL;
-	struct ec_strvec *tmpvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	unsigned int children = 0;
+	size_t off = 0;
 	unsigned int i;
 	int ret;
 
@@ -99,11 +105,9 @@ static int ec_node_many_complete(
 		return -1;
 	}
 
-	childvec = ec_strvec_dup(strvec);
-	if (childvec == NULL)
-		goto fail;
-
 	while (1) {
+		childvec = ec_strvec_view(&view, strvec, off, ec_strvec_len(strvec) - off);
+
 		ret = ec_complete_child(priv->child, comp, childvec);
 		if (ret < 0)
 			goto fail;
@@ -125,13 +129,7 @@ static int ec_node_many_complete(
 		if (priv->max == 0 && ret == 0)
 			break;
 
-		tmpvec = ec_strvec_ndup(childvec, ret, ec_strvec_len(childvec) - ret);
-		if (tmpvec == NULL)
-			goto fail;
-
-		ec_strvec_free(childvec);
-		childvec = tmpvec;
-		tmpvec = NULL;
+		off += ret;
 	}
 	ret = 0;
 
@@ -139,9 +137,6 @@ end:
 	for (i = 0; i < children; i++)
 		ec_pnode_del_last_child(parse);
 
-	ec_strvec_free(childvec);
-	ec_strvec_free(tmpvec);
-
 	return ret;
 
 fail:
@@ -252,6 +247,7 @@ static struct ec_node_type ec_node_many_type = {
 	.schema = ec_node_many_schema,
 	.set_config = ec_node_many_set_config,
 	.parse = ec_node_many_parse,
+	.match = ec_node_many_match,
 	.complete = ec_node_many_complete,
 	.size = sizeof(struct ec_node_many),
 	.free_priv = ec_node_many_free_priv,
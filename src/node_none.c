@@ -26,6 +26,11 @@ static int ec_node_none_parse(
 	return EC_PARSE_NOMATCH;
 }
 
+static int ec_node_none_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_none_parse(node, NULL, strvec);
+}
+
 static int ec_node_none_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -42,6 +47,7 @@ static int ec_node_none_complete(
 static struct ec_node_type ec_node_none_type = {
 	.name = "none",
 	.parse = ec_node_none_parse,
+	.match = ec_node_none_match,
 	.complete = ec_node_none_complete,
 	.size = sizeof(struct ec_node_none),
 };
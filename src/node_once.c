@@ -18,29 +18,15 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+#include "parse_private.h"
+
 EC_LOG_TYPE_REGISTER(node_once);
 
 struct ec_node_once {
 	struct ec_node *child;
 };
 
-static unsigned int count_node(struct ec_pnode *parse, const struct ec_node *node)
-{
-	struct ec_pnode *child;
-	unsigned int count = 0;
-
-	if (parse == NULL)
-		return 0;
-
-	if (ec_pnode_get_node(parse) == node)
-		count++;
-
-	EC_PNODE_FOREACH_CHILD (child, parse)
-		count += count_node(child, node);
-
-	return count;
-}
-
 static int ec_node_once_parse(
 	const struct ec_node *node,
 	struct ec_pnode *state,
@@ -48,7 +34,7 @@ static int ec_node_once_parse(
 )
 {
 	struct ec_node_once *priv = ec_node_priv(node);
-	unsigned int count;
+	int count;
 
 	if (priv->child == NULL) {
 		errno = ENOENT;
@@ -58,7 +44,9 @@ static int ec_node_once_parse(
 	/* count the number of occurrences of the node: if already parsed,
 	 * do not match
 	 */
-	count = count_node(ec_pnode_get_root(state), priv->child);
+	count = ec_pnode_count_node(state, priv->child);
+	if (count < 0)
+		return -1;
 	if (count > 0)
 		return EC_PARSE_NOMATCH;
 
@@ -73,7 +61,7 @@ static int ec_node_once_complete(
 {
 	struct ec_node_once *priv = ec_node_priv(node);
 	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
-	unsigned int count;
+	int count;
 	int ret;
 
 	if (priv->child == NULL) {
@@ -84,7 +72,9 @@ static int ec_node_once_complete(
 	/* count the number of occurrences of the node: if already parsed,
 	 * do not match
 	 */
-	count = count_node(ec_pnode_get_root(parse), priv->child);
+	count = ec_pnode_count_node(parse, priv->child);
+	if (count < 0)
+		return -1;
 	if (count > 0)
 		return 0;
 
@@ -99,6 +89,8 @@ static void ec_node_once_free_priv(struct ec_node *node)
 {
 	struct ec_node_once *priv = ec_node_priv(node);
 
+	if (priv->child != NULL)
+		ec_node_untrack(priv->child);
 	ec_node_free(priv->child);
 }
 
@@ -152,9 +144,12 @@ static int ec_node_once_set_config(struct ec_node *node, const struct ec_config
 		goto fail;
 	}
 
-	if (priv->child != NULL)
+	if (priv->child != NULL) {
+		ec_node_untrack(priv->child);
 		ec_node_free(priv->child);
+	}
 	priv->child = ec_node_clone(child->node);
+	ec_node_track(priv->child);
 
 	return 0;
 
@@ -172,6 +167,7 @@ static struct ec_node_type ec_node_once_type = {
 	.free_priv = ec_node_once_free_priv,
 	.get_children_count = ec_node_once_get_children_count,
 	.get_child = ec_node_once_get_child,
+	.flags = EC_NODE_TYPE_F_PSTATE_DEPENDENT,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_once_type);
@@ -36,7 +36,10 @@ static int ec_node_option_parse(
 		return -1;
 	}
 
-	ret = ec_parse_child(priv->child, pstate, strvec);
+	if (pstate != NULL)
+		ret = ec_parse_child(priv->child, pstate, strvec);
+	else
+		ret = ec_match_child(priv->child, strvec);
 	if (ret < 0)
 		return ret;
 
@@ -46,6 +49,11 @@ static int ec_node_option_parse(
 	return ret;
 }
 
+static int ec_node_option_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_option_parse(node, NULL, strvec);
+}
+
 static int ec_node_option_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -129,16 +137,33 @@ fail:
 	return -1;
 }
 
+static int ec_node_option_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	struct ec_node_option *priv = ec_node_priv(node);
+	int ret;
+
+	if (priv->child == NULL)
+		return EC_NODE_FIRST_ANY;
+
+	ret = ec_node_get_first(priv->child, first);
+	if (ret < 0 || ret == EC_NODE_FIRST_ANY)
+		return ret;
+
+	return EC_NODE_FIRST_NULLABLE;
+}
+
 static struct ec_node_type ec_node_option_type = {
 	.name = "option",
 	.schema = ec_node_option_schema,
 	.set_config = ec_node_option_set_config,
 	.parse = ec_node_option_parse,
+	.match = ec_node_option_match,
 	.complete = ec_node_option_complete,
 	.size = sizeof(struct ec_node_option),
 	.free_priv = ec_node_option_free_priv,
 	.get_children_count = ec_node_option_get_children_count,
 	.get_child = ec_node_option_get_child,
+	.get_first = ec_node_option_get_first,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_option_type);
@@ -10,21 +10,220 @@
 
 #include <ecoli/complete.h>
 #include <ecoli/config.h>
+#include <ecoli/htable.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_helper.h>
 #include <ecoli/node_or.h>
 #include <ecoli/node_str.h>
 #include <ecoli/parse.h>
+#include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_or);
 
+/* below this number of children, the dispatch index is not used */
+#define OR_DISPATCH_MIN_CHILDREN 8
+
+/* list of children indexes, in increasing order */
+struct or_idx_list {
+	size_t len;
+	size_t size;
+	unsigned int *idx;
+};
+
+/* a first token of a child of the or node */
+struct or_keyword {
+	const char *str;
+	unsigned int idx;
+};
+
+/*
+ * Index of the children by first token. A child whose first tokens are
+ * all literal is only tried if the first input token is one of them.
+ * The other children are always tried.
+ *
+ * For completion, the first tokens of these children are also sorted,
+ * so the ones starting with the input are found with a binary search.
+ *
+ * The index is built when the node is configured. It is not used
+ * anymore if one of the nodes browsed to build it is reconfigured.
+ */
+struct or_dispatch {
+	struct ec_node_deps *deps; /* changes with the nodes browsed to build it */
+	struct ec_htable *first; /* token -> struct or_idx_list */
+	struct or_idx_list any; /* children that are always tried */
+	struct ec_strvec *tokens; /* first tokens of the other children */
+	struct or_keyword *keywords; /* the same tokens, sorted */
+	size_t keywords_len;
+	size_t keywords_size;
+};
+
 struct ec_node_or {
 	struct ec_node **table;
 	size_t len;
+	struct or_dispatch *dispatch; /* NULL if there are few children */
 };
 
+static int or_idx_list_add(struct or_idx_list *list, unsigned int idx)
+{
+	unsigned int *new_idx;
+	size_t new_size;
+
+	/* the same token may be listed several times for a child */
+	if (list->len > 0 && list->idx[list->len - 1] == idx)
+		return 0;
+
+	if (list->len == list->size) {
+		new_size = list->size == 0 ? 4 : list->size * 2;
+		new_idx = realloc(list->idx, new_size * sizeof(*new_idx));
+		if (new_idx == NULL)
+			return -1;
+		list->idx = new_idx;
+		list->size = new_size;
+	}
+	list->idx[list->len++] = idx;
+
+	return 0;
+}
+
+static void or_idx_list_free(void *ptr)
+{
+	struct or_idx_list *list = ptr;
+
+	free(list->idx);
+	free(list);
+}
+
+static void or_dispatch_free(struct or_dispatch *dispatch)
+{
+	if (dispatch == NULL)
+		return;
+
+	ec_node_deps_free(dispatch->deps);
+	ec_htable_free(dispatch->first);
+	free(dispatch->any.idx);
+	ec_strvec_free(dispatch->tokens);
+	free(dispatch->keywords);
+	free(dispatch);
+}
+
+/* add a first token of a child, stored in dispatch->tokens */
+static int or_dispatch_add(struct or_dispatch *dispatch, const char *token, unsigned int idx)
+{
+	struct or_keyword *keywords;
+	struct or_idx_list *list;
+	size_t key_len = strlen(token) + 1;
+	size_t size;
+
+	list = ec_htable_get(dispatch->first, token, key_len);
+	if (list == NULL) {
+		list = calloc(1, sizeof(*list));
+		if (list == NULL)
+			return -1;
+		if (ec_htable_set(dispatch->first, token, key_len, list, or_idx_list_free) < 0)
+			return -1;
+	}
+	if (or_idx_list_add(list, idx) < 0)
+		return -1;
+
+	if (dispatch->keywords_len == dispatch->keywords_size) {
+		size = dispatch->keywords_size == 0 ? 16 : dispatch->keywords_size * 2;
+		keywords = realloc(dispatch->keywords, size * sizeof(*keywords));
+		if (keywords == NULL)
+			return -1;
+		dispatch->keywords = keywords;
+		dispatch->keywords_size = size;
+	}
+	dispatch->keywords[dispatch->keywords_len].str = token;
+	dispatch->keywords[dispatch->keywords_len].idx = idx;
+	dispatch->keywords_len++;
+
+	return 0;
+}
+
+static int or_keyword_cmp(const void *p1, const void *p2)
+{
+	const struct or_keyword *kw1 = p1, *kw2 = p2;
+	int ret;
+
+	ret = strcmp(kw1->str, kw2->str);
+	if (ret != 0)
+		return ret;
+	if (kw1->idx < kw2->idx)
+		return -1;
+	return kw1->idx > kw2->idx;
+}
+
+static struct or_dispatch *or_dispatch_build(const struct ec_node_or *priv)
+{
+	struct ec_node_first_state first = {0};
+	struct or_dispatch *dispatch = NULL;
+	const char *token;
+	unsigned int i;
+	size_t j, start;
+	int ret;
+
+	dispatch = calloc(1, sizeof(*dispatch));
+	if (dispatch == NULL)
+		goto fail;
+
+	dispatch->deps = ec_node_deps();
+	if (dispatch->deps == NULL)
+		goto fail;
+	first.deps = dispatch->deps;
+	dispatch->first = ec_htable();
+	if (dispatch->first == NULL)
+		goto fail;
+	dispatch->tokens = ec_strvec();
+	if (dispatch->tokens == NULL)
+		goto fail;
+	first.tokens = dispatch->tokens;
+
+	for (i = 0; i < priv->len; i++) {
+		start = ec_strvec_len(dispatch->tokens);
+		ret = ec_node_get_first(priv->table[i], &first);
+		if (ret < 0)
+			goto fail;
+
+		if (ret == EC_NODE_FIRST_LITERAL) {
+			for (j = start; j < ec_strvec_len(dispatch->tokens); j++) {
+				token = ec_strvec_val(dispatch->tokens, j);
+				if (or_dispatch_add(dispatch, token, i) < 0)
+					goto fail;
+			}
+		} else {
+			while (ec_strvec_len(dispatch->tokens) > start)
+				ec_strvec_del_last(dispatch->tokens);
+			if (or_idx_list_add(&dispatch->any, i) < 0)
+				goto fail;
+		}
+	}
+
+	qsort(dispatch->keywords,
+	      dispatch->keywords_len,
+	      sizeof(*dispatch->keywords),
+	      or_keyword_cmp);
+
+	return dispatch;
+
+fail:
+	or_dispatch_free(dispatch);
+	return NULL;
+}
+
+/* get the dispatch index, or NULL if the children must all be tried */
+static const struct or_dispatch *or_dispatch_get(const struct ec_node_or *priv)
+{
+	if (priv->dispatch == NULL || ec_node_deps_changed(priv->dispatch->deps))
+		return NULL;
+
+	return priv->dispatch;
+}
+
+/* parse the first matching child, or only match it if pstate is NULL */
 static int ec_node_or_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -32,11 +231,47 @@ static int ec_node_or_parse(
 )
 {
 	struct ec_node_or *priv = ec_node_priv(node);
-	unsigned int i;
+	const struct or_idx_list *first = NULL, *any;
+	const struct or_dispatch *dispatch;
+	const char *token;
+	size_t i, j;
+	unsigned int n;
 	int ret;
 
-	for (i = 0; i < priv->len; i++) {
-		ret = ec_parse_child(priv->table[i], pstate, strvec);
+	dispatch = or_dispatch_get(priv);
+	if (dispatch == NULL) {
+		for (n = 0; n < priv->len; n++) {
+			if (pstate != NULL)
+				ret = ec_parse_child(priv->table[n], pstate, strvec);
+			else
+				ret = ec_match_child(priv->table[n], strvec);
+			if (ret == EC_PARSE_NOMATCH)
+				continue;
+			return ret;
+		}
+		return EC_PARSE_NOMATCH;
+	}
+
+	any = &dispatch->any;
+	if (ec_strvec_len(strvec) > 0) {
+		token = ec_strvec_val(strvec, 0);
+		first = ec_htable_get(dispatch->first, token, strlen(token) + 1);
+	}
+
+	/* merge the two lists, to keep the order of the children */
+	i = 0;
+	j = 0;
+	while ((first != NULL && i < first->len) || j < any->len) {
+		if (first != NULL && i < first->len
+		    && (j == any->len || first->idx[i] < any->idx[j]))
+			n = first->idx[i++];
+		else
+			n = any->idx[j++];
+
+		if (pstate != NULL)
+			ret = ec_parse_child(priv->table[n], pstate, strvec);
+		else
+			ret = ec_match_child(priv->table[n], strvec);
 		if (ret == EC_PARSE_NOMATCH)
 			continue;
 		return ret;
@@ -45,6 +280,63 @@ static int ec_node_or_parse(
 	return EC_PARSE_NOMATCH;
 }
 
+static int ec_node_or_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_or_parse(node, NULL, strvec);
+}
+
+static int idx_cmp(const void *p1, const void *p2)
+{
+	unsigned int idx1 = *(const unsigned int *)p1;
+	unsigned int idx2 = *(const unsigned int *)p2;
+
+	if (idx1 < idx2)
+		return -1;
+	return idx1 > idx2;
+}
+
+/*
+ * Get the indexes of the children with a literal first token that can
+ * complete the input, in increasing order. They are the ones with a
+ * first token starting with the input token, which are contiguous in
+ * the sorted keyword table.
+ */
+static int or_keywords_lookup(
+	const struct or_dispatch *dispatch,
+	const char *token,
+	struct or_idx_list *list
+)
+{
+	size_t lo = 0, hi = dispatch->keywords_len, mid, i, j;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(dispatch->keywords[mid].str, token) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < dispatch->keywords_len; i++) {
+		if (!ec_str_startswith(dispatch->keywords[i].str, token))
+			break;
+		if (or_idx_list_add(list, dispatch->keywords[i].idx) < 0)
+			return -1;
+	}
+
+	if (list->len > 1) {
+		/* a child can have several first tokens */
+		qsort(list->idx, list->len, sizeof(*list->idx), idx_cmp);
+		for (i = 1, j = 1; i < list->len; i++) {
+			if (list->idx[i] != list->idx[j - 1])
+				list->idx[j++] = list->idx[i];
+		}
+		list->len = j;
+	}
+
+	return 0;
+}
+
 static int ec_node_or_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -52,16 +344,60 @@ static int ec_node_or_complete(
 )
 {
 	struct ec_node_or *priv = ec_node_priv(node);
-	int ret;
-	size_t n;
+	const struct or_idx_list *first = NULL, *any;
+	struct or_idx_list keywords = {0};
+	const struct or_dispatch *dispatch;
+	const char *token;
+	int ret = 0;
+	size_t i, j;
+	unsigned int n;
+
+	dispatch = or_dispatch_get(priv);
+	if (dispatch == NULL || ec_strvec_len(strvec) == 0) {
+		for (n = 0; n < priv->len; n++) {
+			ret = ec_complete_child(priv->table[n], comp, strvec);
+			if (ret < 0)
+				return ret;
+		}
+		return 0;
+	}
+
+	/*
+	 * A child with literal first tokens completes the first input token
+	 * if one of them starts with it. To complete the next tokens, it must
+	 * parse the first one.
+	 */
+	token = ec_strvec_val(strvec, 0);
+	if (ec_strvec_len(strvec) == 1) {
+		if (or_keywords_lookup(dispatch, token, &keywords) < 0)
+			goto fail;
+		first = &keywords;
+	} else {
+		first = ec_htable_get(dispatch->first, token, strlen(token) + 1);
+	}
+
+	/* merge the two lists, to keep the order of the items */
+	any = &dispatch->any;
+	i = 0;
+	j = 0;
+	while ((first != NULL && i < first->len) || j < any->len) {
+		if (first != NULL && i < first->len
+		    && (j == any->len || first->idx[i] < any->idx[j]))
+			n = first->idx[i++];
+		else
+			n = any->idx[j++];
 
-	for (n = 0; n < priv->len; n++) {
 		ret = ec_complete_child(priv->table[n], comp, strvec);
 		if (ret < 0)
-			return ret;
+			goto fail;
 	}
 
+	free(keywords.idx);
 	return 0;
+
+fail:
+	free(keywords.idx);
+	return -1;
 }
 
 static void ec_node_or_free_priv(struct ec_node *node)
@@ -74,6 +410,8 @@ static void ec_node_or_free_priv(struct ec_node *node)
 	free(priv->table);
 	priv->table = NULL;
 	priv->len = 0;
+	or_dispatch_free(priv->dispatch);
+	priv->dispatch = NULL;
 }
 
 static const struct ec_config_schema ec_node_or_subschema[] = {
@@ -102,18 +440,36 @@ static const struct ec_config_schema ec_node_or_schema[] = {
 static int ec_node_or_set_config(struct ec_node *node, const struct ec_config *config)
 {
 	struct ec_node_or *priv = ec_node_priv(node);
-	struct ec_node **table = NULL;
-	size_t i, len = 0;
+	struct ec_node **table = NULL, **old_table;
+	struct or_dispatch *dispatch = NULL;
+	size_t i, len = 0, old_len;
 
 	table = ec_node_config_node_list_to_table(ec_config_dict_get(config, "children"), &len);
 	if (table == NULL)
 		return -1;
 
-	for (i = 0; i < priv->len; i++)
-		ec_node_free(priv->table[i]);
-	free(priv->table);
+	/* the new children are browsed through the node if it is in a loop */
+	old_table = priv->table;
+	old_len = priv->len;
 	priv->table = table;
 	priv->len = len;
+	if (len >= OR_DISPATCH_MIN_CHILDREN) {
+		dispatch = or_dispatch_build(priv);
+		if (dispatch == NULL) {
+			priv->table = old_table;
+			priv->len = old_len;
+			for (i = 0; i < len; i++)
+				ec_node_free(table[i]);
+			free(table);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < old_len; i++)
+		ec_node_free(old_table[i]);
+	free(old_table);
+	or_dispatch_free(priv->dispatch);
+	priv->dispatch = dispatch;
 
 	return 0;
 }
@@ -143,16 +499,35 @@ static int ec_node_or_get_child(
 	return 0;
 }
 
+static int ec_node_or_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	struct ec_node_or *priv = ec_node_priv(node);
+	int ret, result = EC_NODE_FIRST_LITERAL;
+	size_t i;
+
+	for (i = 0; i < priv->len; i++) {
+		ret = ec_node_get_first(priv->table[i], first);
+		if (ret < 0 || ret == EC_NODE_FIRST_ANY)
+			return ret;
+		if (ret == EC_NODE_FIRST_NULLABLE)
+			result = EC_NODE_FIRST_NULLABLE;
+	}
+
+	return result;
+}
+
 static struct ec_node_type ec_node_or_type = {
 	.name = "or",
 	.schema = ec_node_or_schema,
 	.set_config = ec_node_or_set_config,
 	.parse = ec_node_or_parse,
+	.match = ec_node_or_match,
 	.complete = ec_node_or_complete,
 	.size = sizeof(struct ec_node_or),
 	.free_priv = ec_node_or_free_priv,
 	.get_children_count = ec_node_or_get_children_count,
 	.get_child = ec_node_or_get_child,
+	.get_first = ec_node_or_get_first,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_or_type);
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ec_node;
+
+/*
+ * The validity of data computed from a part of a grammar graph, like an
+ * index built when a node is configured. It changes when one of the
+ * nodes added to it is reconfigured, so that the data is not used
+ * anymore. Checking it is cheap, and does not modify the grammar.
+ */
+struct ec_node_deps *ec_node_deps(void);
+void ec_node_deps_free(struct ec_node_deps *deps);
+
+/* Add a node from which the data is computed. */
+int ec_node_deps_add(struct ec_node_deps *deps, const struct ec_node *node);
+
+/* Check if one of the added nodes was reconfigured since it was added. */
+bool ec_node_deps_changed(const struct ec_node_deps *deps);
+
+/*
+ * Count the occurrences of a node in the parsing trees as they are
+ * built, so that ec_pnode_count_node() does not need to walk the tree.
+ * Each call to ec_node_track() must be undone by ec_node_untrack(). The
+ * tracking must not change while parsing trees of the node exist.
+ */
+void ec_node_track(struct ec_node *node);
+void ec_node_untrack(struct ec_node *node);
+
+/* Check if the occurrences of a node are counted, see ec_node_track(). */
+bool ec_node_is_tracked(const struct ec_node *node);
+
+/*
+ * Check if the parsing of a node or of one of its descendants depends on
+ * the parsing state. Return 1 if true, 0 if false, or -1 on error. If
+ * deps is not NULL, the browsed nodes are added to it.
+ */
+int ec_node_is_pstate_dependent(const struct ec_node *node, struct ec_node_deps *deps);
+
+/* True when the profiling counters are enabled, see ec_node_stats_enable(). */
+extern bool ec_node_stats_enabled;
+
+/* The profiled operations. */
+enum ec_node_stats_op {
+	EC_NODE_STATS_OP_PARSE,
+	EC_NODE_STATS_OP_COMPLETE,
+};
+
+/* State saved by ec_node_stats_enter(), restored by ec_node_stats_leave(). */
+struct ec_node_stats_probe {
+	uint64_t start_ns;
+	uint64_t start_allocs;
+	uint64_t children_ns; /* time spent in the previous siblings */
+	uint64_t children_allocs; /* allocations done by the previous siblings */
+};
+
+/* Start profiling a call to a node. */
+void ec_node_stats_enter(struct ec_node_stats_probe *probe);
+
+/*
+ * Stop profiling a call to a node, and update its counters. The ret
+ * argument is the return value of the parse or complete method.
+ */
+void ec_node_stats_leave(
+	const struct ec_node *node,
+	const struct ec_node_stats_probe *probe,
+	enum ec_node_stats_op op,
+	int ret
+);
+
+/* Count an allocation of the parsing tree, when profiling. */
+void ec_node_stats_count_alloc(void);
@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,13 +13,14 @@
 #include <ecoli/node.h>
 #include <ecoli/node_re.h>
 #include <ecoli/parse.h>
+#include <ecoli/regex.h>
 #include <ecoli/strvec.h>
 
 EC_LOG_TYPE_REGISTER(node_re);
 
 struct ec_node_re {
 	char *re_str;
-	regex_t re;
+	struct ec_regex *re;
 };
 
 static int ec_node_re_parse(
@@ -30,8 +30,6 @@ static int ec_node_re_parse(
 )
 {
 	struct ec_node_re *priv = ec_node_priv(node);
-	const char *str;
-	regmatch_t pos;
 
 	(void)pstate;
 
@@ -43,23 +41,23 @@ static int ec_node_re_parse(
 	if (ec_strvec_len(strvec) == 0)
 		return EC_PARSE_NOMATCH;
 
-	str = ec_strvec_val(strvec, 0);
-	if (regexec(&priv->re, str, 1, &pos, 0) != 0)
-		return EC_PARSE_NOMATCH;
-	if (pos.rm_so != 0 || pos.rm_eo != (int)strlen(str))
+	if (!ec_regex_match(priv->re, ec_strvec_val(strvec, 0)))
 		return EC_PARSE_NOMATCH;
 
 	return 1;
 }
 
+static int ec_node_re_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_re_parse(node, NULL, strvec);
+}
+
 static void ec_node_re_free_priv(struct ec_node *node)
 {
 	struct ec_node_re *priv = ec_node_priv(node);
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
 }
 
 static const struct ec_config_schema ec_node_re_schema[] = {
@@ -77,9 +75,8 @@ static int ec_node_re_set_config(struct ec_node *node, const struct ec_config *c
 {
 	struct ec_node_re *priv = ec_node_priv(node);
 	const struct ec_config *value = NULL;
+	struct ec_regex *re = NULL;
 	char *s = NULL;
-	regex_t re;
-	int ret;
 
 	value = ec_config_dict_get(config, "pattern");
 	if (value == NULL) {
@@ -91,19 +88,12 @@ static int ec_node_re_set_config(struct ec_node *node, const struct ec_config *c
 	if (s == NULL)
 		goto fail;
 
-	ret = regcomp(&re, s, REG_EXTENDED);
-	if (ret != 0) {
-		if (ret == REG_ESPACE)
-			errno = ENOMEM;
-		else
-			errno = EINVAL;
+	re = ec_regex(s, 0);
+	if (re == NULL)
 		goto fail;
-	}
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
 	priv->re_str = s;
 	priv->re = re;
 
@@ -119,6 +109,7 @@ static struct ec_node_type ec_node_re_type = {
 	.schema = ec_node_re_schema,
 	.set_config = ec_node_re_set_config,
 	.parse = ec_node_re_parse,
+	.match = ec_node_re_match,
 	.size = sizeof(struct ec_node_re),
 	.free_priv = ec_node_re_free_priv,
 };
@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,6 +19,7 @@
 #include <ecoli/node_re_lex.h>
 #include <ecoli/node_str.h>
 #include <ecoli/parse.h>
+#include <ecoli/regex.h>
 #include <ecoli/strvec.h>
 
 EC_LOG_TYPE_REGISTER(node_re_lex);
@@ -27,7 +27,6 @@ EC_LOG_TYPE_REGISTER(node_re_lex);
 struct regexp_pattern {
 	char *pattern;
 	char *attr_name;
-	regex_t r;
 	bool keep;
 };
 
@@ -35,18 +34,18 @@ struct ec_node_re_lex {
 	struct ec_node *child;
 	struct regexp_pattern *table;
 	size_t len;
+	struct ec_regex *lexer; /* all the patterns, by order of priority */
 };
 
-static struct ec_strvec *tokenize(struct regexp_pattern *table, size_t table_len, const char *str)
+static struct ec_strvec *
+tokenize(const struct ec_regex *lexer, const struct regexp_pattern *table, const char *str)
 {
 	struct ec_strvec *strvec = NULL;
 	struct ec_dict *attrs = NULL;
 	char *dup = NULL;
 	char c;
 	size_t len, off = 0;
-	size_t i;
-	int ret = 0;
-	regmatch_t pos = {0};
+	size_t i, match_len;
 
 	dup = strdup(str);
 	if (dup == NULL)
@@ -58,23 +57,20 @@ static struct ec_strvec *tokenize(struct regexp_pattern *table, size_t table_len
 
 	len = strlen(dup);
 	while (off < len) {
-		for (i = 0; i < table_len; i++) {
-			ret = regexec(&table[i].r, &dup[off], 1, &pos, 0);
-			if (ret != 0)
-				continue;
-			if (pos.rm_so != 0 || pos.rm_eo == 0) {
-				ret = -1;
-				continue;
-			}
-
-			if (table[i].keep == 0)
-				break;
+		if (!ec_regex_match_token(lexer, &dup[off], &i, &match_len)) {
+			errno = EINVAL;
+			goto fail;
+		}
 
-			c = dup[pos.rm_eo + off];
-			dup[pos.rm_eo + off] = '\0';
+		if (table[i].keep) {
+			c = dup[match_len + off];
+			dup[match_len + off] = '\0';
 			EC_LOG(EC_LOG_DEBUG, "re_lex match <%s>\n", &dup[off]);
 			if (ec_strvec_add(strvec, &dup[off]) < 0)
 				goto fail;
+			dup[match_len + off] = c;
+			if (ec_strvec_set_kind(strvec, ec_strvec_len(strvec) - 1, i + 1) < 0)
+				goto fail;
 
 			if (table[i].attr_name != NULL) {
 				attrs = ec_dict();
@@ -89,15 +85,9 @@ static struct ec_strvec *tokenize(struct regexp_pattern *table, size_t table_len
 				}
 				attrs = NULL;
 			}
-
-			dup[pos.rm_eo + off] = c;
-			break;
 		}
 
-		if (ret != 0)
-			goto fail;
-
-		off += pos.rm_eo;
+		off += match_len;
 	}
 
 	free(dup);
@@ -130,7 +120,7 @@ static int ec_node_re_lex_parse(
 		new_vec = ec_strvec();
 	} else {
 		str = ec_strvec_val(strvec, 0);
-		new_vec = tokenize(priv->table, priv->len, str);
+		new_vec = tokenize(priv->lexer, priv->table, str);
 	}
 	if (new_vec == NULL)
 		goto fail;
@@ -167,10 +157,10 @@ static void ec_node_re_lex_free_priv(struct ec_node *node)
 	for (i = 0; i < priv->len; i++) {
 		free(priv->table[i].pattern);
 		free(priv->table[i].attr_name);
-		regfree(&priv->table[i].r);
 	}
 
 	free(priv->table);
+	ec_regex_free(priv->lexer);
 }
 
 static size_t ec_node_re_lex_get_children_count(const struct ec_node *node)
@@ -249,14 +239,42 @@ static const struct ec_config_schema ec_node_re_lex_schema[] = {
 	},
 };
 
+/*
+ * Log the error of a failed compilation of all the patterns. If one is
+ * invalid, it is found by compiling them one by one. errno is preserved.
+ */
+static void re_lex_log_error(const struct regexp_pattern *table, size_t n)
+{
+	struct ec_regex *re;
+	int err = errno;
+	size_t i;
+
+	for (i = 0; err == EINVAL && i < n; i++) {
+		re = ec_regex(table[i].pattern, 0);
+		if (re == NULL && errno == EINVAL) {
+			EC_LOG(EC_LOG_ERR,
+			       "Regular expression <%s> compilation failed: %s\n",
+			       table[i].pattern,
+			       strerror(err));
+			errno = err;
+			return;
+		}
+		ec_regex_free(re);
+	}
+
+	EC_LOG(EC_LOG_ERR, "Regular expressions compilation failed: %s\n", strerror(err));
+	errno = err;
+}
+
 static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_config *config)
 {
 	struct ec_node_re_lex *priv = ec_node_priv(node);
 	struct regexp_pattern *table = NULL;
 	const struct ec_config *patterns, *child, *elt, *pattern, *keep, *attr;
 	char *pattern_str = NULL, *attr_name = NULL;
+	struct ec_regex *lexer = NULL;
+	const char **strs = NULL;
 	ssize_t i, n = 0;
-	int ret;
 
 	child = ec_config_dict_get(config, "child");
 	if (child == NULL)
@@ -313,19 +331,6 @@ static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_confi
 				if (attr_name == NULL)
 					goto fail;
 			}
-
-			ret = regcomp(&table[n].r, pattern_str, REG_EXTENDED);
-			if (ret != 0) {
-				EC_LOG(EC_LOG_ERR,
-				       "Regular expression <%s> compilation failed: %d\n",
-				       pattern_str,
-				       ret);
-				if (ret == REG_ESPACE)
-					errno = ENOMEM;
-				else
-					errno = EINVAL;
-				goto fail;
-			}
 			table[n].pattern = pattern_str;
 			table[n].keep = keep->boolean;
 			table[n].attr_name = attr_name;
@@ -336,31 +341,45 @@ static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_confi
 		}
 	}
 
+	/* tokenize with a single automaton for all the patterns */
+	if (n > 0) {
+		strs = calloc(n, sizeof(*strs));
+		if (strs == NULL)
+			goto fail;
+		for (i = 0; i < n; i++)
+			strs[i] = table[i].pattern;
+		lexer = ec_regex_list(strs, n, 0);
+		if (lexer == NULL) {
+			re_lex_log_error(table, n);
+			goto fail;
+		}
+		free(strs);
+	}
+
 	if (priv->child != NULL)
 		ec_node_free(priv->child);
 	priv->child = ec_node_clone(child->node);
 	for (i = 0; i < (ssize_t)priv->len; i++) {
 		free(priv->table[i].pattern);
 		free(priv->table[i].attr_name);
-		regfree(&priv->table[i].r);
 	}
 	free(priv->table);
+	ec_regex_free(priv->lexer);
 	priv->table = table;
 	priv->len = n;
+	priv->lexer = lexer;
 
 	return 0;
 
 fail:
 	if (table != NULL) {
 		for (i = 0; i < n; i++) {
-			if (table[i].pattern != NULL) {
-				free(table[i].pattern);
-				free(table[i].attr_name);
-				regfree(&table[i].r);
-			}
+			free(table[i].pattern);
+			free(table[i].attr_name);
 		}
 	}
 	free(table);
+	free(strs);
 	free(pattern_str);
 	free(attr_name);
 	return -1;
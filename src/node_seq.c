@@ -21,6 +21,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(node_seq);
 
 struct ec_node_seq {
@@ -28,6 +30,7 @@ struct ec_node_seq {
 	size_t len;
 };
 
+/* parse the children in sequence, or only match them if pstate is NULL */
 static int ec_node_seq_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -35,25 +38,24 @@ static int ec_node_seq_parse(
 )
 {
 	struct ec_node_seq *priv = ec_node_priv(node);
-	struct ec_strvec *childvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	size_t len = 0;
 	unsigned int i;
 	int ret;
 
 	for (i = 0; i < priv->len; i++) {
-		childvec = ec_strvec_ndup(strvec, len, ec_strvec_len(strvec) - len);
-		if (childvec == NULL)
-			goto fail;
-
-		ret = ec_parse_child(priv->table[i], pstate, childvec);
+		childvec = ec_strvec_view(&view, strvec, len, ec_strvec_len(strvec) - len);
+		if (pstate != NULL)
+			ret = ec_parse_child(priv->table[i], pstate, childvec);
+		else
+			ret = ec_match_child(priv->table[i], childvec);
 		if (ret < 0)
-			goto fail;
-
-		ec_strvec_free(childvec);
-		childvec = NULL;
+			return -1;
 
 		if (ret == EC_PARSE_NOMATCH) {
-			ec_pnode_free_children(pstate);
+			if (pstate != NULL)
+				ec_pnode_free_children(pstate);
 			return EC_PARSE_NOMATCH;
 		}
 
@@ -61,10 +63,11 @@ static int ec_node_seq_parse(
 	}
 
 	return len;
+}
 
-fail:
-	ec_strvec_free(childvec);
-	return -1;
+static int ec_node_seq_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_seq_parse(node, NULL, strvec);
 }
 
 static int __ec_node_seq_complete(
@@ -75,7 +78,8 @@ static int __ec_node_seq_complete(
 )
 {
 	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
-	struct ec_strvec *childvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	unsigned int i;
 	int ret;
 
@@ -96,21 +100,15 @@ static int __ec_node_seq_complete(
 	/* first, try to complete with the first node of the table */
 	ret = ec_complete_child(table[0], comp, strvec);
 	if (ret < 0)
-		goto fail;
+		return -1;
 
 	/* then, if the first node of the table matches the beginning of the
 	 * strvec, try to complete the rest */
 	for (i = 0; i < ec_strvec_len(strvec); i++) {
-		childvec = ec_strvec_ndup(strvec, 0, i);
-		if (childvec == NULL)
-			goto fail;
-
+		childvec = ec_strvec_view(&view, strvec, 0, i);
 		ret = ec_parse_child(table[0], parse, childvec);
 		if (ret < 0)
-			goto fail;
-
-		ec_strvec_free(childvec);
-		childvec = NULL;
+			return -1;
 
 		if ((unsigned int)ret != i) {
 			if (ret != EC_PARSE_NOMATCH)
@@ -118,26 +116,14 @@ static int __ec_node_seq_complete(
 			continue;
 		}
 
-		childvec = ec_strvec_ndup(strvec, i, ec_strvec_len(strvec) - i);
-		if (childvec == NULL) {
-			ec_pnode_del_last_child(parse);
-			goto fail;
-		}
-
+		childvec = ec_strvec_view(&view, strvec, i, ec_strvec_len(strvec) - i);
 		ret = __ec_node_seq_complete(&table[1], table_len - 1, comp, childvec);
 		ec_pnode_del_last_child(parse);
-		ec_strvec_free(childvec);
-		childvec = NULL;
-
 		if (ret < 0)
-			goto fail;
+			return -1;
 	}
 
 	return 0;
-
-fail:
-	ec_strvec_free(childvec);
-	return -1;
 }
 
 static int ec_node_seq_complete(
@@ -229,16 +215,35 @@ static int ec_node_seq_get_child(
 	return 0;
 }
 
+static int ec_node_seq_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	struct ec_node_seq *priv = ec_node_priv(node);
+	size_t i;
+	int ret;
+
+	/* the first tokens of the children are added until one of them
+	 * cannot match an empty input */
+	for (i = 0; i < priv->len; i++) {
+		ret = ec_node_get_first(priv->table[i], first);
+		if (ret != EC_NODE_FIRST_NULLABLE)
+			return ret;
+	}
+
+	return EC_NODE_FIRST_NULLABLE;
+}
+
 static struct ec_node_type ec_node_seq_type = {
 	.name = "seq",
 	.schema = ec_node_seq_schema,
 	.set_config = ec_node_seq_set_config,
 	.parse = ec_node_seq_parse,
+	.match = ec_node_seq_match,
 	.complete = ec_node_seq_complete,
 	.size = sizeof(struct ec_node_seq),
 	.free_priv = ec_node_seq_free_priv,
 	.get_children_count = ec_node_seq_get_children_count,
 	.get_child = ec_node_seq_get_child,
+	.get_first = ec_node_seq_get_first,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_seq_type);
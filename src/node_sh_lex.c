@@ -26,6 +26,7 @@ struct ec_node_sh_lex {
 	bool expand;
 };
 
+/* parse the child on the lexed input, or only match it if pstate is NULL */
 static int ec_node_sh_lex_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -63,16 +64,21 @@ static int ec_node_sh_lex_parse(
 		new_vec = exp;
 	}
 
-	ret = ec_parse_child(priv->child, pstate, new_vec);
+	if (pstate != NULL)
+		ret = ec_parse_child(priv->child, pstate, new_vec);
+	else
+		ret = ec_match_child(priv->child, new_vec);
 	if (ret < 0)
 		goto fail;
 
 	if ((unsigned)ret == ec_strvec_len(new_vec)) {
 		ret = 1;
 	} else if (ret != EC_PARSE_NOMATCH) {
-		child_parse = ec_pnode_get_last_child(pstate);
-		ec_pnode_unlink_child(child_parse);
-		ec_pnode_free(child_parse);
+		if (pstate != NULL) {
+			child_parse = ec_pnode_get_last_child(pstate);
+			ec_pnode_unlink_child(child_parse);
+			ec_pnode_free(child_parse);
+		}
 		ret = EC_PARSE_NOMATCH;
 	}
 
@@ -86,6 +92,11 @@ fail:
 	return -1;
 }
 
+static int ec_node_sh_lex_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_sh_lex_parse(node, NULL, strvec);
+}
+
 static int ec_node_sh_lex_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -229,6 +240,7 @@ static int ec_node_sh_lex_get_child(
 static struct ec_node_type ec_node_sh_lex_type = {
 	.name = "sh_lex",
 	.parse = ec_node_sh_lex_parse,
+	.match = ec_node_sh_lex_match,
 	.complete = ec_node_sh_lex_complete,
 	.size = sizeof(struct ec_node_sh_lex),
 	.free_priv = ec_node_sh_lex_free_priv,
@@ -42,9 +42,15 @@ static int ec_node_space_parse(
 	return 1;
 }
 
+static int ec_node_space_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_space_parse(node, NULL, strvec);
+}
+
 static struct ec_node_type ec_node_space_type = {
 	.name = "space",
 	.parse = ec_node_space_parse,
+	.match = ec_node_space_match,
 	.size = sizeof(struct ec_node_space),
 };
 
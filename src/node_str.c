@@ -49,6 +49,11 @@ static int ec_node_str_parse(
 	return 1;
 }
 
+static int ec_node_str_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_node_str_parse(node, NULL, strvec);
+}
+
 static int ec_node_str_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -130,15 +135,30 @@ fail:
 	return -1;
 }
 
+static int ec_node_str_get_first(const struct ec_node *node, struct ec_node_first_state *first)
+{
+	struct ec_node_str *priv = ec_node_priv(node);
+
+	if (priv->string == NULL)
+		return EC_NODE_FIRST_ANY;
+
+	if (ec_strvec_add(first->tokens, priv->string) < 0)
+		return -1;
+
+	return EC_NODE_FIRST_LITERAL;
+}
+
 static struct ec_node_type ec_node_str_type = {
 	.name = "str",
 	.schema = ec_node_str_schema,
 	.set_config = ec_node_str_set_config,
 	.parse = ec_node_str_parse,
+	.match = ec_node_str_match,
 	.complete = ec_node_str_complete,
 	.desc = ec_node_str_desc,
 	.size = sizeof(struct ec_node_str),
 	.free_priv = ec_node_str_free_priv,
+	.get_first = ec_node_str_get_first,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_str_type);
@@ -6,31 +6,404 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <ecoli/complete.h>
+#include <ecoli/config.h>
+#include <ecoli/htable.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
+#include <ecoli/node_helper.h>
 #include <ecoli/node_or.h>
 #include <ecoli/node_str.h>
 #include <ecoli/node_subset.h>
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(node_subset);
 
 struct ec_node_subset {
 	struct ec_node **table;
 	unsigned int len;
+	bool dependent; /* a child depends on the parsing state */
+	struct ec_node_deps *deps; /* changes with the descendants */
 };
 
 struct parse_result {
 	size_t parse_len; /* number of parsed nodes */
 	size_t len; /* consumed strings */
+	int first; /* index of the first parsed node, or -1 */
+};
+
+/* a set of children that are not used yet, and an offset in the input */
+struct subset_key {
+	size_t off;
+	uint8_t mask[]; /* bit i is set if child i is not used */
+};
+
+#define MATCH_UNKNOWN -2
+
+/* state of the memoized parsing or completion */
+struct subset_ctx {
+	struct ec_node **table;
+	size_t len;
+	const struct ec_strvec *strvec;
+	size_t strvec_len;
+	struct ec_pnode *pstate; /* NULL when only matching */
+	int *match; /* result of child i at offset off, at [i * (strvec_len + 1) + off] */
+	struct ec_pnode **pnodes; /* parsing node of these results, when parsing */
+	struct ec_htable *memo; /* struct subset_key -> struct parse_result */
+	size_t key_len;
 };
 
+/*
+ * Return true if the parsing of a child may depend on the other ones.
+ * It is computed when the node is configured, and assumed when a
+ * descendant was reconfigured since.
+ */
+static bool subset_is_pstate_dependent(const struct ec_node_subset *priv)
+{
+	return priv->dependent || (priv->deps != NULL && ec_node_deps_changed(priv->deps));
+}
+
+static int subset_ctx_init(
+	struct subset_ctx *ctx,
+	struct ec_node **table,
+	size_t len,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec,
+	bool keep_pnodes
+)
+{
+	size_t i, n;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->table = table;
+	ctx->len = len;
+	ctx->strvec = strvec;
+	ctx->strvec_len = ec_strvec_len(strvec);
+	ctx->pstate = pstate;
+	ctx->key_len = sizeof(struct subset_key) + (len + 7) / 8;
+
+	n = len * (ctx->strvec_len + 1);
+	ctx->match = malloc(n * sizeof(*ctx->match));
+	if (ctx->match == NULL)
+		return -1;
+	for (i = 0; i < n; i++)
+		ctx->match[i] = MATCH_UNKNOWN;
+
+	if (keep_pnodes) {
+		ctx->pnodes = calloc(n, sizeof(*ctx->pnodes));
+		if (ctx->pnodes == NULL)
+			return -1;
+	}
+
+	ctx->memo = ec_htable();
+	if (ctx->memo == NULL)
+		return -1;
+
+	return 0;
+}
+
+static void subset_ctx_free(struct subset_ctx *ctx)
+{
+	size_t i;
+
+	if (ctx->pnodes != NULL) {
+		for (i = 0; i < ctx->len * (ctx->strvec_len + 1); i++)
+			ec_pnode_free(ctx->pnodes[i]);
+	}
+	free(ctx->pnodes);
+	free(ctx->match);
+	ec_htable_free(ctx->memo);
+}
+
+/* the key with all the children, at the beginning of the input */
+static struct subset_key *subset_key_root(const struct subset_ctx *ctx)
+{
+	struct subset_key *key;
+	size_t i;
+
+	key = calloc(1, ctx->key_len);
+	if (key == NULL)
+		return NULL;
+
+	for (i = 0; i < ctx->len; i++)
+		key->mask[i / 8] |= 1 << (i % 8);
+
+	return key;
+}
+
+/* the key after child i has matched len strings */
+static struct subset_key *
+subset_key_next(const struct subset_ctx *ctx, const struct subset_key *key, size_t i, size_t len)
+{
+	struct subset_key *next;
+
+	next = malloc(ctx->key_len);
+	if (next == NULL)
+		return NULL;
+
+	memcpy(next, key, ctx->key_len);
+	next->mask[i / 8] &= ~(1 << (i % 8));
+	next->off += len;
+
+	return next;
+}
+
+static bool subset_key_has(const struct subset_key *key, size_t i)
+{
+	return key->mask[i / 8] & (1 << (i % 8));
+}
+
+/* parse child i at offset off, the result is computed only once */
+static int subset_match(struct subset_ctx *ctx, size_t i, size_t off)
+{
+	size_t idx = i * (ctx->strvec_len + 1) + off;
+	struct ec_pnode *child;
+	struct ec_strvec view;
+	int ret;
+
+	if (ctx->match[idx] != MATCH_UNKNOWN)
+		return ctx->match[idx];
+
+	ec_strvec_view(&view, ctx->strvec, off, ctx->strvec_len - off);
+	if (ctx->pstate != NULL)
+		ret = ec_parse_child(ctx->table[i], ctx->pstate, &view);
+	else
+		ret = ec_match_child(ctx->table[i], &view);
+	if (ret < 0)
+		return -1;
+
+	/* keep the parsing node aside, it is linked at the end if it is
+	 * part of the best result */
+	if (ret != EC_PARSE_NOMATCH && ctx->pstate != NULL) {
+		child = ec_pnode_get_last_child(ctx->pstate);
+		ec_pnode_unlink_child(child);
+		ctx->pnodes[idx] = child;
+	}
+	ctx->match[idx] = ret;
+
+	return ret;
+}
+
+/*
+ * Find the longest list of children that matches the input, in any
+ * order. The best result for a given set of unused children and a given
+ * offset is only computed once. On equality, the first found result is
+ * kept, trying the children in table order.
+ */
+static int
+subset_parse(struct subset_ctx *ctx, const struct subset_key *key, const struct parse_result **out)
+{
+	struct subset_key *next = NULL;
+	const struct parse_result *result;
+	struct parse_result *best;
+	size_t i;
+	int ret;
+
+	best = ec_htable_get(ctx->memo, key, ctx->key_len);
+	if (best != NULL) {
+		*out = best;
+		return 0;
+	}
+
+	best = calloc(1, sizeof(*best));
+	if (best == NULL)
+		return -1;
+	best->first = -1;
+
+	for (i = 0; i < ctx->len; i++) {
+		if (!subset_key_has(key, i))
+			continue;
+
+		ret = subset_match(ctx, i, key->off);
+		if (ret < 0)
+			goto fail;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		next = subset_key_next(ctx, key, i, ret);
+		if (next == NULL)
+			goto fail;
+		if (subset_parse(ctx, next, &result) < 0)
+			goto fail;
+		free(next);
+		next = NULL;
+
+		if (result->parse_len + 1 > best->parse_len) {
+			best->parse_len = result->parse_len + 1;
+			best->len = ret + result->len;
+			best->first = i;
+		}
+	}
+
+	if (ec_htable_set(ctx->memo, key, ctx->key_len, best, free) < 0)
+		return -1;
+
+	*out = best;
+	return 0;
+
+fail:
+	free(next);
+	free(best);
+	return -1;
+}
+
+static int subset_parse_memo(
+	struct ec_node **table,
+	size_t table_len,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec
+)
+{
+	struct subset_key *key = NULL, *next;
+	const struct parse_result *result, *best;
+	struct subset_ctx ctx;
+	size_t idx;
+	int ret = -1;
+
+	if (table_len == 0)
+		return 0;
+
+	if (subset_ctx_init(&ctx, table, table_len, pstate, strvec, pstate != NULL) < 0)
+		goto end;
+
+	key = subset_key_root(&ctx);
+	if (key == NULL)
+		goto end;
+
+	if (subset_parse(&ctx, key, &best) < 0)
+		goto end;
+
+	/* link the parsing nodes of the best result, if any */
+	result = best;
+	while (pstate != NULL && result->first >= 0) {
+		idx = result->first * (ctx.strvec_len + 1) + key->off;
+		ec_pnode_link_child(pstate, ctx.pnodes[idx]);
+		ctx.pnodes[idx] = NULL;
+
+		next = subset_key_next(&ctx, key, result->first, ctx.match[idx]);
+		if (next == NULL) {
+			ec_pnode_free_children(pstate);
+			goto end;
+		}
+		free(key);
+		key = next;
+
+		result = ec_htable_get(ctx.memo, key, ctx.key_len);
+		assert(result != NULL);
+	}
+
+	ret = best->len;
+
+end:
+	free(key);
+	subset_ctx_free(&ctx);
+	return ret;
+}
+
+/*
+ * Complete with the unused children at the given offset, then with the
+ * children that can follow each matching one. A given set of unused
+ * children at a given offset is only completed once, for the first path
+ * that reaches it.
+ */
+static int
+subset_complete(struct subset_ctx *ctx, struct ec_comp *comp, const struct subset_key *key)
+{
+	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
+	struct subset_key *next = NULL;
+	struct ec_strvec view;
+	size_t i, idx;
+	int ret;
+
+	if (ec_htable_has_key(ctx->memo, key, ctx->key_len))
+		return 0;
+	if (ec_htable_set(ctx->memo, key, ctx->key_len, NULL, NULL) < 0)
+		return -1;
+
+	ec_strvec_view(&view, ctx->strvec, key->off, ctx->strvec_len - key->off);
+
+	for (i = 0; i < ctx->len; i++) {
+		if (!subset_key_has(key, i))
+			continue;
+
+		ret = ec_complete_child(ctx->table[i], comp, &view);
+		if (ret < 0)
+			goto fail;
+	}
+
+	for (i = 0; i < ctx->len; i++) {
+		if (!subset_key_has(key, i))
+			continue;
+
+		idx = i * (ctx->strvec_len + 1) + key->off;
+		if (ctx->match[idx] == EC_PARSE_NOMATCH)
+			continue;
+
+		ret = ec_parse_child(ctx->table[i], parse, &view);
+		if (ret < 0)
+			goto fail;
+		ctx->match[idx] = ret;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		next = subset_key_next(ctx, key, i, ret);
+		if (next == NULL) {
+			ec_pnode_del_last_child(parse);
+			goto fail;
+		}
+		ret = subset_complete(ctx, comp, next);
+		ec_pnode_del_last_child(parse);
+		free(next);
+		next = NULL;
+
+		if (ret < 0)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	return -1;
+}
+
+static int subset_complete_memo(
+	struct ec_node **table,
+	size_t table_len,
+	struct ec_comp *comp,
+	const struct ec_strvec *strvec
+)
+{
+	struct subset_key *key = NULL;
+	struct subset_ctx ctx;
+	int ret = -1;
+
+	if (table_len == 0)
+		return 0;
+
+	if (subset_ctx_init(&ctx, table, table_len, NULL, strvec, false) < 0)
+		goto end;
+
+	key = subset_key_root(&ctx);
+	if (key == NULL)
+		goto end;
+
+	ret = subset_complete(&ctx, comp, key);
+
+end:
+	free(key);
+	subset_ctx_free(&ctx);
+	return ret;
+}
+
 /* recursively find the longest list of nodes that matches: the state is
  * updated accordingly. */
 static int __ec_node_subset_parse(
@@ -42,7 +415,8 @@ static int __ec_node_subset_parse(
 )
 {
 	struct ec_node **child_table;
-	struct ec_strvec *childvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	size_t i, j, len = 0;
 	struct parse_result best_result, result;
 	struct ec_pnode *best_parse = NULL;
@@ -76,14 +450,10 @@ static int __ec_node_subset_parse(
 
 		/* build a new strvec (ret is the len of matched strvec) */
 		len = ret;
-		childvec = ec_strvec_ndup(strvec, len, ec_strvec_len(strvec) - len);
-		if (childvec == NULL)
-			goto fail;
+		childvec = ec_strvec_view(&view, strvec, len, ec_strvec_len(strvec) - len);
 
 		memset(&result, 0, sizeof(result));
 		ret = __ec_node_subset_parse(&result, child_table, table_len - 1, pstate, childvec);
-		ec_strvec_free(childvec);
-		childvec = NULL;
 		if (ret < 0)
 			goto fail;
 
@@ -114,7 +484,6 @@ static int __ec_node_subset_parse(
 
 fail:
 	ec_pnode_free(best_parse);
-	ec_strvec_free(childvec);
 	free(child_table);
 	return -1;
 }
@@ -133,6 +502,9 @@ static int ec_node_subset_parse(
 	if (ec_strvec_len(strvec) == 0)
 		return EC_PARSE_NOMATCH;
 
+	if (!subset_is_pstate_dependent(priv))
+		return subset_parse_memo(priv->table, priv->len, pstate, strvec);
+
 	memset(&result, 0, sizeof(result));
 
 	ret = __ec_node_subset_parse(&result, priv->table, priv->len, pstate, strvec);
@@ -150,6 +522,16 @@ fail:
 	return ret;
 }
 
+static int ec_node_subset_match(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	struct ec_node_subset *priv = ec_node_priv(node);
+
+	if (ec_strvec_len(strvec) == 0)
+		return EC_PARSE_NOMATCH;
+
+	return subset_parse_memo(priv->table, priv->len, NULL, strvec);
+}
+
 static int __ec_node_subset_complete(
 	struct ec_node **table,
 	size_t table_len,
@@ -158,7 +540,8 @@ static int __ec_node_subset_complete(
 )
 {
 	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
-	struct ec_strvec *childvec = NULL;
+	const struct ec_strvec *childvec;
+	struct ec_strvec view;
 	struct ec_node *save;
 	size_t i, len;
 	int ret;
@@ -196,18 +579,12 @@ static int __ec_node_subset_complete(
 			continue;
 
 		len = ret;
-		childvec = ec_strvec_ndup(strvec, len, ec_strvec_len(strvec) - len);
-		if (childvec == NULL) {
-			ec_pnode_del_last_child(parse);
-			goto fail;
-		}
+		childvec = ec_strvec_view(&view, strvec, len, ec_strvec_len(strvec) - len);
 
 		save = table[i];
 		table[i] = NULL;
 		ret = __ec_node_subset_complete(table, table_len, comp, childvec);
 		table[i] = save;
-		ec_strvec_free(childvec);
-		childvec = NULL;
 		ec_pnode_del_last_child(parse);
 
 		if (ret < 0)
@@ -228,6 +605,9 @@ static int ec_node_subset_complete(
 {
 	struct ec_node_subset *priv = ec_node_priv(node);
 
+	if (!subset_is_pstate_dependent(priv))
+		return subset_complete_memo(priv->table, priv->len, comp, strvec);
+
 	return __ec_node_subset_complete(priv->table, priv->len, comp, strvec);
 }
 
@@ -239,6 +619,81 @@ static void ec_node_subset_free_priv(struct ec_node *node)
 	for (i = 0; i < priv->len; i++)
 		ec_node_free(priv->table[i]);
 	free(priv->table);
+	priv->table = NULL;
+	priv->len = 0;
+	ec_node_deps_free(priv->deps);
+	priv->deps = NULL;
+}
+
+static const struct ec_config_schema ec_node_subset_subschema[] = {
+	{
+		.desc = "A child node which is part of the subset.",
+		.type = EC_CONFIG_TYPE_NODE,
+	},
+	{
+		.type = EC_CONFIG_TYPE_NONE,
+	},
+};
+
+static const struct ec_config_schema ec_node_subset_schema[] = {
+	{
+		.key = "children",
+		.desc = "The list of children nodes, that can be matched in "
+			"any order.",
+		.type = EC_CONFIG_TYPE_LIST,
+		.subschema = ec_node_subset_subschema,
+	},
+	{
+		.type = EC_CONFIG_TYPE_NONE,
+	},
+};
+
+static int ec_node_subset_set_config(struct ec_node *node, const struct ec_config *config)
+{
+	struct ec_node_subset *priv = ec_node_priv(node);
+	struct ec_node **table = NULL, **old_table;
+	struct ec_node_deps *deps = NULL;
+	size_t i, len = 0, old_len;
+	bool dependent = false;
+	int ret;
+
+	table = ec_node_config_node_list_to_table(ec_config_dict_get(config, "children"), &len);
+	if (table == NULL)
+		return -1;
+
+	/* the new children are browsed through the node if it is in a loop */
+	old_table = priv->table;
+	old_len = priv->len;
+	priv->table = table;
+	priv->len = len;
+
+	deps = ec_node_deps();
+	if (deps == NULL)
+		goto fail;
+	for (i = 0; i < len && !dependent; i++) {
+		ret = ec_node_is_pstate_dependent(table[i], deps);
+		if (ret < 0)
+			goto fail;
+		dependent = ret;
+	}
+
+	for (i = 0; i < old_len; i++)
+		ec_node_free(old_table[i]);
+	free(old_table);
+	ec_node_deps_free(priv->deps);
+	priv->deps = deps;
+	priv->dependent = dependent;
+
+	return 0;
+
+fail:
+	ec_node_deps_free(deps);
+	priv->table = old_table;
+	priv->len = old_len;
+	for (i = 0; i < len; i++)
+		ec_node_free(table[i]);
+	free(table);
+	return -1;
 }
 
 static size_t ec_node_subset_get_children_count(const struct ec_node *node)
@@ -260,13 +715,18 @@ static int ec_node_subset_get_child(
 		return -1;
 
 	*child = priv->table[i];
-	*refs = 1;
+	/* each child node is referenced twice: once in the config and
+	 * once in the priv->table[] */
+	*refs = 2;
 	return 0;
 }
 
 static struct ec_node_type ec_node_subset_type = {
 	.name = "subset",
+	.schema = ec_node_subset_schema,
+	.set_config = ec_node_subset_set_config,
 	.parse = ec_node_subset_parse,
+	.match = ec_node_subset_match,
 	.complete = ec_node_subset_complete,
 	.size = sizeof(struct ec_node_subset),
 	.free_priv = ec_node_subset_free_priv,
@@ -278,66 +738,107 @@ EC_NODE_TYPE_REGISTER(ec_node_subset_type);
 
 int ec_node_subset_add(struct ec_node *node, struct ec_node *child)
 {
-	struct ec_node_subset *priv = ec_node_priv(node);
-	struct ec_node **table;
+	const struct ec_config *cur_config = NULL;
+	struct ec_config *config = NULL, *children;
+	int ret;
 
 	assert(node != NULL);
 
-	if (child == NULL) {
-		errno = EINVAL;
+	if (ec_node_check_type(node, &ec_node_subset_type) < 0)
 		goto fail;
-	}
 
-	if (ec_node_check_type(node, &ec_node_subset_type) < 0)
+	cur_config = ec_node_get_config(node);
+	if (cur_config == NULL)
+		config = ec_config_dict();
+	else
+		config = ec_config_dup(cur_config);
+	if (config == NULL)
 		goto fail;
 
-	table = realloc(priv->table, (priv->len + 1) * sizeof(*priv->table));
-	if (table == NULL) {
-		ec_node_free(child);
-		return -1;
+	children = ec_config_dict_get(config, "children");
+	if (children == NULL) {
+		children = ec_config_list();
+		if (children == NULL)
+			goto fail;
+
+		if (ec_config_dict_set(config, "children", children) < 0)
+			goto fail; /* children list is freed on error */
 	}
 
-	priv->table = table;
-	table[priv->len] = child;
-	priv->len++;
+	if (ec_config_list_add(children, ec_config_node(child)) < 0) {
+		child = NULL;
+		goto fail;
+	}
+
+	ret = ec_node_set_config(node, config);
+	config = NULL; /* freed */
+	if (ret < 0)
+		goto fail;
 
 	return 0;
 
 fail:
+	ec_config_free(config);
 	ec_node_free(child);
 	return -1;
 }
 
 struct ec_node *__ec_node_subset(const char *id, ...)
 {
+	struct ec_config *config = NULL, *children = NULL;
 	struct ec_node *node = NULL;
 	struct ec_node *child;
 	va_list ap;
-	int fail = 0;
+	int ret;
 
 	va_start(ap, id);
+	child = va_arg(ap, struct ec_node *);
 
 	node = ec_node_from_type(&ec_node_subset_type, id);
 	if (node == NULL)
-		fail = 1;
-
-	for (child = va_arg(ap, struct ec_node *); child != EC_VA_END;
-	     child = va_arg(ap, struct ec_node *)) {
-		/* on error, don't quit the loop to avoid leaks */
-		if (fail == 1 || child == NULL || ec_node_subset_add(node, child) < 0) {
-			fail = 1;
-			ec_node_free(child);
+		goto fail_free_children;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail_free_children;
+
+	children = ec_config_list();
+	if (children == NULL)
+		goto fail_free_children;
+
+	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *)) {
+		if (child == NULL)
+			goto fail_free_children;
+
+		if (ec_config_list_add(children, ec_config_node(child)) < 0) {
+			child = NULL;
+			goto fail_free_children;
 		}
 	}
 
-	if (fail == 1)
+	if (ec_config_dict_set(config, "children", children) < 0) {
+		children = NULL; /* freed */
+		goto fail;
+	}
+	children = NULL;
+
+	ret = ec_node_set_config(node, config);
+	config = NULL; /* freed */
+	if (ret < 0)
 		goto fail;
 
 	va_end(ap);
+
 	return node;
 
+fail_free_children:
+	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *))
+		ec_node_free(child);
 fail:
-	ec_node_free(node); /* will also free children */
+	ec_node_free(node); /* will also free added children */
+	ec_config_free(children);
+	ec_config_free(config);
 	va_end(ap);
+
 	return NULL;
 }
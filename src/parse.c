@@ -9,8 +9,11 @@
 #include <string.h>
 
 #include <ecoli/assert.h>
+#include <ecoli/atom.h>
 #include <ecoli/dict.h>
+#include <ecoli/htable.h>
 #include <ecoli/log.h>
+#include <ecoli/murmurhash.h>
 #include <ecoli/node.h>
 #include <ecoli/node_seq.h>
 #include <ecoli/node_sh_lex.h>
@@ -18,6 +21,10 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+#include "parse_private.h"
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(parse);
 
 TAILQ_HEAD(ec_pnode_list, ec_pnode);
@@ -29,17 +36,497 @@ struct ec_pnode {
 	const struct ec_node *node;
 	struct ec_strvec *strvec;
 	struct ec_dict *attrs;
+	struct ec_parse_ctx *ctx;
+	unsigned int order; /* position in the tree, if indexed */
+	unsigned int order_end; /* position after the last descendant, if indexed */
+	bool tracked; /* the grammar node was tracked when the pnode was allocated */
+	bool memoized; /* the subtree is referenced by the memoization table */
+	bool released; /* memoized and freed by its owner, only the table holds it */
+	unsigned int n_tracked; /* number of tracked pnodes in the subtree */
+	struct ec_htable *occurrences; /* tracked node -> count, root only, built on use */
 };
 
-static int __ec_parse_child(
+#define ARENA_CHUNK_SIZE 16384
+
+/* A chunk of memory of the parsing arena. */
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size; /* size of data */
+	size_t off; /* offset of the first free byte in data */
+	union {
+		long double ld;
+		long long ll;
+		void *ptr;
+	} data[];
+};
+
+struct ec_parse_ctx {
+	ec_parse_flag_t flags;
+	const struct ec_pnode *owner; /* the root pnode that frees the ctx, if any */
+	struct memo_entry *memo; /* the stored results */
+	size_t memo_size; /* allocated length of memo */
+	unsigned int *memo_buckets; /* hash of (node, position) -> index + 1 in memo */
+	size_t memo_n_buckets; /* a power of 2 */
+	unsigned int memo_taint; /* incremented when a pstate dependent node is parsed */
+	struct ec_parse_memo_stats memo_stats;
+	struct arena_chunk *arena; /* list of chunks, the first one is the current one */
+	struct ec_pnode *free_pnodes; /* freed pnodes of the arena, linked with parent */
+	struct ec_htable *index; /* node id atom -> struct index_entry */
+	const struct ec_pnode *index_root; /* the indexed tree */
+};
+
+/* The position of the strvec in the input is identified by the pointer
+ * to its first string, which is shared by all duplicates. */
+struct memo_key {
+	const struct ec_node *node;
+	const char *first;
+	size_t len;
+};
+
+struct memo_entry {
+	unsigned int next; /* index + 1 of the next entry in the bucket, or 0 */
+	struct memo_key key;
+	int ret;
+	struct ec_pnode *pnode; /* the matching subtree, shared, NULL if no match */
+	struct ec_strvec_elt *pin; /* reference to the first string of the key */
+};
+
+#define MEMO_INIT_BUCKETS 64
+
+/* The pnodes of an indexed tree that have the same node id, in tree order. */
+struct index_entry {
+	size_t len;
+	size_t size;
+	const struct ec_pnode **pnodes;
+};
+
+static struct ec_pnode *__ec_pnode_dup(
+	const struct ec_pnode *root,
+	const struct ec_pnode *ref,
+	struct ec_pnode **new_ref,
+	struct ec_parse_ctx *ctx
+);
+static void memo_free(struct ec_parse_ctx *ctx);
+
+struct ec_parse_ctx *ec_parse_ctx(ec_parse_flag_t flags)
+{
+	struct ec_parse_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL)
+		return NULL;
+
+	ctx->flags = flags;
+	if (flags & EC_PARSE_MEMO) {
+		ctx->memo_buckets = calloc(MEMO_INIT_BUCKETS, sizeof(*ctx->memo_buckets));
+		if (ctx->memo_buckets == NULL) {
+			free(ctx);
+			return NULL;
+		}
+		ctx->memo_n_buckets = MEMO_INIT_BUCKETS;
+	}
+
+	return ctx;
+}
+
+void ec_parse_ctx_done(struct ec_parse_ctx *ctx)
+{
+	if (ctx == NULL || ctx->memo_buckets == NULL)
+		return;
+
+	memo_free(ctx);
+}
+
+void ec_parse_ctx_free(struct ec_parse_ctx *ctx)
+{
+	struct arena_chunk *chunk;
+
+	if (ctx == NULL)
+		return;
+
+	ec_parse_ctx_done(ctx);
+	ec_htable_free(ctx->index);
+	while (ctx->arena != NULL) {
+		chunk = ctx->arena;
+		ctx->arena = chunk->next;
+		free(chunk);
+	}
+	free(ctx);
+}
+
+/* allocate zeroed memory from the arena, it is freed with the ctx */
+static void *arena_alloc(struct ec_parse_ctx *ctx, size_t size)
+{
+	struct arena_chunk *chunk = ctx->arena;
+	size_t chunk_size;
+	void *ptr;
+
+	/* keep the alignment */
+	size = (size + sizeof(chunk->data[0]) - 1) & ~(sizeof(chunk->data[0]) - 1);
+
+	if (chunk == NULL || chunk->size - chunk->off < size) {
+		chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (chunk == NULL)
+			return NULL;
+		chunk->size = chunk_size;
+		chunk->off = 0;
+		chunk->next = ctx->arena;
+		ctx->arena = chunk;
+	}
+
+	ptr = (char *)chunk->data + chunk->off;
+	chunk->off += size;
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
+static bool pnode_in_arena(const struct ec_pnode *pnode)
+{
+	return pnode->ctx != NULL && pnode->ctx->flags & EC_PARSE_ARENA;
+}
+
+struct ec_pnode *ec_pnode_alloc(const struct ec_node *node, struct ec_parse_ctx *ctx)
+{
+	struct ec_pnode *pnode = NULL;
+
+	if (ctx == NULL || !(ctx->flags & EC_PARSE_ARENA)) {
+		pnode = calloc(1, sizeof(*pnode));
+	} else if (ctx->free_pnodes != NULL) {
+		pnode = ctx->free_pnodes;
+		ctx->free_pnodes = pnode->parent;
+		memset(pnode, 0, sizeof(*pnode));
+	} else {
+		pnode = arena_alloc(ctx, sizeof(*pnode));
+	}
+	if (pnode == NULL)
+		return NULL;
+	if (ec_node_stats_enabled)
+		ec_node_stats_count_alloc();
+
+	TAILQ_INIT(&pnode->children);
+
+	pnode->node = node;
+	pnode->ctx = ctx;
+	if (node != NULL && ec_node_is_tracked(node)) {
+		pnode->tracked = true;
+		pnode->n_tracked = 1;
+	}
+
+	return pnode;
+}
+
+/* set the matched strings of a pnode, from the same memory than the pnode */
+static int pnode_set_strvec(struct ec_pnode *pnode, const struct ec_strvec *strvec, size_t len)
+{
+	void *buf;
+
+	if (ec_node_stats_enabled)
+		ec_node_stats_count_alloc();
+
+	if (!pnode_in_arena(pnode)) {
+		pnode->strvec = ec_strvec_ndup(strvec, 0, len);
+		if (pnode->strvec == NULL)
+			return -1;
+		return 0;
+	}
+
+	buf = arena_alloc(pnode->ctx, ec_strvec_ndup_size(len));
+	if (buf == NULL)
+		return -1;
+	pnode->strvec = ec_strvec_ndup_in(buf, strvec, 0, len);
+	if (pnode->strvec == NULL)
+		return -1;
+
+	return 0;
+}
+
+void ec_parse_ctx_get_memo_stats(const struct ec_parse_ctx *ctx, struct ec_parse_memo_stats *stats)
+{
+	if (ctx == NULL)
+		memset(stats, 0, sizeof(*stats));
+	else
+		*stats = ctx->memo_stats;
+}
+
+static void
+memo_key_init(struct memo_key *key, const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	memset(key, 0, sizeof(*key));
+	key->node = node;
+	key->len = ec_strvec_len(strvec);
+	if (key->len > 0)
+		key->first = ec_strvec_val(strvec, 0);
+}
+
+static unsigned int *memo_bucket(unsigned int *buckets, size_t n, const struct memo_key *key)
+{
+	return &buckets[ec_murmurhash3(key, sizeof(*key), 0) & (n - 1)];
+}
+
+static const struct memo_entry *
+memo_lookup(const struct ec_parse_ctx *ctx, const struct memo_key *key)
+{
+	const struct memo_entry *entry;
+	unsigned int idx;
+
+	idx = *memo_bucket(ctx->memo_buckets, ctx->memo_n_buckets, key);
+	while (idx != 0) {
+		entry = &ctx->memo[idx - 1];
+		if (memcmp(&entry->key, key, sizeof(*key)) == 0)
+			return entry;
+		idx = entry->next;
+	}
+
+	return NULL;
+}
+
+/* double the number of buckets */
+static int memo_grow_buckets(struct ec_parse_ctx *ctx)
+{
+	size_t i, n = ctx->memo_n_buckets * 2;
+	unsigned int *buckets, *bucket;
+
+	buckets = calloc(n, sizeof(*buckets));
+	if (buckets == NULL)
+		return -1;
+
+	for (i = 0; i < ctx->memo_stats.entries; i++) {
+		bucket = memo_bucket(buckets, n, &ctx->memo[i].key);
+		ctx->memo[i].next = *bucket;
+		*bucket = i + 1;
+	}
+	free(ctx->memo_buckets);
+	ctx->memo_buckets = buckets;
+	ctx->memo_n_buckets = n;
+
+	return 0;
+}
+
+/* release the references of the entries */
+static void memo_free(struct ec_parse_ctx *ctx)
+{
+	struct memo_entry *entry;
+	struct ec_pnode *pnode;
+	size_t i;
+
+	for (i = 0; i < ctx->memo_stats.entries; i++) {
+		entry = &ctx->memo[i];
+		/* the subtree is freed if its owner does not need it anymore */
+		pnode = entry->pnode;
+		if (pnode != NULL) {
+			pnode->memoized = false;
+			if (pnode->released) {
+				pnode->released = false;
+				ec_pnode_free(pnode);
+			}
+		}
+		ec_strvec_elt_put(entry->pin);
+	}
+	free(ctx->memo);
+	ctx->memo = NULL;
+	ctx->memo_size = 0;
+	free(ctx->memo_buckets);
+	ctx->memo_buckets = NULL;
+	ctx->memo_n_buckets = 0;
+}
+
+/*
+ * Store the result of a parse, child is NULL if it does not match. The
+ * matching subtree is not copied: it is referenced by the table until the
+ * end of the top-level call, and survives when its owner frees it.
+ */
+static int memo_store(
+	struct ec_parse_ctx *ctx,
+	const struct memo_key *key,
+	const struct ec_strvec *strvec,
+	int ret,
+	struct ec_pnode *child
+)
+{
+	size_t len = ctx->memo_stats.entries;
+	struct memo_entry *entry;
+	unsigned int *bucket;
+	size_t size;
+
+	if (len >= ctx->memo_n_buckets && memo_grow_buckets(ctx) < 0)
+		return -1;
+	if (len == ctx->memo_size) {
+		/* double the size, so that storing n results is O(n) */
+		size = len == 0 ? 16 : len * 2;
+		entry = realloc(ctx->memo, size * sizeof(*entry));
+		if (entry == NULL)
+			return -1;
+		ctx->memo = entry;
+		ctx->memo_size = size;
+	}
+
+	entry = &ctx->memo[len];
+	memset(entry, 0, sizeof(*entry));
+	entry->key = *key;
+	entry->ret = ret;
+	if (child != NULL) {
+		entry->pnode = child;
+		child->memoized = true;
+	}
+	/* keep a reference to the first string, so that its address cannot
+	 * be reused by another string during the parsing */
+	if (key->len > 0)
+		entry->pin = ec_strvec_elt_get(strvec, 0);
+
+	bucket = memo_bucket(ctx->memo_buckets, ctx->memo_n_buckets, key);
+	entry->next = *bucket;
+	*bucket = len + 1;
+	ctx->memo_stats.entries++;
+
+	return 0;
+}
+
+/*
+ * Link the stored result in the parsing tree. The subtree is moved if its
+ * previous owner has freed it, else it is still in use and it is copied.
+ */
+static int
+memo_replay(struct ec_parse_ctx *ctx, const struct memo_entry *entry, struct ec_pnode *pstate)
+{
+	struct ec_pnode *child = entry->pnode;
+
+	if (entry->ret == EC_PARSE_NOMATCH)
+		return EC_PARSE_NOMATCH;
+
+	if (child->released) {
+		child->released = false;
+	} else {
+		child = __ec_pnode_dup(child, NULL, NULL, ctx);
+		if (child == NULL)
+			return -1;
+	}
+
+	ec_pnode_link_child(pstate, child);
+
+	return entry->ret;
+}
+
+static void index_entry_free(void *ptr)
+{
+	struct index_entry *entry = ptr;
+
+	free(entry->pnodes);
+	free(entry);
+}
+
+/* number the pnodes in depth-first order, and add them to the index */
+static int index_add(struct ec_htable *index, struct ec_pnode *pnode, unsigned int *order)
+{
+	const struct ec_pnode **pnodes;
+	struct index_entry *entry;
+	struct ec_pnode *child;
+	const char *id;
+	size_t size;
+
+	pnode->order = (*order)++;
+
+	if (pnode->node != NULL) {
+		id = ec_node_id(pnode->node);
+		entry = ec_htable_get(index, &id, sizeof(id));
+		if (entry == NULL) {
+			entry = calloc(1, sizeof(*entry));
+			if (entry == NULL)
+				return -1;
+			if (ec_htable_set(index, &id, sizeof(id), entry, index_entry_free) < 0)
+				return -1;
+		}
+		if (entry->len == entry->size) {
+			size = entry->size == 0 ? 4 : entry->size * 2;
+			pnodes = realloc(entry->pnodes, size * sizeof(*pnodes));
+			if (pnodes == NULL)
+				return -1;
+			entry->pnodes = pnodes;
+			entry->size = size;
+		}
+		entry->pnodes[entry->len++] = pnode;
+	}
+
+	TAILQ_FOREACH (child, &pnode->children, next) {
+		if (index_add(index, child, order) < 0)
+			return -1;
+	}
+	pnode->order_end = *order;
+
+	return 0;
+}
+
+static int index_build(struct ec_parse_ctx *ctx, struct ec_pnode *root)
+{
+	unsigned int order = 0;
+
+	ctx->index = ec_htable();
+	if (ctx->index == NULL)
+		return -1;
+	if (index_add(ctx->index, root, &order) < 0) {
+		ec_htable_free(ctx->index);
+		ctx->index = NULL;
+		return -1;
+	}
+	ctx->index_root = root;
+
+	return 0;
+}
+
+/* the index does not follow the modifications of the tree */
+static void index_drop(const struct ec_pnode *pnode)
+{
+	struct ec_parse_ctx *ctx = pnode->ctx;
+
+	if (ctx == NULL || ctx->index == NULL)
+		return;
+
+	ec_htable_free(ctx->index);
+	ctx->index = NULL;
+	ctx->index_root = NULL;
+}
+
+/* return the index of the tree, or NULL if it is not indexed */
+static const struct ec_htable *index_get(const struct ec_pnode *pnode)
+{
+	const struct ec_parse_ctx *ctx = pnode->ctx;
+
+	if (ctx == NULL || ctx->index == NULL || EC_PNODE_GET_ROOT(pnode) != ctx->index_root)
+		return NULL;
+
+	return ctx->index;
+}
+
+/* return the position of the first pnode whose order is >= order */
+static size_t index_entry_search(const struct index_entry *entry, unsigned int order)
+{
+	size_t lo = 0, hi = entry->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (entry->pnodes[mid]->order < order)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int parse_child(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
 	bool is_root,
 	const struct ec_strvec *strvec
 )
 {
-	struct ec_strvec *match_strvec;
+	struct ec_parse_ctx *ctx = pstate->ctx;
+	const struct memo_entry *entry;
 	struct ec_pnode *child = NULL;
+	struct memo_key key;
+	unsigned int taint = 0;
+	bool memo = false;
 	int ret;
 
 	/* XXX limit max number of recursions to avoid segfault */
@@ -49,8 +536,20 @@ static int __ec_parse_child(
 		return -1;
 	}
 
+	if (!is_root && ctx != NULL && ctx->memo_buckets != NULL) {
+		memo_key_init(&key, node, strvec);
+		ctx->memo_stats.lookups++;
+		entry = memo_lookup(ctx, &key);
+		if (entry != NULL) {
+			ctx->memo_stats.hits++;
+			return memo_replay(ctx, entry, pstate);
+		}
+		taint = ctx->memo_taint;
+		memo = true;
+	}
+
 	if (!is_root) {
-		child = ec_pnode(node);
+		child = ec_pnode_alloc(node, ctx);
 		if (child == NULL)
 			return -1;
 
@@ -62,19 +561,26 @@ static int __ec_parse_child(
 	if (ret < 0)
 		goto fail;
 
+	if (ctx != NULL && ec_node_type(node)->flags & EC_NODE_TYPE_F_PSTATE_DEPENDENT)
+		ctx->memo_taint++;
+	if (memo && ctx->memo_taint != taint)
+		memo = false;
+
 	if (ret == EC_PARSE_NOMATCH) {
 		if (!is_root) {
 			ec_pnode_unlink_child(child);
 			ec_pnode_free(child);
 		}
+		if (memo && memo_store(ctx, &key, strvec, ret, NULL) < 0)
+			return -1;
 		return ret;
 	}
 
-	match_strvec = ec_strvec_ndup(strvec, 0, ret);
-	if (match_strvec == NULL)
+	if (pnode_set_strvec(child, strvec, ret) < 0)
 		goto fail;
 
-	child->strvec = match_strvec;
+	if (memo && memo_store(ctx, &key, strvec, ret, child) < 0)
+		goto fail;
 
 	return ret;
 
@@ -86,6 +592,26 @@ fail:
 	return -1;
 }
 
+static int __ec_parse_child(
+	const struct ec_node *node,
+	struct ec_pnode *pstate,
+	bool is_root,
+	const struct ec_strvec *strvec
+)
+{
+	struct ec_node_stats_probe probe;
+	int ret;
+
+	if (!ec_node_stats_enabled)
+		return parse_child(node, pstate, is_root, strvec);
+
+	ec_node_stats_enter(&probe);
+	ret = parse_child(node, pstate, is_root, strvec);
+	ec_node_stats_leave(node, &probe, EC_NODE_STATS_OP_PARSE, ret);
+
+	return ret;
+}
+
 int ec_parse_child(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -96,21 +622,210 @@ int ec_parse_child(
 	return __ec_parse_child(node, pstate, false, strvec);
 }
 
-struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+int ec_match_child(const struct ec_node *node, const struct ec_strvec *strvec)
 {
-	struct ec_pnode *pnode = ec_pnode(node);
+	const struct ec_node_type *type = ec_node_type(node);
+	struct ec_node_stats_probe probe;
+	struct ec_parse_ctx *ctx;
+	struct ec_pnode *pnode;
+	unsigned int taint;
 	int ret;
 
-	if (pnode == NULL)
-		return NULL;
+	if (type->flags & EC_NODE_TYPE_F_PSTATE_DEPENDENT) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if (type->match != NULL) {
+		if (!ec_node_stats_enabled)
+			return type->match(node, strvec);
+
+		ec_node_stats_enter(&probe);
+		ret = type->match(node, strvec);
+		ec_node_stats_leave(node, &probe, EC_NODE_STATS_OP_PARSE, ret);
+		return ret;
+	}
+
+	/* no match method, parse in a temporary tree */
+	ctx = ec_parse_ctx(EC_PARSE_ARENA);
+	if (ctx == NULL)
+		return -1;
+	pnode = ec_pnode_alloc(node, ctx);
+	if (pnode == NULL) {
+		ec_parse_ctx_free(ctx);
+		return -1;
+	}
+	ctx->owner = pnode;
 
 	ret = __ec_parse_child(node, pnode, true, strvec);
-	if (ret < 0) {
-		ec_pnode_free(pnode);
+	taint = ctx->memo_taint;
+	ec_pnode_free(pnode);
+
+	/* a descendant may need the parsing state of the ancestors */
+	if (ret >= 0 && taint != 0) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	return ret;
+}
+
+int ec_parse_matches(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	struct ec_pnode *pnode;
+	int ret;
+
+	ret = ec_match_child(node, strvec);
+	if (ret >= 0 || errno != ENOTSUP)
+		return ret;
+
+	/* the grammar depends on the parsing state, build the tree */
+	pnode = ec_parse_strvec(node, strvec);
+	if (pnode == NULL)
+		return -1;
+	if (ec_pnode_matches(pnode))
+		ret = ec_pnode_len(pnode);
+	else
+		ret = EC_PARSE_NOMATCH;
+	ec_pnode_free(pnode);
+
+	return ret;
+}
+
+struct ec_pnode *ec_parse_strvec_flags(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags
+)
+{
+	struct ec_parse_ctx *ctx = NULL;
+	struct ec_pnode *pnode = NULL;
+	int ret;
+
+	if (flags != 0) {
+		ctx = ec_parse_ctx(flags);
+		if (ctx == NULL)
+			return NULL;
+	}
+
+	pnode = ec_pnode_alloc(node, ctx);
+	if (pnode == NULL) {
+		ec_parse_ctx_free(ctx);
 		return NULL;
 	}
+	if (ctx != NULL)
+		ctx->owner = pnode;
+
+	ret = __ec_parse_child(node, pnode, true, strvec);
+	ec_parse_ctx_done(ctx);
+	if (ret < 0)
+		goto fail;
+
+	if (flags & EC_PARSE_INDEX && ret != EC_PARSE_NOMATCH && index_build(ctx, pnode) < 0)
+		goto fail;
 
 	return pnode;
+
+fail:
+	ec_pnode_free(pnode);
+	return NULL;
+}
+
+/* the tokens of a parsing node are the ones of strvec at offset off */
+static bool
+pnode_in_strvec(const struct ec_pnode *pnode, const struct ec_strvec *strvec, size_t off)
+{
+	size_t len = ec_pnode_len(pnode);
+
+	/* the strings are shared by the slices of a vector */
+	return len == 0
+		|| (off + len <= ec_strvec_len(strvec)
+		    && ec_strvec_val(pnode->strvec, 0) == ec_strvec_val(strvec, off));
+}
+
+/*
+ * The children of a parsing node match consecutive spans of its tokens,
+ * except under a lexer node (sh_lex, re_lex): its children match the
+ * tokens produced by the lexer, which are not in the input vector.
+ */
+static int pnode_visit(
+	const struct ec_pnode *pnode,
+	const struct ec_strvec *strvec,
+	size_t start,
+	const struct ec_parse_visitor *visitor,
+	void *opaque
+)
+{
+	const struct ec_pnode *child;
+	size_t len = ec_pnode_len(pnode);
+	size_t off = start;
+	int ret = 0;
+
+	if (visitor->enter != NULL) {
+		ret = visitor->enter(pnode->node, strvec, start, len, opaque);
+		if (ret < 0)
+			return -1;
+	}
+
+	if (ret == 0) {
+		TAILQ_FOREACH (child, &pnode->children, next) {
+			if (!pnode_in_strvec(child, strvec, off)) {
+				/* tokens of a lexer, restart the spans on them */
+				if (pnode_visit(child, child->strvec, 0, visitor, opaque) < 0)
+					return -1;
+				continue;
+			}
+			if (pnode_visit(child, strvec, off, visitor, opaque) < 0)
+				return -1;
+			off += ec_pnode_len(child);
+		}
+	}
+
+	if (visitor->leave != NULL) {
+		if (visitor->leave(pnode->node, strvec, start, len, opaque) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+int ec_parse_strvec_visit(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	ec_parse_flag_t flags,
+	const struct ec_parse_visitor *visitor,
+	void *opaque
+)
+{
+	struct ec_pnode *pnode;
+	int ret;
+
+	if (visitor == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* the visitor cannot use the index */
+	flags &= ~EC_PARSE_INDEX;
+	pnode = ec_parse_strvec_flags(node, strvec, flags | EC_PARSE_ARENA);
+	if (pnode == NULL)
+		return -1;
+
+	if (!ec_pnode_matches(pnode)) {
+		ret = EC_PARSE_NOMATCH;
+	} else if (pnode_visit(pnode, strvec, 0, visitor, opaque) < 0) {
+		ret = -1;
+	} else {
+		ret = ec_pnode_len(pnode);
+	}
+	ec_pnode_free(pnode);
+
+	return ret;
+}
+
+struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return ec_parse_strvec_flags(node, strvec, 0);
 }
 
 struct ec_pnode *ec_parse(const struct ec_node *node, const char *str)
@@ -141,60 +856,42 @@ fail:
 
 struct ec_pnode *ec_pnode(const struct ec_node *node)
 {
-	struct ec_pnode *pnode = NULL;
-
-	pnode = calloc(1, sizeof(*pnode));
-	if (pnode == NULL)
-		goto fail;
-
-	TAILQ_INIT(&pnode->children);
-
-	pnode->node = node;
-	pnode->attrs = ec_dict();
-	if (pnode->attrs == NULL)
-		goto fail;
-
-	return pnode;
-
-fail:
-	if (pnode != NULL)
-		ec_dict_free(pnode->attrs);
-	free(pnode);
-
-	return NULL;
+	return ec_pnode_alloc(node, NULL);
 }
 
-static struct ec_pnode *
-__ec_pnode_dup(const struct ec_pnode *root, const struct ec_pnode *ref, struct ec_pnode **new_ref)
+static struct ec_pnode *__ec_pnode_dup(
+	const struct ec_pnode *root,
+	const struct ec_pnode *ref,
+	struct ec_pnode **new_ref,
+	struct ec_parse_ctx *ctx
+)
 {
 	struct ec_pnode *dup = NULL;
 	struct ec_pnode *child, *dup_child;
-	struct ec_dict *attrs = NULL;
 
 	if (root == NULL)
 		return NULL;
 
-	dup = ec_pnode(root->node);
+	dup = ec_pnode_alloc(root->node, ctx);
 	if (dup == NULL)
 		return NULL;
 
-	if (root == ref)
+	if (root == ref && new_ref != NULL)
 		*new_ref = dup;
 
-	attrs = ec_dict_dup(root->attrs);
-	if (attrs == NULL)
-		goto fail;
-	ec_dict_free(dup->attrs);
-	dup->attrs = attrs;
+	if (root->attrs != NULL) {
+		dup->attrs = ec_dict_dup(root->attrs);
+		if (dup->attrs == NULL)
+			goto fail;
+	}
 
 	if (root->strvec != NULL) {
-		dup->strvec = ec_strvec_dup(root->strvec);
-		if (dup->strvec == NULL)
+		if (pnode_set_strvec(dup, root->strvec, ec_strvec_len(root->strvec)) < 0)
 			goto fail;
 	}
 
 	TAILQ_FOREACH (child, &root->children, next) {
-		dup_child = __ec_pnode_dup(child, ref, new_ref);
+		dup_child = __ec_pnode_dup(child, ref, new_ref, ctx);
 		if (dup_child == NULL)
 			goto fail;
 		ec_pnode_link_child(dup, dup_child);
@@ -213,7 +910,7 @@ struct ec_pnode *ec_pnode_dup(const struct ec_pnode *pnode)
 	struct ec_pnode *dup_root, *dup = NULL;
 
 	root = EC_PNODE_GET_ROOT(pnode);
-	dup_root = __ec_pnode_dup(root, pnode, &dup);
+	dup_root = __ec_pnode_dup(root, pnode, &dup, NULL);
 	if (dup_root == NULL)
 		return NULL;
 	assert(dup != NULL);
@@ -228,25 +925,53 @@ void ec_pnode_free_children(struct ec_pnode *pnode)
 	if (pnode == NULL)
 		return;
 
+	index_drop(pnode);
 	while (!TAILQ_EMPTY(&pnode->children)) {
 		child = TAILQ_FIRST(&pnode->children);
-		TAILQ_REMOVE(&pnode->children, child, next);
-		child->parent = NULL;
+		ec_pnode_unlink_child(child);
 		ec_pnode_free(child);
 	}
 }
 
 void ec_pnode_free(struct ec_pnode *pnode)
 {
+	struct ec_parse_ctx *ctx;
+
 	if (pnode == NULL)
 		return;
 
 	ec_assert_print(pnode->parent == NULL, "parent not NULL in ec_pnode_free()");
 
+	/* the memoization table keeps it, it may be linked again */
+	if (pnode->memoized) {
+		pnode->released = true;
+		return;
+	}
+
 	ec_pnode_free_children(pnode);
-	ec_strvec_free(pnode->strvec);
 	ec_dict_free(pnode->attrs);
-	free(pnode);
+	ec_htable_free(pnode->occurrences);
+
+	ctx = pnode->ctx;
+	if (!pnode_in_arena(pnode)) {
+		ec_strvec_free(pnode->strvec);
+		if (ctx != NULL && ctx->owner == pnode)
+			ec_parse_ctx_free(ctx);
+		free(pnode);
+		return;
+	}
+
+	ec_strvec_release(pnode->strvec);
+
+	/* the root releases all the memory of the arena at once */
+	if (ctx->owner == pnode) {
+		ec_parse_ctx_free(ctx);
+		return;
+	}
+
+	/* else, keep the pnode for the next allocation */
+	pnode->parent = ctx->free_pnodes;
+	ctx->free_pnodes = pnode;
 }
 
 static void __ec_pnode_dump(FILE *out, const struct ec_pnode *pnode, size_t indent)
@@ -302,10 +1027,82 @@ void ec_pnode_dump(FILE *out, const struct ec_pnode *pnode)
 	__ec_pnode_dump(out, pnode, 0);
 }
 
+/* add or remove the tracked nodes of a subtree to the occurrence counters */
+static int
+occurrences_update(struct ec_htable *occurrences, const struct ec_pnode *pnode, bool add)
+{
+	const struct ec_node *const *key = &pnode->node;
+	const struct ec_pnode *child;
+	unsigned int *count;
+
+	if (pnode->n_tracked == 0)
+		return 0;
+
+	if (pnode->tracked) {
+		count = ec_htable_get(occurrences, key, sizeof(*key));
+		if (count == NULL) {
+			if (!add) {
+				errno = ENOENT;
+				return -1;
+			}
+			count = calloc(1, sizeof(*count));
+			if (count == NULL)
+				return -1;
+			if (ec_htable_set(occurrences, key, sizeof(*key), count, free) < 0)
+				return -1;
+		}
+		if (add)
+			(*count)++;
+		else
+			(*count)--;
+	}
+
+	TAILQ_FOREACH (child, &pnode->children, next) {
+		if (occurrences_update(occurrences, child, add) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Update the number of tracked pnodes of the ancestors, and the
+ * occurrence counters of the root. If the counters cannot be updated,
+ * they are dropped, and rebuilt by the next ec_pnode_count_node().
+ */
+static void occurrences_link(struct ec_pnode *parent, struct ec_pnode *child, bool add)
+{
+	struct ec_pnode *root;
+
+	for (root = parent;; root = root->parent) {
+		if (add)
+			root->n_tracked += child->n_tracked;
+		else
+			root->n_tracked -= child->n_tracked;
+		if (root->parent == NULL)
+			break;
+	}
+
+	if (root->occurrences != NULL
+	    && occurrences_update(root->occurrences, child, add) < 0) {
+		ec_htable_free(root->occurrences);
+		root->occurrences = NULL;
+	}
+}
+
 void ec_pnode_link_child(struct ec_pnode *pnode, struct ec_pnode *child)
 {
+	index_drop(pnode);
+	index_drop(child);
 	TAILQ_INSERT_TAIL(&pnode->children, child, next);
 	child->parent = pnode;
+
+	if (child->n_tracked > 0) {
+		/* the counters of the root include the child ones */
+		ec_htable_free(child->occurrences);
+		child->occurrences = NULL;
+		occurrences_link(pnode, child, true);
+	}
 }
 
 void ec_pnode_unlink_child(struct ec_pnode *child)
@@ -313,11 +1110,63 @@ void ec_pnode_unlink_child(struct ec_pnode *child)
 	struct ec_pnode *parent = child->parent;
 
 	if (parent != NULL) {
+		index_drop(parent);
 		TAILQ_REMOVE(&parent->children, child, next);
 		child->parent = NULL;
+		if (child->n_tracked > 0)
+			occurrences_link(parent, child, false);
 	}
 }
 
+/* count the pnodes of a grammar node in a subtree, without the counters */
+static unsigned int count_node(const struct ec_pnode *pnode, const struct ec_node *node)
+{
+	const struct ec_pnode *child;
+	unsigned int count = 0;
+
+	if (pnode->node == node)
+		count++;
+
+	TAILQ_FOREACH (child, &pnode->children, next)
+		count += count_node(child, node);
+
+	return count;
+}
+
+int ec_pnode_count_node(const struct ec_pnode *pnode, const struct ec_node *node)
+{
+	struct ec_pnode *root;
+	const unsigned int *count;
+
+	if (pnode == NULL || node == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	root = ec_pnode_get_root((struct ec_pnode *)pnode);
+	if (!ec_node_is_tracked(node))
+		return count_node(root, node);
+	if (root->n_tracked == 0)
+		return 0;
+
+	if (root->occurrences == NULL) {
+		root->occurrences = ec_htable();
+		if (root->occurrences == NULL)
+			return -1;
+		if (occurrences_update(root->occurrences, root, true) < 0) {
+			ec_htable_free(root->occurrences);
+			root->occurrences = NULL;
+			return -1;
+		}
+	}
+
+	count = ec_htable_get(root->occurrences, &node, sizeof(node));
+	if (count == NULL)
+		return 0;
+
+	return *count;
+}
+
 struct ec_pnode *ec_pnode_get_first_child(const struct ec_pnode *pnode)
 {
 	return TAILQ_FIRST(&pnode->children);
@@ -392,59 +1241,156 @@ __ec_pnode_iter_next(const struct ec_pnode *root, struct ec_pnode *pnode, bool i
 	return NULL;
 }
 
-const struct ec_pnode *ec_pnode_find_next(
+const struct ec_pnode *ec_pnode_find_next_atom(
 	const struct ec_pnode *root,
 	const struct ec_pnode *prev,
-	const char *id,
+	const char *atom,
 	bool iter_children
 )
 {
+	const struct ec_htable *index;
+	const struct index_entry *entry;
 	const struct ec_pnode *iter;
+	unsigned int start;
+	size_t i;
 
-	if (root == NULL)
+	if (root == NULL || atom == NULL)
 		return NULL;
+
+	index = index_get(root);
+	if (index != NULL) {
+		entry = ec_htable_get(index, &atom, sizeof(atom));
+		if (entry == NULL)
+			return NULL;
+		if (prev == NULL)
+			start = root->order;
+		else if (iter_children)
+			start = prev->order + 1;
+		else
+			start = prev->order_end;
+		i = index_entry_search(entry, start);
+		if (i == entry->len || entry->pnodes[i]->order >= root->order_end)
+			return NULL;
+		return entry->pnodes[i];
+	}
+
 	if (prev == NULL)
 		prev = root;
 	else
 		prev = EC_PNODE_ITER_NEXT(root, prev, iter_children);
 
 	for (iter = prev; iter != NULL; iter = EC_PNODE_ITER_NEXT(root, iter, 1)) {
-		if (iter->node != NULL && !strcmp(ec_node_id(iter->node), id))
+		if (iter->node != NULL && ec_node_id(iter->node) == atom)
 			return iter;
 	}
 
 	return NULL;
 }
 
-const struct ec_pnode *ec_pnode_find(const struct ec_pnode *root, const char *id)
+const struct ec_pnode *ec_pnode_find_atom(const struct ec_pnode *root, const char *atom)
 {
-	return ec_pnode_find_next(root, NULL, id, 1);
+	return ec_pnode_find_next_atom(root, NULL, atom, 1);
 }
 
-unsigned int ec_pnode_count(const struct ec_pnode *root, const char *id)
+unsigned int ec_pnode_count_atom(const struct ec_pnode *root, const char *atom)
 {
+	const struct ec_htable *index;
+	const struct index_entry *entry;
 	const struct ec_pnode *iter;
 	unsigned int count = 0;
 
-	if (root == NULL)
+	if (root == NULL || atom == NULL)
 		return 0;
 
+	index = index_get(root);
+	if (index != NULL) {
+		entry = ec_htable_get(index, &atom, sizeof(atom));
+		if (entry == NULL)
+			return 0;
+		return index_entry_search(entry, root->order_end)
+			- index_entry_search(entry, root->order);
+	}
+
 	for (iter = root; iter != NULL; iter = EC_PNODE_ITER_NEXT(root, iter, 1)) {
-		if (iter->node != NULL && !strcmp(ec_node_id(iter->node), id))
+		if (iter->node != NULL && ec_node_id(iter->node) == atom)
 			count++;
 	}
 
 	return count;
 }
 
-struct ec_dict *ec_pnode_get_attrs(const struct ec_pnode *pnode)
+/* the string versions fail early if no node has this id */
+const struct ec_pnode *ec_pnode_find_next(
+	const struct ec_pnode *root,
+	const struct ec_pnode *prev,
+	const char *id,
+	bool iter_children
+)
+{
+	return ec_pnode_find_next_atom(root, prev, ec_atom_lookup(id), iter_children);
+}
+
+const struct ec_pnode *ec_pnode_find(const struct ec_pnode *root, const char *id)
+{
+	return ec_pnode_find_next_atom(root, NULL, ec_atom_lookup(id), 1);
+}
+
+unsigned int ec_pnode_count(const struct ec_pnode *root, const char *id)
+{
+	return ec_pnode_count_atom(root, ec_atom_lookup(id));
+}
+
+int ec_pnode_get_memo_stats(const struct ec_pnode *pnode, struct ec_parse_memo_stats *stats)
+{
+	if (pnode == NULL || stats == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ec_parse_ctx_get_memo_stats(pnode->ctx, stats);
+
+	return 0;
+}
+
+const struct ec_dict *ec_pnode_get_attrs(const struct ec_pnode *pnode)
 {
 	if (pnode == NULL)
 		return NULL;
 
+	if (pnode->attrs == NULL)
+		return ec_dict_empty();
+
 	return pnode->attrs;
 }
 
+int ec_pnode_set_attr(
+	struct ec_pnode *pnode,
+	const char *key,
+	void *val,
+	ec_dict_elt_free_t free_cb
+)
+{
+	if (pnode == NULL || key == NULL) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	if (pnode->attrs == NULL) {
+		pnode->attrs = ec_dict();
+		if (pnode->attrs == NULL)
+			goto fail;
+		if (ec_node_stats_enabled)
+			ec_node_stats_count_alloc();
+	}
+
+	return ec_dict_set(pnode->attrs, key, val, free_cb);
+
+fail:
+	if (free_cb != NULL)
+		free_cb(val);
+	return -1;
+}
+
 const struct ec_strvec *ec_pnode_get_strvec(const struct ec_pnode *pnode)
 {
 	if (pnode == NULL)
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#pragma once
+
+#include <ecoli/parse.h>
+
+/*
+ * Parsing context, shared by all the nodes of the parsing trees built
+ * during one top-level call to ec_parse_strvec_flags() or
+ * ec_complete_strvec_flags().
+ */
+struct ec_parse_ctx;
+
+/* Allocate a new parsing context. */
+struct ec_parse_ctx *ec_parse_ctx(ec_parse_flag_t flags);
+
+/* Free a parsing context. */
+void ec_parse_ctx_free(struct ec_parse_ctx *ctx);
+
+/* Release the resources that are only needed during the top-level call. */
+void ec_parse_ctx_done(struct ec_parse_ctx *ctx);
+
+/* Get the memoization counters of a parsing context. */
+void ec_parse_ctx_get_memo_stats(
+	const struct ec_parse_ctx *ctx,
+	struct ec_parse_memo_stats *stats
+);
+
+/*
+ * Allocate a parsing node attached to a context, which is not owned by
+ * the node. If ctx is NULL, this is the same as ec_pnode(). If the
+ * context has an arena, the node is allocated from it.
+ */
+struct ec_pnode *ec_pnode_alloc(const struct ec_node *node, struct ec_parse_ctx *ctx);
+
+/*
+ * Count the nodes of the parsing tree containing pnode that were parsed
+ * by the given grammar node. If the grammar node is tracked (see
+ * ec_node_track()), the count is stored in the root of the tree and
+ * updated when the parsing nodes are linked and unlinked. Return the
+ * count, or -1 on error.
+ */
+int ec_pnode_count_node(const struct ec_pnode *pnode, const struct ec_node *node);
@@ -0,0 +1,1322 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/htable.h>
+#include <ecoli/log.h>
+#include <ecoli/regex.h>
+#include <ecoli/utils.h>
+
+EC_LOG_TYPE_REGISTER(regex);
+
+/*
+ * The "dfa" backend. The expression is parsed into a syntax tree, which
+ * is converted to a non-deterministic automaton (Thompson construction),
+ * then to a deterministic one (subset construction). Anything the parser
+ * does not support makes the compilation fail with ENOTSUP, and the next
+ * backend is tried.
+ */
+
+#define RE_MAX_DEPTH 32 /* maximum nesting of groups */
+#define RE_DUP_LIMIT 255 /* maximum bound of a {m,n} repetition */
+#define RE_INF UINT_MAX /* no upper bound of a repetition */
+#define NFA_MAX_STATES 4096
+#define DFA_MAX_STATES 1024 /* must fit in the uint16_t transitions */
+#define DFA_MAX_PATTERNS 64 /* must fit in the uint64_t masks */
+#define DFA_DEAD 0 /* the state without transitions */
+#define DFA_START 1
+
+/* a set of bytes */
+struct re_set {
+	uint32_t bits[256 / 32];
+};
+
+enum re_node_type {
+	RE_SET, /* one byte of a set */
+	RE_EOL, /* the end of the string */
+	RE_CAT, /* left then right */
+	RE_ALT, /* left or right */
+	RE_REPEAT, /* left, from min to max times */
+};
+
+/* a node of the syntax tree, the children are indexes in the node table */
+struct re_node {
+	enum re_node_type type;
+	unsigned int set;
+	unsigned int left;
+	unsigned int right;
+	unsigned int min;
+	unsigned int max;
+};
+
+struct re_parser {
+	const char *cur;
+	unsigned int depth;
+	bool ascii; /* only ASCII characters can be matched (multibyte locale) */
+	bool ranges; /* ranges follow the byte order (C locale) */
+	bool probe; /* the bytes of the other ranges can be found with regexec(3) */
+	struct re_node *nodes;
+	size_t n_nodes;
+	struct re_set *sets;
+	size_t n_sets;
+};
+
+enum nfa_state_type {
+	NFA_EPS, /* go to the out states without consuming input */
+	NFA_SET, /* consume a byte of the set, go to out[0] */
+	NFA_EOL, /* at the end of the input, go to out[0] */
+	NFA_MATCH, /* the expression matches */
+};
+
+struct nfa_state {
+	enum nfa_state_type type;
+	unsigned int set;
+	unsigned int pattern; /* the index of the expression of an NFA_MATCH state */
+	unsigned int n_out;
+	unsigned int out[2];
+};
+
+struct nfa {
+	struct nfa_state *states;
+	size_t len;
+	size_t size;
+	const struct re_set *sets;
+};
+
+/* a part of the automaton: its end is an NFA_EPS state without out states */
+struct nfa_frag {
+	unsigned int start;
+	unsigned int end;
+};
+
+struct re_dfa {
+	uint8_t classes[256]; /* bytes that behave the same share a class */
+	unsigned int n_classes;
+	unsigned int n_states;
+	uint16_t *trans; /* next state, indexed by state * n_classes + class */
+	/* masks of expressions, bit i is set for expression i */
+	uint64_t *accept; /* matching the input read so far */
+	uint64_t *accept_end; /* matching the input read so far if it ends here */
+	uint64_t *live; /* that can still match when reading more input */
+};
+
+struct ec_regex_ops {
+	const char *name;
+	int (*compile)(struct ec_regex *re, const char *const *patterns);
+	void (*free)(struct ec_regex *re);
+	bool (*match)(const struct ec_regex *re, const char *str, bool full, size_t *len);
+	bool (*match_token)(const struct ec_regex *re, const char *str, size_t *index, size_t *len);
+};
+
+struct ec_regex {
+	const struct ec_regex_ops *ops;
+	size_t n; /* number of expressions */
+	union {
+		struct re_dfa *dfa;
+		regex_t *posix;
+	};
+};
+
+static void re_set_add(struct re_set *set, unsigned int c)
+{
+	set->bits[c / 32] |= 1U << (c % 32);
+}
+
+static bool re_set_has(const struct re_set *set, unsigned int c)
+{
+	return set->bits[c / 32] & (1U << (c % 32));
+}
+
+static void re_set_negate(struct re_set *set)
+{
+	size_t i;
+
+	for (i = 0; i < EC_COUNT_OF(set->bits); i++)
+		set->bits[i] = ~set->bits[i];
+	set->bits[0] &= ~1U; /* the terminating nul is never matched */
+}
+
+static int re_unsupported(const struct re_parser *parser)
+{
+	EC_LOG(EC_LOG_DEBUG, "unsupported regular expression at <%s>\n", parser->cur);
+	errno = ENOTSUP;
+	return -1;
+}
+
+static int re_node_new(struct re_parser *parser, enum re_node_type type)
+{
+	struct re_node *nodes;
+
+	nodes = realloc(parser->nodes, (parser->n_nodes + 1) * sizeof(*nodes));
+	if (nodes == NULL)
+		return -1;
+	parser->nodes = nodes;
+	memset(&nodes[parser->n_nodes], 0, sizeof(*nodes));
+	nodes[parser->n_nodes].type = type;
+
+	return parser->n_nodes++;
+}
+
+static int re_node_new_set(struct re_parser *parser, const struct re_set *set)
+{
+	struct re_set *sets;
+	int node;
+
+	sets = realloc(parser->sets, (parser->n_sets + 1) * sizeof(*sets));
+	if (sets == NULL)
+		return -1;
+	parser->sets = sets;
+	sets[parser->n_sets] = *set;
+
+	node = re_node_new(parser, RE_SET);
+	if (node < 0)
+		return -1;
+	parser->nodes[node].set = parser->n_sets++;
+
+	return node;
+}
+
+static int re_node_new_pair(struct re_parser *parser, enum re_node_type type, int left, int right)
+{
+	int node;
+
+	node = re_node_new(parser, type);
+	if (node < 0)
+		return -1;
+	parser->nodes[node].left = left;
+	parser->nodes[node].right = right;
+
+	return node;
+}
+
+/* parse a character class name, like "alpha" in "[[:alpha:]]" */
+static int re_parse_class(struct re_parser *parser, struct re_set *set)
+{
+	static const struct {
+		const char *name;
+		int (*is)(int c);
+	} classes[] = {
+		{"alnum", isalnum},
+		{"alpha", isalpha},
+		{"blank", isblank},
+		{"cntrl", iscntrl},
+		{"digit", isdigit},
+		{"graph", isgraph},
+		{"lower", islower},
+		{"print", isprint},
+		{"punct", ispunct},
+		{"space", isspace},
+		{"upper", isupper},
+		{"xdigit", isxdigit},
+	};
+	const char *end;
+	size_t i, len;
+	unsigned int c;
+
+	end = strstr(parser->cur, ":]");
+	if (end == NULL || parser->ascii)
+		return re_unsupported(parser);
+	len = end - parser->cur;
+
+	for (i = 0; i < EC_COUNT_OF(classes); i++) {
+		if (strlen(classes[i].name) != len || strncmp(classes[i].name, parser->cur, len))
+			continue;
+		for (c = 1; c < 256; c++) {
+			if (classes[i].is(c))
+				re_set_add(set, c);
+		}
+		parser->cur = end + 2;
+		return 0;
+	}
+
+	return re_unsupported(parser);
+}
+
+/*
+ * Find the bytes matched by a bracket expression, from its opening bracket
+ * to the current position, by matching each of them with regexec(3). In a
+ * multibyte locale, only the ASCII characters are probed.
+ */
+static int re_probe_bracket(struct re_parser *parser, const char *bracket, struct re_set *set)
+{
+	size_t len = parser->cur - bracket;
+	char str[2] = {0};
+	unsigned int c, max;
+	regex_t posix;
+	char *pattern;
+	int ret;
+
+	pattern = malloc(len + 3);
+	if (pattern == NULL)
+		return -1;
+	pattern[0] = '^';
+	memcpy(&pattern[1], bracket, len);
+	pattern[len + 1] = '$';
+	pattern[len + 2] = '\0';
+	ret = regcomp(&posix, pattern, REG_EXTENDED | REG_NOSUB);
+	free(pattern);
+	/* the posix backend reports the invalid expressions */
+	if (ret != 0)
+		return re_unsupported(parser);
+
+	memset(set, 0, sizeof(*set));
+	max = parser->ascii ? 0x7f : 0xff;
+	for (c = 1; c <= max; c++) {
+		str[0] = c;
+		if (regexec(&posix, str, 0, NULL, 0) == 0)
+			re_set_add(set, c);
+	}
+	regfree(&posix);
+
+	return 0;
+}
+
+/* parse a bracket expression, after the opening bracket */
+static int re_parse_bracket(struct re_parser *parser)
+{
+	const char *bracket = parser->cur - 1;
+	struct re_set set = {0};
+	bool negate = false, probe = false;
+	unsigned int c, last;
+
+	if (*parser->cur == '^') {
+		if (parser->ascii)
+			return re_unsupported(parser);
+		negate = true;
+		parser->cur++;
+	}
+
+	/* a closing bracket is a literal at the start of the list */
+	if (*parser->cur == ']') {
+		re_set_add(&set, ']');
+		parser->cur++;
+	}
+
+	while (*parser->cur != ']') {
+		if (parser->cur[0] == '[' && parser->cur[1] == ':') {
+			parser->cur += 2;
+			if (re_parse_class(parser, &set) < 0)
+				return -1;
+			continue;
+		}
+		if (parser->cur[0] == '[' && (parser->cur[1] == '.' || parser->cur[1] == '='))
+			return re_unsupported(parser);
+
+		c = (unsigned char)*parser->cur;
+		if (c == '\0' || (c >= 0x80 && parser->ascii))
+			return re_unsupported(parser);
+		parser->cur++;
+
+		if (parser->cur[0] != '-' || parser->cur[1] == ']') {
+			re_set_add(&set, c);
+			continue;
+		}
+
+		parser->cur++;
+		last = (unsigned char)*parser->cur;
+		if (last == '\0' || (last >= 0x80 && parser->ascii)
+		    || (last == '[' && strchr(".=:", parser->cur[1]) != NULL))
+			return re_unsupported(parser);
+		parser->cur++;
+		if (!parser->ranges) {
+			/* the order depends on the locale, ask the C library */
+			if (!parser->probe)
+				return re_unsupported(parser);
+			probe = true;
+			continue;
+		}
+		if (last < c)
+			return re_unsupported(parser);
+		for (; c <= last; c++)
+			re_set_add(&set, c);
+	}
+	parser->cur++;
+
+	if (probe) {
+		if (re_probe_bracket(parser, bracket, &set) < 0)
+			return -1;
+	} else if (negate) {
+		re_set_negate(&set);
+	}
+
+	return re_node_new_set(parser, &set);
+}
+
+static int re_parse_alt(struct re_parser *parser);
+
+static int re_parse_atom(struct re_parser *parser)
+{
+	struct re_set set = {0};
+	unsigned int c;
+	int node;
+
+	c = (unsigned char)*parser->cur;
+	switch (c) {
+	case '(':
+		if (parser->depth == RE_MAX_DEPTH)
+			return re_unsupported(parser);
+		parser->cur++;
+		parser->depth++;
+		node = re_parse_alt(parser);
+		parser->depth--;
+		if (node < 0)
+			return -1;
+		if (*parser->cur != ')')
+			return re_unsupported(parser);
+		parser->cur++;
+		return node;
+	case '[':
+		parser->cur++;
+		return re_parse_bracket(parser);
+	case '.':
+		if (parser->ascii)
+			return re_unsupported(parser);
+		parser->cur++;
+		re_set_negate(&set);
+		return re_node_new_set(parser, &set);
+	case '\\':
+		/* escaped letters and digits are extensions or back-references */
+		c = (unsigned char)parser->cur[1];
+		if (c == '\0' || isalnum(c) || c >= 0x80)
+			return re_unsupported(parser);
+		parser->cur += 2;
+		re_set_add(&set, c);
+		return re_node_new_set(parser, &set);
+	case '\0':
+	case ')':
+	case '|':
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+	case '^':
+	case '$':
+		return re_unsupported(parser);
+	default:
+		if (c >= 0x80 && parser->ascii)
+			return re_unsupported(parser);
+		parser->cur++;
+		re_set_add(&set, c);
+		return re_node_new_set(parser, &set);
+	}
+}
+
+/* parse the bounds of a {m,n} repetition, after the opening brace */
+static int re_parse_bounds(struct re_parser *parser, unsigned int *min, unsigned int *max)
+{
+	char *end;
+
+	if (!isdigit((unsigned char)*parser->cur))
+		return re_unsupported(parser);
+	*min = strtoul(parser->cur, &end, 10);
+	parser->cur = end;
+	*max = *min;
+
+	if (*parser->cur == ',') {
+		parser->cur++;
+		*max = RE_INF;
+		if (isdigit((unsigned char)*parser->cur)) {
+			*max = strtoul(parser->cur, &end, 10);
+			parser->cur = end;
+		}
+	}
+
+	if (*parser->cur != '}' || *min > RE_DUP_LIMIT
+	    || (*max != RE_INF && (*max > RE_DUP_LIMIT || *max < *min)))
+		return re_unsupported(parser);
+	parser->cur++;
+
+	return 0;
+}
+
+static int re_parse_repeat(struct re_parser *parser)
+{
+	unsigned int min = 0, max = 0;
+	int node, repeat;
+
+	node = re_parse_atom(parser);
+	if (node < 0)
+		return -1;
+
+	while (strchr("*+?{", *parser->cur) != NULL && *parser->cur != '\0') {
+		switch (*parser->cur++) {
+		case '*':
+			min = 0;
+			max = RE_INF;
+			break;
+		case '+':
+			min = 1;
+			max = RE_INF;
+			break;
+		case '?':
+			min = 0;
+			max = 1;
+			break;
+		default:
+			if (re_parse_bounds(parser, &min, &max) < 0)
+				return -1;
+			break;
+		}
+
+		repeat = re_node_new(parser, RE_REPEAT);
+		if (repeat < 0)
+			return -1;
+		parser->nodes[repeat].left = node;
+		parser->nodes[repeat].min = min;
+		parser->nodes[repeat].max = max;
+		node = repeat;
+	}
+
+	return node;
+}
+
+/*
+ * Parse a branch of an alternative. The matches are anchored, so "^" is
+ * ignored at the start of a top-level branch, and "$" is only supported
+ * at its end.
+ */
+static int re_parse_cat(struct re_parser *parser)
+{
+	int node = -1, next;
+
+	if (*parser->cur == '^' && parser->depth == 0)
+		parser->cur++;
+
+	while (*parser->cur != '\0' && *parser->cur != '|' && *parser->cur != ')') {
+		if (*parser->cur == '$' && parser->depth == 0
+		    && (parser->cur[1] == '\0' || parser->cur[1] == '|')) {
+			parser->cur++;
+			next = re_node_new(parser, RE_EOL);
+		} else {
+			next = re_parse_repeat(parser);
+		}
+		if (next < 0)
+			return -1;
+		if (node < 0)
+			node = next;
+		else
+			node = re_node_new_pair(parser, RE_CAT, node, next);
+		if (node < 0)
+			return -1;
+	}
+
+	/* empty branches are handled differently by the C libraries */
+	if (node < 0)
+		return re_unsupported(parser);
+
+	return node;
+}
+
+static int re_parse_alt(struct re_parser *parser)
+{
+	int node, next;
+
+	node = re_parse_cat(parser);
+	if (node < 0)
+		return -1;
+
+	while (*parser->cur == '|') {
+		parser->cur++;
+		next = re_parse_cat(parser);
+		if (next < 0)
+			return -1;
+		node = re_node_new_pair(parser, RE_ALT, node, next);
+		if (node < 0)
+			return -1;
+	}
+
+	return node;
+}
+
+static int nfa_state_new(struct nfa *nfa, enum nfa_state_type type)
+{
+	struct nfa_state *states;
+	size_t size;
+
+	if (nfa->len == NFA_MAX_STATES) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if (nfa->len == nfa->size) {
+		size = nfa->size == 0 ? 16 : nfa->size * 2;
+		states = realloc(nfa->states, size * sizeof(*states));
+		if (states == NULL)
+			return -1;
+		nfa->states = states;
+		nfa->size = size;
+	}
+
+	memset(&nfa->states[nfa->len], 0, sizeof(*nfa->states));
+	nfa->states[nfa->len].type = type;
+
+	return nfa->len++;
+}
+
+static void nfa_link(struct nfa *nfa, unsigned int from, unsigned int to)
+{
+	struct nfa_state *state = &nfa->states[from];
+
+	state->out[state->n_out++] = to;
+}
+
+/* create a state and a fragment ending with an empty state */
+static int nfa_frag_new(struct nfa *nfa, enum nfa_state_type type, struct nfa_frag *frag)
+{
+	int start, end;
+
+	start = nfa_state_new(nfa, type);
+	if (start < 0)
+		return -1;
+	end = nfa_state_new(nfa, NFA_EPS);
+	if (end < 0)
+		return -1;
+	nfa_link(nfa, start, end);
+
+	frag->start = start;
+	frag->end = end;
+
+	return 0;
+}
+
+static int
+nfa_build(struct nfa *nfa, const struct re_node *nodes, unsigned int node, struct nfa_frag *frag);
+
+/* append a repetition of a node to a fragment */
+static int nfa_build_repeat(
+	struct nfa *nfa,
+	const struct re_node *nodes,
+	const struct re_node *repeat,
+	struct nfa_frag *frag
+)
+{
+	struct nfa_frag child;
+	unsigned int i;
+	int loop, end;
+
+	for (i = 0; i < repeat->min; i++) {
+		if (nfa_build(nfa, nodes, repeat->left, &child) < 0)
+			return -1;
+		nfa_link(nfa, frag->end, child.start);
+		frag->end = child.end;
+	}
+
+	for (; repeat->max == RE_INF || i < repeat->max; i++) {
+		loop = nfa_state_new(nfa, NFA_EPS);
+		if (loop < 0)
+			return -1;
+		end = nfa_state_new(nfa, NFA_EPS);
+		if (end < 0)
+			return -1;
+		if (nfa_build(nfa, nodes, repeat->left, &child) < 0)
+			return -1;
+		nfa_link(nfa, frag->end, loop);
+		nfa_link(nfa, loop, child.start);
+		nfa_link(nfa, loop, end);
+		if (repeat->max == RE_INF) {
+			nfa_link(nfa, child.end, loop);
+			frag->end = end;
+			break;
+		}
+		nfa_link(nfa, child.end, end);
+		frag->end = end;
+	}
+
+	return 0;
+}
+
+static int
+nfa_build(struct nfa *nfa, const struct re_node *nodes, unsigned int node, struct nfa_frag *frag)
+{
+	const struct re_node *n = &nodes[node];
+	struct nfa_frag left, right;
+	int start, end;
+
+	switch (n->type) {
+	case RE_SET:
+		if (nfa_frag_new(nfa, NFA_SET, frag) < 0)
+			return -1;
+		nfa->states[frag->start].set = n->set;
+		return 0;
+	case RE_EOL:
+		return nfa_frag_new(nfa, NFA_EOL, frag);
+	case RE_CAT:
+		if (nfa_build(nfa, nodes, n->left, &left) < 0)
+			return -1;
+		if (nfa_build(nfa, nodes, n->right, &right) < 0)
+			return -1;
+		nfa_link(nfa, left.end, right.start);
+		frag->start = left.start;
+		frag->end = right.end;
+		return 0;
+	case RE_ALT:
+		if (nfa_build(nfa, nodes, n->left, &left) < 0)
+			return -1;
+		if (nfa_build(nfa, nodes, n->right, &right) < 0)
+			return -1;
+		start = nfa_state_new(nfa, NFA_EPS);
+		if (start < 0)
+			return -1;
+		end = nfa_state_new(nfa, NFA_EPS);
+		if (end < 0)
+			return -1;
+		nfa_link(nfa, start, left.start);
+		nfa_link(nfa, start, right.start);
+		nfa_link(nfa, left.end, end);
+		nfa_link(nfa, right.end, end);
+		frag->start = start;
+		frag->end = end;
+		return 0;
+	case RE_REPEAT:
+		start = nfa_state_new(nfa, NFA_EPS);
+		if (start < 0)
+			return -1;
+		frag->start = start;
+		frag->end = start;
+		return nfa_build_repeat(nfa, nodes, n, frag);
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+/*
+ * Parse a pattern and build its automaton, ending with an NFA_MATCH
+ * state. The sets of all the patterns are kept in the parser.
+ */
+static int
+nfa_compile(struct nfa *nfa, struct re_parser *parser, const char *pattern, unsigned int index)
+{
+	struct nfa_frag frag;
+	int node, match;
+
+	parser->cur = pattern;
+	parser->depth = 0;
+	parser->n_nodes = 0;
+
+	node = re_parse_alt(parser);
+	if (node < 0)
+		return -1;
+	if (*parser->cur != '\0')
+		return re_unsupported(parser);
+
+	if (nfa_build(nfa, parser->nodes, node, &frag) < 0)
+		return -1;
+	match = nfa_state_new(nfa, NFA_MATCH);
+	if (match < 0)
+		return -1;
+	nfa->states[match].pattern = index;
+	nfa_link(nfa, frag.end, match);
+
+	return frag.start;
+}
+
+/*
+ * Split the bytes into classes: two bytes are in the same class if they
+ * belong to the same sets.
+ */
+static void dfa_build_classes(struct re_dfa *dfa, const struct re_set *sets, size_t n_sets)
+{
+	uint16_t split[256][2];
+	unsigned int c, n;
+	size_t i;
+	bool in;
+
+	memset(dfa->classes, 0, sizeof(dfa->classes));
+	dfa->n_classes = 1;
+
+	for (i = 0; i < n_sets; i++) {
+		memset(split, 0xff, sizeof(split));
+		n = 0;
+		for (c = 0; c < 256; c++) {
+			in = re_set_has(&sets[i], c);
+			if (split[dfa->classes[c]][in] == UINT16_MAX)
+				split[dfa->classes[c]][in] = n++;
+			dfa->classes[c] = split[dfa->classes[c]][in];
+		}
+		dfa->n_classes = n;
+	}
+}
+
+/*
+ * Add the states reachable without consuming input to a sorted list of
+ * states. Only the states that consume input or match are kept: they
+ * identify a state of the deterministic automaton.
+ */
+static void nfa_closure(
+	const struct nfa *nfa,
+	unsigned int state,
+	bool *visited,
+	unsigned int *stack,
+	unsigned int *list,
+	size_t *len
+)
+{
+	const struct nfa_state *s;
+	size_t sp = 0, i;
+
+	if (visited[state])
+		return;
+	visited[state] = true;
+	stack[sp++] = state;
+
+	while (sp > 0) {
+		s = &nfa->states[stack[--sp]];
+		if (s->type != NFA_EPS) {
+			list[(*len)++] = s - nfa->states;
+			continue;
+		}
+		for (i = 0; i < s->n_out; i++) {
+			if (visited[s->out[i]])
+				continue;
+			visited[s->out[i]] = true;
+			stack[sp++] = s->out[i];
+		}
+	}
+}
+
+static int uint_cmp(const void *p1, const void *p2)
+{
+	unsigned int u1 = *(const unsigned int *)p1, u2 = *(const unsigned int *)p2;
+
+	return (u1 > u2) - (u1 < u2);
+}
+
+struct dfa_builder {
+	const struct nfa *nfa;
+	struct re_dfa *dfa;
+	struct ec_htable *ids; /* list of nfa states -> dfa state + 1 */
+	unsigned int **lists; /* nfa states of each dfa state */
+	size_t *lens;
+	size_t size;
+	bool *visited;
+	unsigned int *stack;
+	unsigned int *list;
+};
+
+/* get the state of the deterministic automaton for a list of states */
+static int dfa_state_get(struct dfa_builder *b, unsigned int *list, size_t len)
+{
+	const struct nfa_state *s, *eol;
+	struct re_dfa *dfa = b->dfa;
+	unsigned int state;
+	size_t i, size;
+	void *ptr, *id;
+
+	if (len == 0 && dfa->n_states > 0)
+		return DFA_DEAD;
+
+	qsort(list, len, sizeof(*list), uint_cmp);
+	if (len > 0) {
+		ptr = ec_htable_get(b->ids, list, len * sizeof(*list));
+		if (ptr != NULL)
+			return (uintptr_t)ptr - 1;
+	}
+
+	if (dfa->n_states == DFA_MAX_STATES) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if (dfa->n_states == b->size) {
+		size = b->size * 2;
+		ptr = realloc(dfa->trans, size * dfa->n_classes * sizeof(*dfa->trans));
+		if (ptr == NULL)
+			return -1;
+		dfa->trans = ptr;
+		ptr = realloc(dfa->accept, size * sizeof(*dfa->accept));
+		if (ptr == NULL)
+			return -1;
+		dfa->accept = ptr;
+		ptr = realloc(dfa->accept_end, size * sizeof(*dfa->accept_end));
+		if (ptr == NULL)
+			return -1;
+		dfa->accept_end = ptr;
+		ptr = realloc(b->lists, size * sizeof(*b->lists));
+		if (ptr == NULL)
+			return -1;
+		b->lists = ptr;
+		ptr = realloc(b->lens, size * sizeof(*b->lens));
+		if (ptr == NULL)
+			return -1;
+		b->lens = ptr;
+		b->size = size;
+	}
+
+	state = dfa->n_states;
+	b->lists[state] = malloc(len * sizeof(*list) + 1);
+	if (b->lists[state] == NULL)
+		return -1;
+	memcpy(b->lists[state], list, len * sizeof(*list));
+	b->lens[state] = len;
+	/* the state is stored plus one, so that a NULL value means no state */
+	id = (void *)(uintptr_t)(state + 1);
+	if (len > 0 && ec_htable_set(b->ids, list, len * sizeof(*list), id, NULL) < 0) {
+		free(b->lists[state]);
+		return -1;
+	}
+	dfa->n_states++;
+
+	/* "$" is only supported at the end of the pattern: it is followed by the match */
+	dfa->accept[state] = 0;
+	dfa->accept_end[state] = 0;
+	for (i = 0; i < len; i++) {
+		s = &b->nfa->states[list[i]];
+		if (s->type == NFA_MATCH) {
+			dfa->accept[state] |= UINT64_C(1) << s->pattern;
+		} else if (s->type == NFA_EOL) {
+			for (eol = s; eol->type == NFA_EPS || eol->type == NFA_EOL;
+			     eol = &b->nfa->states[eol->out[0]])
+				;
+			if (eol->type == NFA_MATCH)
+				dfa->accept_end[state] |= UINT64_C(1) << eol->pattern;
+		}
+	}
+	dfa->accept_end[state] |= dfa->accept[state];
+
+	return state;
+}
+
+/* compute the transitions of a state of the deterministic automaton */
+static int dfa_state_build(struct dfa_builder *b, unsigned int state)
+{
+	const struct nfa_state *s;
+	struct re_dfa *dfa = b->dfa;
+	unsigned int c, cls;
+	size_t i, len;
+	bool done[256];
+	int next;
+
+	memset(done, 0, sizeof(done));
+	for (c = 0; c < 256; c++) {
+		cls = dfa->classes[c];
+		if (done[cls])
+			continue;
+		done[cls] = true;
+
+		memset(b->visited, 0, b->nfa->len * sizeof(*b->visited));
+		len = 0;
+		for (i = 0; i < b->lens[state]; i++) {
+			s = &b->nfa->states[b->lists[state][i]];
+			if (s->type == NFA_SET && re_set_has(&b->nfa->sets[s->set], c))
+				nfa_closure(b->nfa, s->out[0], b->visited, b->stack, b->list, &len);
+		}
+
+		next = dfa_state_get(b, b->list, len);
+		if (next < 0)
+			return -1;
+		dfa->trans[state * dfa->n_classes + cls] = next;
+	}
+
+	return 0;
+}
+
+/* compute the expressions that each state can still match */
+static void dfa_build_live(struct re_dfa *dfa)
+{
+	unsigned int state, cls;
+	bool changed = true;
+	uint64_t live;
+
+	for (state = 0; state < dfa->n_states; state++)
+		dfa->live[state] = dfa->accept_end[state];
+
+	while (changed) {
+		changed = false;
+		for (state = 0; state < dfa->n_states; state++) {
+			live = dfa->live[state];
+			for (cls = 0; cls < dfa->n_classes; cls++)
+				live |= dfa->live[dfa->trans[state * dfa->n_classes + cls]];
+			if (live != dfa->live[state]) {
+				dfa->live[state] = live;
+				changed = true;
+			}
+		}
+	}
+}
+
+static int
+dfa_build(struct re_dfa *dfa, const struct nfa *nfa, const unsigned int *starts, size_t n_starts)
+{
+	struct dfa_builder b;
+	unsigned int state;
+	size_t i, len = 0;
+	int ret = -1;
+
+	memset(&b, 0, sizeof(b));
+	b.nfa = nfa;
+	b.dfa = dfa;
+	b.size = 16;
+	b.ids = ec_htable();
+	b.lists = calloc(b.size, sizeof(*b.lists));
+	b.lens = calloc(b.size, sizeof(*b.lens));
+	b.visited = calloc(nfa->len, sizeof(*b.visited));
+	b.stack = calloc(nfa->len, sizeof(*b.stack));
+	b.list = calloc(nfa->len, sizeof(*b.list));
+	dfa->trans = calloc(b.size * dfa->n_classes, sizeof(*dfa->trans));
+	dfa->accept = calloc(b.size, sizeof(*dfa->accept));
+	dfa->accept_end = calloc(b.size, sizeof(*dfa->accept_end));
+	if (b.ids == NULL || b.lists == NULL || b.lens == NULL || b.visited == NULL
+	    || b.stack == NULL || b.list == NULL || dfa->trans == NULL || dfa->accept == NULL
+	    || dfa->accept_end == NULL)
+		goto out;
+
+	/* the dead state has an empty list */
+	if (dfa_state_get(&b, b.list, 0) != DFA_DEAD)
+		goto out;
+	for (i = 0; i < n_starts; i++)
+		nfa_closure(nfa, starts[i], b.visited, b.stack, b.list, &len);
+	if (dfa_state_get(&b, b.list, len) != DFA_START)
+		goto out;
+
+	for (state = 0; state < dfa->n_states; state++) {
+		if (dfa_state_build(&b, state) < 0)
+			goto out;
+	}
+
+	dfa->live = calloc(dfa->n_states, sizeof(*dfa->live));
+	if (dfa->live == NULL)
+		goto out;
+	dfa_build_live(dfa);
+
+	ret = 0;
+
+out:
+	for (state = 0; state < dfa->n_states; state++)
+		free(b.lists[state]);
+	free(b.lists);
+	free(b.lens);
+	free(b.visited);
+	free(b.stack);
+	free(b.list);
+	ec_htable_free(b.ids);
+	return ret;
+}
+
+static void re_dfa_free(struct re_dfa *dfa)
+{
+	if (dfa == NULL)
+		return;
+
+	free(dfa->trans);
+	free(dfa->accept);
+	free(dfa->accept_end);
+	free(dfa->live);
+	free(dfa);
+}
+
+static int dfa_compile(struct ec_regex *re, const char *const *patterns)
+{
+	unsigned int *starts = NULL;
+	struct re_parser parser;
+	struct nfa nfa = {0};
+	struct re_dfa *dfa = NULL;
+	const char *collate;
+	int start;
+	size_t i;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.ascii = MB_CUR_MAX > 1;
+	collate = setlocale(LC_COLLATE, NULL);
+	parser.ranges = collate == NULL || !strcmp(collate, "C") || !strcmp(collate, "POSIX");
+	/*
+	 * In a multibyte locale, a range between ASCII characters can also
+	 * match other characters, unless they are sorted by code point.
+	 */
+	parser.probe = !parser.ascii || (collate != NULL && !strncmp(collate, "C.", 2));
+
+	if (re->n > DFA_MAX_PATTERNS) {
+		errno = ENOTSUP;
+		goto fail;
+	}
+
+	dfa = calloc(1, sizeof(*dfa));
+	starts = calloc(re->n, sizeof(*starts));
+	if (dfa == NULL || starts == NULL)
+		goto fail;
+
+	for (i = 0; i < re->n; i++) {
+		start = nfa_compile(&nfa, &parser, patterns[i], i);
+		if (start < 0)
+			goto fail;
+		starts[i] = start;
+	}
+	nfa.sets = parser.sets;
+	dfa_build_classes(dfa, parser.sets, parser.n_sets);
+	if (dfa_build(dfa, &nfa, starts, re->n) < 0)
+		goto fail;
+
+	free(starts);
+	free(parser.nodes);
+	free(parser.sets);
+	free(nfa.states);
+	re->dfa = dfa;
+
+	return 0;
+
+fail:
+	free(starts);
+	free(parser.nodes);
+	free(parser.sets);
+	free(nfa.states);
+	re_dfa_free(dfa);
+	return -1;
+}
+
+static void dfa_free(struct ec_regex *re)
+{
+	re_dfa_free(re->dfa);
+}
+
+static bool dfa_match(const struct ec_regex *re, const char *str, bool full, size_t *len)
+{
+	const struct re_dfa *dfa = re->dfa;
+	unsigned int state = DFA_START;
+	bool found = false;
+	size_t i;
+
+	for (i = 0;; i++) {
+		if (str[i] == '\0') {
+			if (dfa->accept_end[state] != 0) {
+				*len = i;
+				found = true;
+			}
+			break;
+		}
+		if (!full && dfa->accept[state] != 0) {
+			*len = i;
+			found = true;
+		}
+		state = dfa->trans[state * dfa->n_classes + dfa->classes[(unsigned char)str[i]]];
+		if (state == DFA_DEAD)
+			break;
+	}
+
+	return found;
+}
+
+/*
+ * Read the input until no expression with a higher priority than the
+ * best one found so far can match.
+ */
+static bool dfa_match_token(const struct ec_regex *re, const char *str, size_t *index, size_t *len)
+{
+	const struct re_dfa *dfa = re->dfa;
+	unsigned int state = DFA_START;
+	uint64_t mask, best = 0;
+	size_t i;
+
+	for (i = 0; str[i] != '\0'; i++) {
+		state = dfa->trans[state * dfa->n_classes + dfa->classes[(unsigned char)str[i]]];
+		if (str[i + 1] == '\0')
+			mask = dfa->accept_end[state];
+		else
+			mask = dfa->accept[state];
+
+		/*
+		 * keep the lowest expression, and its longest match
+		 * (best - 1 is ~0 if best is 0)
+		 */
+		if (mask & (best - 1))
+			best = mask & -mask;
+		if (mask & best)
+			*len = i + 1;
+		if ((dfa->live[state] & (best | (best - 1))) == 0)
+			break;
+	}
+
+	if (best == 0)
+		return false;
+
+	for (*index = 0; !(best & 1); best >>= 1)
+		(*index)++;
+
+	return true;
+}
+
+static void posix_free(struct ec_regex *re)
+{
+	size_t i;
+
+	if (re->posix == NULL)
+		return;
+
+	for (i = 0; i < re->n; i++)
+		regfree(&re->posix[i]);
+	free(re->posix);
+	re->posix = NULL;
+}
+
+static int posix_compile(struct ec_regex *re, const char *const *patterns)
+{
+	size_t i;
+	int ret;
+
+	re->posix = calloc(re->n, sizeof(*re->posix));
+	if (re->posix == NULL)
+		return -1;
+
+	for (i = 0; i < re->n; i++) {
+		ret = regcomp(&re->posix[i], patterns[i], REG_EXTENDED);
+		if (ret != 0) {
+			/* only free the expressions compiled so far */
+			re->n = i;
+			posix_free(re);
+			if (ret == REG_ESPACE)
+				errno = ENOMEM;
+			else
+				errno = EINVAL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static bool posix_match_one(const regex_t *posix, const char *str, bool full, size_t *len)
+{
+	regmatch_t pos;
+
+	if (regexec(posix, str, 1, &pos, 0) != 0 || pos.rm_so != 0)
+		return false;
+	if (full && str[pos.rm_eo] != '\0')
+		return false;
+	*len = pos.rm_eo;
+
+	return true;
+}
+
+static bool posix_match(const struct ec_regex *re, const char *str, bool full, size_t *len)
+{
+	bool found = false;
+	size_t i, l;
+
+	for (i = 0; i < re->n; i++) {
+		if (!posix_match_one(&re->posix[i], str, full, &l))
+			continue;
+		if (!found || l > *len)
+			*len = l;
+		found = true;
+	}
+
+	return found;
+}
+
+static bool
+posix_match_token(const struct ec_regex *re, const char *str, size_t *index, size_t *len)
+{
+	size_t i;
+
+	for (i = 0; i < re->n; i++) {
+		if (posix_match_one(&re->posix[i], str, false, len) && *len > 0) {
+			*index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static const struct ec_regex_ops dfa_ops = {
+	.name = "dfa",
+	.compile = dfa_compile,
+	.free = dfa_free,
+	.match = dfa_match,
+	.match_token = dfa_match_token,
+};
+
+static const struct ec_regex_ops posix_ops = {
+	.name = "posix",
+	.compile = posix_compile,
+	.free = posix_free,
+	.match = posix_match,
+	.match_token = posix_match_token,
+};
+
+/* the backends, in order of preference */
+static const struct ec_regex_ops *const ec_regex_backends[] = {
+	&dfa_ops,
+	&posix_ops,
+};
+
+struct ec_regex *ec_regex_list(const char *const *patterns, size_t n, unsigned int flags)
+{
+	struct ec_regex *re;
+	size_t i;
+
+	if (patterns == NULL || n == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	for (i = 0; i < n; i++) {
+		if (patterns[i] == NULL) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	re = calloc(1, sizeof(*re));
+	if (re == NULL)
+		return NULL;
+
+	for (i = 0; i < EC_COUNT_OF(ec_regex_backends); i++) {
+		if ((flags & EC_REGEX_POSIX) && ec_regex_backends[i] != &posix_ops)
+			continue;
+		re->n = n;
+		if (ec_regex_backends[i]->compile(re, patterns) == 0) {
+			re->ops = ec_regex_backends[i];
+			return re;
+		}
+		if (errno != ENOTSUP)
+			break;
+	}
+
+	free(re);
+	return NULL;
+}
+
+struct ec_regex *ec_regex(const char *pattern, unsigned int flags)
+{
+	return ec_regex_list(&pattern, 1, flags);
+}
+
+void ec_regex_free(struct ec_regex *re)
+{
+	if (re == NULL)
+		return;
+
+	re->ops->free(re);
+	free(re);
+}
+
+const char *ec_regex_backend(const struct ec_regex *re)
+{
+	return re->ops->name;
+}
+
+bool ec_regex_match(const struct ec_regex *re, const char *str)
+{
+	size_t len;
+
+	return re->ops->match(re, str, true, &len);
+}
+
+bool ec_regex_match_prefix(const struct ec_regex *re, const char *str, size_t *len)
+{
+	return re->ops->match(re, str, false, len);
+}
+
+bool ec_regex_match_token(const struct ec_regex *re, const char *str, size_t *index, size_t *len)
+{
+	return re->ops->match_token(re, str, index, len);
+}
@@ -4,6 +4,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,18 +17,9 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
-EC_LOG_TYPE_REGISTER(strvec);
+#include "strvec_private.h"
 
-struct ec_strvec_elt {
-	unsigned int refcnt;
-	char *str;
-	struct ec_dict *attrs;
-};
-
-struct ec_strvec {
-	size_t len;
-	struct ec_strvec_elt **vec;
-};
+EC_LOG_TYPE_REGISTER(strvec);
 
 struct ec_strvec *ec_strvec(void)
 {
@@ -40,19 +32,18 @@ struct ec_strvec *ec_strvec(void)
 	return strvec;
 }
 
+/* the element and its string are allocated in one block */
 static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
 {
 	struct ec_strvec_elt *elt;
+	size_t len = strlen(s) + 1;
 
-	elt = calloc(1, sizeof(*elt));
+	elt = calloc(1, sizeof(*elt) + len);
 	if (elt == NULL)
 		return NULL;
 
-	elt->str = strdup(s);
-	if (elt->str == NULL) {
-		free(elt);
-		return NULL;
-	}
+	elt->str = (char *)(elt + 1);
+	memcpy(elt->str, s, len);
 	elt->refcnt = 1;
 
 	return elt;
@@ -61,11 +52,79 @@ static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
 static void __ec_strvec_elt_free(struct ec_strvec_elt *elt)
 {
 	elt->refcnt--;
-	if (elt->refcnt == 0) {
-		free(elt->str);
-		ec_dict_free(elt->attrs);
+	if (elt->refcnt > 0)
+		return;
+
+	ec_dict_free(elt->attrs);
+	if (elt->pool == NULL)
 		free(elt);
+	else if (--elt->pool->refcnt == 0)
+		free(elt->pool);
+}
+
+/*
+ * Allocate a pool of n elements, with str_size bytes for their strings.
+ * The elements are initialized by __ec_strvec_add_pooled().
+ */
+static struct ec_strvec_pool *__ec_strvec_pool(size_t n, size_t str_size, char **str)
+{
+	struct ec_strvec_pool *pool;
+
+	pool = malloc(sizeof(*pool) + n * sizeof(*pool->elts) + str_size);
+	if (pool == NULL)
+		return NULL;
+
+	pool->refcnt = 0;
+	*str = (char *)&pool->elts[n];
+
+	return pool;
+}
+
+/*
+ * Append the element idx of a pool, with a string stored in the pool.
+ * There must be room for it in the vector.
+ */
+static struct ec_strvec_elt *
+__ec_strvec_add_pooled(struct ec_strvec *strvec, struct ec_strvec_pool *pool, size_t idx, char *str)
+{
+	struct ec_strvec_elt *elt = &pool->elts[idx];
+
+	memset(elt, 0, sizeof(*elt));
+	elt->refcnt = 1;
+	elt->str = str;
+	elt->pool = pool;
+	pool->refcnt++;
+	strvec->vec[strvec->len++] = elt;
+
+	return elt;
+}
+
+/* Resize the table of elements to hold size > len of them. */
+static int __ec_strvec_resize(struct ec_strvec *strvec, size_t size)
+{
+	struct ec_strvec_elt **vec;
+
+	vec = realloc(strvec->vec, size * sizeof(*vec));
+	if (vec == NULL)
+		return -1;
+
+	strvec->vec = vec;
+	strvec->size = size;
+
+	return 0;
+}
+
+int ec_strvec_reserve(struct ec_strvec *strvec, size_t size)
+{
+	if (strvec == NULL) {
+		errno = EINVAL;
+		return -1;
 	}
+
+	if (size <= strvec->size)
+		return 0;
+
+	return __ec_strvec_resize(strvec, size);
 }
 
 int ec_strvec_set(struct ec_strvec *strvec, size_t idx, const char *s)
@@ -89,41 +148,61 @@ int ec_strvec_set(struct ec_strvec *strvec, size_t idx, const char *s)
 
 int ec_strvec_add(struct ec_strvec *strvec, const char *s)
 {
-	struct ec_strvec_elt *elt, **new_vec;
+	struct ec_strvec_elt *elt;
 
 	if (strvec == NULL || s == NULL) {
 		errno = EINVAL;
 		return -1;
 	}
 
-	new_vec = realloc(strvec->vec, sizeof(*strvec->vec) * (strvec->len + 1));
-	if (new_vec == NULL)
+	/* double the size, so that adding n strings is O(n) */
+	if (strvec->len == strvec->size
+	    && __ec_strvec_resize(strvec, strvec->size == 0 ? 8 : strvec->size * 2) < 0)
 		return -1;
 
-	strvec->vec = new_vec;
-
 	elt = __ec_strvec_elt(s);
 	if (elt == NULL)
 		return -1;
 
-	new_vec[strvec->len] = elt;
+	strvec->vec[strvec->len] = elt;
 	strvec->len++;
 
 	return 0;
 }
 
+/* the strings are copied in a pool */
 struct ec_strvec *ec_strvec_from_array(const char *const *strarr, size_t n)
 {
+	struct ec_strvec_pool *pool;
 	struct ec_strvec *strvec = NULL;
-	size_t i;
+	size_t i, len, str_size = 0;
+	char *str;
+
+	for (i = 0; i < n; i++) {
+		if (strarr[i] == NULL) {
+			errno = EINVAL;
+			goto fail;
+		}
+		str_size += strlen(strarr[i]) + 1;
+	}
 
 	strvec = ec_strvec();
 	if (strvec == NULL)
 		goto fail;
+	if (n == 0)
+		return strvec;
+
+	if (ec_strvec_reserve(strvec, n) < 0)
+		goto fail;
+	pool = __ec_strvec_pool(n, str_size, &str);
+	if (pool == NULL)
+		goto fail;
 
 	for (i = 0; i < n; i++) {
-		if (ec_strvec_add(strvec, strarr[i]) < 0)
-			goto fail;
+		len = strlen(strarr[i]) + 1;
+		memcpy(str, strarr[i], len);
+		__ec_strvec_add_pooled(strvec, pool, i, str);
+		str += len;
 	}
 
 	return strvec;
@@ -162,8 +241,7 @@ struct ec_strvec *ec_strvec_ndup(const struct ec_strvec *strvec, size_t off, siz
 	if (len == 0)
 		return copy;
 
-	copy->vec = calloc(len, sizeof(*copy->vec));
-	if (copy->vec == NULL)
+	if (ec_strvec_reserve(copy, len) < 0)
 		goto fail;
 
 	for (i = 0; i < len; i++) {
@@ -179,6 +257,79 @@ fail:
 	return NULL;
 }
 
+size_t ec_strvec_ndup_size(size_t len)
+{
+	return sizeof(struct ec_strvec) + len * sizeof(struct ec_strvec_elt *);
+}
+
+struct ec_strvec *
+ec_strvec_ndup_in(void *buf, const struct ec_strvec *strvec, size_t off, size_t len)
+{
+	struct ec_strvec *copy = buf;
+	size_t i;
+
+	if (off + len > ec_strvec_len(strvec)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	copy->len = len;
+	copy->size = 0;
+	copy->vec = len == 0 ? NULL : (struct ec_strvec_elt **)(copy + 1);
+	for (i = 0; i < len; i++) {
+		copy->vec[i] = strvec->vec[i + off];
+		copy->vec[i]->refcnt++;
+	}
+
+	return copy;
+}
+
+void ec_strvec_release(struct ec_strvec *strvec)
+{
+	size_t i;
+
+	if (strvec == NULL)
+		return;
+
+	for (i = 0; i < strvec->len; i++)
+		__ec_strvec_elt_free(strvec->vec[i]);
+	strvec->len = 0;
+	strvec->size = 0;
+	strvec->vec = NULL;
+}
+
+struct ec_strvec_elt *ec_strvec_elt_get(const struct ec_strvec *strvec, size_t idx)
+{
+	struct ec_strvec_elt *elt = strvec->vec[idx];
+
+	elt->refcnt++;
+
+	return elt;
+}
+
+void ec_strvec_elt_put(struct ec_strvec_elt *elt)
+{
+	if (elt != NULL)
+		__ec_strvec_elt_free(elt);
+}
+
+const struct ec_strvec *
+ec_strvec_view(struct ec_strvec *view, const struct ec_strvec *strvec, size_t off, size_t len)
+{
+	size_t veclen = ec_strvec_len(strvec);
+
+	if (off > veclen)
+		off = veclen;
+	if (len > veclen - off)
+		len = veclen - off;
+
+	view->len = len;
+	view->size = 0;
+	view->vec = len == 0 ? NULL : strvec->vec + off;
+
+	return view;
+}
+
 struct ec_strvec *ec_strvec_dup(const struct ec_strvec *strvec)
 {
 	return ec_strvec_ndup(strvec, 0, ec_strvec_len(strvec));
@@ -214,14 +365,76 @@ const char *ec_strvec_val(const struct ec_strvec *strvec, size_t idx)
 	return strvec->vec[idx]->str;
 }
 
+/* deprecated, set the start and end attributes from the span */
+static int elt_set_span_attrs(struct ec_strvec_elt *elt)
+{
+	struct ec_dict *attrs = elt->attrs;
+
+	if (attrs == NULL) {
+		attrs = ec_dict();
+		if (attrs == NULL)
+			return -1;
+	}
+	if (ec_dict_set(attrs, EC_STRVEC_ATTR_START, (void *)(uintptr_t)elt->start, NULL) < 0
+	    || ec_dict_set(attrs, EC_STRVEC_ATTR_END, (void *)(uintptr_t)elt->end, NULL) < 0) {
+		if (attrs != elt->attrs)
+			ec_dict_free(attrs);
+		return -1;
+	}
+	elt->attrs = attrs;
+
+	return 0;
+}
+
 const struct ec_dict *ec_strvec_get_attrs(const struct ec_strvec *strvec, size_t idx)
 {
+	struct ec_strvec_elt *elt;
+
 	if (strvec == NULL || idx >= strvec->len) {
 		errno = EINVAL;
 		return NULL;
 	}
 
-	return strvec->vec[idx]->attrs;
+	/* the attributes of a token with a span are only built when asked */
+	elt = strvec->vec[idx];
+	if (elt->attrs == NULL && elt->has_span && elt_set_span_attrs(elt) < 0)
+		return NULL;
+
+	return elt->attrs;
+}
+
+/*
+ * Get an element that can be modified: if it is shared with another
+ * vector, replace it with a copy, without its attributes if copy_attrs is
+ * false.
+ */
+static struct ec_strvec_elt *
+__ec_strvec_elt_unshare(struct ec_strvec *strvec, size_t idx, bool copy_attrs)
+{
+	struct ec_strvec_elt *elt = strvec->vec[idx], *copy;
+
+	if (elt->refcnt == 1)
+		return elt;
+
+	copy = __ec_strvec_elt(elt->str);
+	if (copy == NULL)
+		return NULL;
+	copy->kind = elt->kind;
+	copy->has_span = elt->has_span;
+	copy->start = elt->start;
+	copy->end = elt->end;
+	if (copy_attrs && elt->attrs != NULL) {
+		copy->attrs = ec_dict_dup(elt->attrs);
+		if (copy->attrs == NULL) {
+			__ec_strvec_elt_free(copy);
+			return NULL;
+		}
+	}
+
+	__ec_strvec_elt_free(elt);
+	strvec->vec[idx] = copy;
+
+	return copy;
 }
 
 int ec_strvec_set_attrs(struct ec_strvec *strvec, size_t idx, struct ec_dict *attrs)
@@ -233,12 +446,9 @@ int ec_strvec_set_attrs(struct ec_strvec *strvec, size_t idx, struct ec_dict *at
 		goto fail;
 	}
 
-	elt = strvec->vec[idx];
-	if (elt->refcnt > 1) {
-		if (ec_strvec_set(strvec, idx, elt->str) < 0)
-			goto fail;
-		elt = strvec->vec[idx];
-	}
+	elt = __ec_strvec_elt_unshare(strvec, idx, false);
+	if (elt == NULL)
+		goto fail;
 
 	if (elt->attrs != NULL)
 		ec_dict_free(elt->attrs);
@@ -252,6 +462,75 @@ fail:
 	return -1;
 }
 
+int ec_strvec_get_span(const struct ec_strvec *strvec, size_t idx, size_t *start, size_t *end)
+{
+	const struct ec_strvec_elt *elt;
+
+	if (strvec == NULL || idx >= strvec->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	elt = strvec->vec[idx];
+	if (!elt->has_span) {
+		errno = ENOENT;
+		return -1;
+	}
+	if (start != NULL)
+		*start = elt->start;
+	if (end != NULL)
+		*end = elt->end;
+
+	return 0;
+}
+
+int ec_strvec_set_span(struct ec_strvec *strvec, size_t idx, size_t start, size_t end)
+{
+	struct ec_strvec_elt *elt;
+
+	if (strvec == NULL || idx >= strvec->len || start > end) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	elt = __ec_strvec_elt_unshare(strvec, idx, true);
+	if (elt == NULL)
+		return -1;
+	elt->has_span = true;
+	elt->start = start;
+	elt->end = end;
+	if (elt->attrs != NULL && ec_dict_has_key(elt->attrs, EC_STRVEC_ATTR_START)
+	    && elt_set_span_attrs(elt) < 0)
+		return -1;
+
+	return 0;
+}
+
+unsigned int ec_strvec_get_kind(const struct ec_strvec *strvec, size_t idx)
+{
+	if (strvec == NULL || idx >= strvec->len)
+		return 0;
+
+	return strvec->vec[idx]->kind;
+}
+
+int ec_strvec_set_kind(struct ec_strvec *strvec, size_t idx, unsigned int kind)
+{
+	struct ec_strvec_elt *elt;
+
+	if (strvec == NULL || idx >= strvec->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	elt = __ec_strvec_elt_unshare(strvec, idx, true);
+	if (elt == NULL)
+		return -1;
+	elt->kind = kind;
+
+	return 0;
+}
+
 int ec_strvec_cmp(const struct ec_strvec *strvec1, const struct ec_strvec *strvec2)
 {
 	size_t i;
@@ -286,6 +565,32 @@ typedef enum {
 	IN_COMMENT,
 } lexer_state_t;
 
+/* a token: its span in the line, and its unquoted value in the buffer */
+struct sh_lex_token {
+	size_t start;
+	size_t end;
+	size_t off;
+};
+
+struct ec_strvec_sh_lexer {
+	char *line; /* the input read so far */
+	size_t line_len;
+	size_t line_size;
+	char *buf; /* the unquoted tokens, each one followed by a nul */
+	size_t buf_len;
+	size_t buf_size;
+	struct sh_lex_token *tokens; /* the complete tokens */
+	size_t n_tokens;
+	size_t tokens_size;
+	lexer_state_t state;
+	char quote;
+	/* Weird, but we need an empty string to report as having trailing
+	 * space when EC_STRVEC_TRAILSP is set in flags. */
+	bool trailing_space;
+	size_t arg_start; /* start of the current token in the line */
+	size_t tok_off; /* start of the current token in the buffer */
+};
+
 static char_class_t get_char_class(char c)
 {
 	switch (c) {
@@ -304,160 +609,263 @@ static char_class_t get_char_class(char c)
 	return OTHER;
 }
 
-static int sh_lex_set_attrs(struct ec_strvec *strvec, size_t idx, size_t arg_start, size_t arg_end)
+/*
+ * Grow a table to hold at least len > 0 elements, by doubling its size.
+ * Return the table, or NULL on error (the table is not freed).
+ */
+static void *sh_lex_grow(void *table, size_t *size, size_t len, size_t elt_size)
 {
-	struct ec_dict *attrs = ec_dict();
-	if (attrs == NULL)
-		return -1;
+	size_t new_size;
 
-	if (ec_dict_set(attrs, EC_STRVEC_ATTR_START, (void *)(uintptr_t)arg_start, NULL) < 0)
-		goto fail;
-	if (ec_dict_set(attrs, EC_STRVEC_ATTR_END, (void *)(uintptr_t)arg_end, NULL) < 0)
-		goto fail;
+	if (len <= *size)
+		return table;
 
-	return ec_strvec_set_attrs(strvec, idx, attrs);
-fail:
-	ec_dict_free(attrs);
-	return -1;
+	new_size = *size == 0 ? 16 : *size;
+	while (new_size < len)
+		new_size *= 2;
+	table = realloc(table, new_size * elt_size);
+	if (table == NULL)
+		return NULL;
+	*size = new_size;
+
+	return table;
 }
 
-struct ec_strvec *ec_strvec_sh_lex_str(const char *str, ec_strvec_flag_t flags, char *missing_quote)
+static void sh_lex_reset(struct ec_strvec_sh_lexer *lexer)
 {
-	struct ec_strvec *strvec = NULL;
-	lexer_state_t state = START;
-	/* Weird, but we need an empty string to report as having trailing
-	 * space when EC_STRVEC_SHLEX_KEEP_TRAILING_SPACE is set in flags. */
-	bool trailing_space = true;
-	size_t t, i, arg_start;
-	char token[BUFSIZ];
-	char c, quote;
-
-#define append(buffer, position, character)                                                        \
-	do {                                                                                       \
-		buffer[position++] = character;                                                    \
-		if (position >= sizeof(buffer)) {                                                  \
-			errno = ENOBUFS;                                                           \
-			goto fail;                                                                 \
-		}                                                                                  \
-	} while (0)
+	lexer->line_len = 0;
+	lexer->buf_len = 0;
+	lexer->n_tokens = 0;
+	lexer->state = START;
+	lexer->quote = '\0';
+	lexer->trailing_space = true;
+	lexer->arg_start = 0;
+	lexer->tok_off = 0;
+}
 
-	if (str == NULL) {
-		errno = EINVAL;
-		goto fail;
-	}
+struct ec_strvec_sh_lexer *ec_strvec_sh_lexer(void)
+{
+	struct ec_strvec_sh_lexer *lexer;
 
-	strvec = ec_strvec();
-	if (strvec == NULL)
-		goto fail;
+	lexer = calloc(1, sizeof(*lexer));
+	if (lexer == NULL)
+		return NULL;
+	sh_lex_reset(lexer);
+
+	return lexer;
+}
 
-	t = 0;
-	quote = '\0';
-	arg_start = 0;
+void ec_strvec_sh_lexer_free(struct ec_strvec_sh_lexer *lexer)
+{
+	if (lexer == NULL)
+		return;
 
-	for (i = 0; i < strlen(str); i++) {
-		c = str[i];
+	free(lexer->line);
+	free(lexer->buf);
+	free(lexer->tokens);
+	free(lexer);
+}
 
-		char_class_t cls = get_char_class(c);
+/*
+ * Append a character to the buffer. The nul ending the current token is
+ * not stored: it is added to the copy of the buffer made by
+ * sh_lex_build().
+ */
+static int sh_lex_append(struct ec_strvec_sh_lexer *lexer, char c)
+{
+	char *buf;
+
+	buf = sh_lex_grow(lexer->buf, &lexer->buf_size, lexer->buf_len + 1, 1);
+	if (buf == NULL)
+		return -1;
+	lexer->buf = buf;
+	lexer->buf[lexer->buf_len++] = c;
 
-		switch (state) {
+	return 0;
+}
+
+static int sh_lex_end_token(struct ec_strvec_sh_lexer *lexer, size_t end)
+{
+	struct sh_lex_token *tokens, *token;
+
+	tokens = sh_lex_grow(
+		lexer->tokens, &lexer->tokens_size, lexer->n_tokens + 1, sizeof(*tokens)
+	);
+	if (tokens == NULL)
+		return -1;
+	lexer->tokens = tokens;
+	if (sh_lex_append(lexer, '\0') < 0)
+		return -1;
+
+	token = &lexer->tokens[lexer->n_tokens++];
+	token->start = lexer->arg_start;
+	token->end = end;
+	token->off = lexer->tok_off;
+	lexer->tok_off = lexer->buf_len;
+
+	return 0;
+}
+
+/* read the characters of the line after the ones already read */
+static int sh_lex_scan(struct ec_strvec_sh_lexer *lexer, const char *str, size_t len)
+{
+	char_class_t cls;
+	char *line;
+	size_t i;
+	char c;
+
+	if (len == lexer->line_len)
+		return 0;
+
+	for (i = lexer->line_len; i < len; i++) {
+		c = str[i];
+		cls = get_char_class(c);
+
+		switch (lexer->state) {
 		case START:
 			switch (cls) {
 			case SPACE:
 				break;
 			case POUND:
-				state = IN_COMMENT;
+				lexer->state = IN_COMMENT;
 				break;
 			case DOUBLE_QUOTE:
-				state = IN_DOUBLE_QUOTES;
-				quote = c;
+				lexer->state = IN_DOUBLE_QUOTES;
+				lexer->quote = c;
 				break;
 			case SINGLE_QUOTE:
-				state = IN_SINGLE_QUOTES;
-				quote = c;
+				lexer->state = IN_SINGLE_QUOTES;
+				lexer->quote = c;
 				break;
 			case BACKSLASH:
-				state = ESCAPING;
+				lexer->state = ESCAPING;
 				break;
 			default:
 				/* start a new token */
-				state = IN_WORD;
-				append(token, t, c);
+				lexer->state = IN_WORD;
+				if (sh_lex_append(lexer, c) < 0)
+					return -1;
 				break;
 			}
-			trailing_space = cls == SPACE;
-			arg_start = i;
+			lexer->trailing_space = cls == SPACE;
+			lexer->arg_start = i;
 			break;
 		case IN_WORD:
 			switch (cls) {
 			case SPACE:
 				/* end of token */
-				quote = '\0';
-				token[t] = '\0';
-				if (ec_strvec_add(strvec, token) < 0)
-					goto fail;
-				if (sh_lex_set_attrs(
-					    strvec, ec_strvec_len(strvec) - 1, arg_start, i
-				    )
-				    < 0)
-					goto fail;
-				state = START;
-				trailing_space = true;
-				arg_start = i;
-				t = 0;
+				if (sh_lex_end_token(lexer, i) < 0)
+					return -1;
+				lexer->quote = '\0';
+				lexer->state = START;
+				lexer->trailing_space = true;
+				lexer->arg_start = i;
 				break;
 			case DOUBLE_QUOTE:
-				state = IN_DOUBLE_QUOTES;
+				lexer->state = IN_DOUBLE_QUOTES;
+				lexer->quote = c;
 				break;
 			case SINGLE_QUOTE:
-				state = IN_SINGLE_QUOTES;
+				lexer->state = IN_SINGLE_QUOTES;
+				lexer->quote = c;
 				break;
 			case BACKSLASH:
-				state = ESCAPING;
+				lexer->state = ESCAPING;
 				break;
 			default:
-				append(token, t, c);
+				if (sh_lex_append(lexer, c) < 0)
+					return -1;
 				break;
 			}
 			break;
 		case ESCAPING:
-			state = IN_WORD;
-			append(token, t, c);
+			lexer->state = IN_WORD;
+			if (sh_lex_append(lexer, c) < 0)
+				return -1;
 			break;
 		case ESCAPING_QUOTED:
-			state = IN_DOUBLE_QUOTES;
-			append(token, t, c);
+			lexer->state = IN_DOUBLE_QUOTES;
+			if (sh_lex_append(lexer, c) < 0)
+				return -1;
 			break;
 		case IN_DOUBLE_QUOTES:
 			switch (cls) {
 			case DOUBLE_QUOTE:
-				state = IN_WORD;
+				lexer->state = IN_WORD;
 				break;
 			case BACKSLASH:
-				state = ESCAPING_QUOTED;
+				lexer->state = ESCAPING_QUOTED;
 				break;
 			default:
-				append(token, t, c);
+				if (sh_lex_append(lexer, c) < 0)
+					return -1;
 				break;
 			}
 			break;
 		case IN_SINGLE_QUOTES:
 			switch (cls) {
 			case SINGLE_QUOTE:
-				state = IN_WORD;
+				lexer->state = IN_WORD;
 				break;
 			default:
-				append(token, t, c);
+				if (sh_lex_append(lexer, c) < 0)
+					return -1;
 				break;
 			}
 			break;
 		case IN_COMMENT:
 			if (c == '\n' || c == '\r')
-				state = START;
+				lexer->state = START;
 			break;
 		}
 	}
 
-#undef append
+	/* keep a copy of the line, to check that the next one extends it */
+	line = sh_lex_grow(lexer->line, &lexer->line_size, len, 1);
+	if (line == NULL)
+		return -1;
+	lexer->line = line;
+	memcpy(&lexer->line[lexer->line_len], &str[lexer->line_len], len - lexer->line_len);
+	lexer->line_len = len;
+
+	return 0;
+}
+
+static void sh_lex_add(
+	struct ec_strvec *strvec,
+	struct ec_strvec_pool *pool,
+	char *str,
+	size_t start,
+	size_t end
+)
+{
+	struct ec_strvec_elt *elt;
+
+	elt = __ec_strvec_add_pooled(strvec, pool, strvec->len, str);
+	elt->has_span = true;
+	elt->start = start;
+	elt->end = end;
+}
+
+/*
+ * Build the string vector from the tokens read so far, as if the line
+ * ended here. The state of the lexer is not modified, so that it can
+ * read more characters.
+ *
+ * The elements are allocated in one pool, with a copy of the buffer: the
+ * nul ending the current token and the empty string of a trailing space
+ * are added after it.
+ */
+static struct ec_strvec *
+sh_lex_build(const struct ec_strvec_sh_lexer *lexer, ec_strvec_flag_t flags, char *missing_quote)
+{
+	const struct sh_lex_token *token;
+	struct ec_strvec_pool *pool;
+	struct ec_strvec *strvec = NULL;
+	lexer_state_t state = lexer->state;
+	size_t i, n = lexer->n_tokens + 1;
+	char *str;
+
 	switch (state) {
 	case START:
 		/* fallthrough */
@@ -466,28 +874,47 @@ struct ec_strvec *ec_strvec_sh_lex_str(const char *str, ec_strvec_flag_t flags,
 	case IN_COMMENT:
 		break;
 	default:
-		if (missing_quote != NULL) {
-			*missing_quote = quote;
-		}
+		if (missing_quote != NULL)
+			*missing_quote = lexer->quote;
 		if (flags & EC_STRVEC_STRICT) {
 			errno = EBADMSG;
 			goto fail;
 		}
 		state = IN_WORD;
 	}
-	if (state == IN_WORD && t > 0) {
-		token[t] = '\0';
-		if (ec_strvec_add(strvec, token) < 0)
-			goto fail;
-		if (sh_lex_set_attrs(strvec, ec_strvec_len(strvec) - 1, arg_start, i) < 0)
-			goto fail;
-	} else if (trailing_space && (flags & EC_STRVEC_TRAILSP)) {
-		if (ec_strvec_add(strvec, "") < 0)
-			goto fail;
-		if (sh_lex_set_attrs(strvec, ec_strvec_len(strvec) - 1, arg_start + 1, i + 1) < 0)
-			goto fail;
+
+	strvec = ec_strvec();
+	if (strvec == NULL)
+		goto fail;
+	if (ec_strvec_reserve(strvec, n) < 0)
+		goto fail;
+	pool = __ec_strvec_pool(n, lexer->buf_len + 2, &str);
+	if (pool == NULL)
+		goto fail;
+	if (lexer->buf_len > 0)
+		memcpy(str, lexer->buf, lexer->buf_len);
+	str[lexer->buf_len] = '\0';
+	str[lexer->buf_len + 1] = '\0';
+
+	for (i = 0; i < lexer->n_tokens; i++) {
+		token = &lexer->tokens[i];
+		sh_lex_add(strvec, pool, &str[token->off], token->start, token->end);
 	}
 
+	if (state == IN_WORD && lexer->buf_len > lexer->tok_off)
+		sh_lex_add(strvec, pool, &str[lexer->tok_off], lexer->arg_start, lexer->line_len);
+	else if (lexer->trailing_space && (flags & EC_STRVEC_TRAILSP))
+		sh_lex_add(
+			strvec,
+			pool,
+			&str[lexer->buf_len + 1],
+			lexer->arg_start + 1,
+			lexer->line_len + 1
+		);
+
+	if (pool->refcnt == 0)
+		free(pool);
+
 	return strvec;
 
 fail:
@@ -495,6 +922,52 @@ fail:
 	return NULL;
 }
 
+struct ec_strvec *ec_strvec_sh_lex_resume(
+	struct ec_strvec_sh_lexer *lexer,
+	const char *str,
+	ec_strvec_flag_t flags,
+	char *unclosed_quote
+)
+{
+	size_t len;
+
+	if (lexer == NULL || str == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	len = strlen(str);
+	if (len < lexer->line_len
+	    || (lexer->line_len > 0 && memcmp(lexer->line, str, lexer->line_len)))
+		sh_lex_reset(lexer);
+
+	if (sh_lex_scan(lexer, str, len) < 0) {
+		sh_lex_reset(lexer);
+		return NULL;
+	}
+
+	return sh_lex_build(lexer, flags, unclosed_quote);
+}
+
+struct ec_strvec *ec_strvec_sh_lex_str(const char *str, ec_strvec_flag_t flags, char *missing_quote)
+{
+	struct ec_strvec_sh_lexer *lexer;
+	struct ec_strvec *strvec;
+
+	if (str == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	lexer = ec_strvec_sh_lexer();
+	if (lexer == NULL)
+		return NULL;
+	strvec = ec_strvec_sh_lex_resume(lexer, str, flags, missing_quote);
+	ec_strvec_sh_lexer_free(lexer);
+
+	return strvec;
+}
+
 static int cmp_vec_elt(const void *p1, const void *p2, void *arg)
 {
 	int (*str_cmp)(const char *s1, const char *s2) = arg;
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ecoli/strvec.h>
+
+struct ec_strvec_elt {
+	unsigned int refcnt;
+	unsigned int kind; /* see ec_strvec_set_kind() */
+	bool has_span;
+	size_t start; /* see ec_strvec_set_span() */
+	size_t end;
+	char *str; /* follows the element, or stored in its pool */
+	struct ec_strvec_pool *pool; /* NULL if allocated alone */
+	struct ec_dict *attrs;
+};
+
+/*
+ * Several elements allocated in one block with their strings, which is
+ * freed with the last of them.
+ */
+struct ec_strvec_pool {
+	unsigned int refcnt; /* the number of elements still referenced */
+	struct ec_strvec_elt elts[]; /* followed by the strings */
+};
+
+struct ec_strvec {
+	size_t len;
+	size_t size; /* the allocated length of vec, 0 if not owned */
+	struct ec_strvec_elt **vec;
+};
+
+/*
+ * Initialize a view on a window of a string vector, without allocating
+ * memory nor taking a reference on the elements.
+ *
+ * The view can be passed to any function taking a const string vector,
+ * but it must not be modified nor freed, and it must not be used after
+ * the underlying vector is modified or freed. If a reference must be
+ * kept, use ec_strvec_dup() on the view.
+ *
+ * The window is truncated to the length of the string vector. Returns
+ * the view.
+ */
+const struct ec_strvec *
+ec_strvec_view(struct ec_strvec *view, const struct ec_strvec *strvec, size_t off, size_t len);
+
+/* Size of the memory needed by ec_strvec_ndup_in() to copy len elements. */
+size_t ec_strvec_ndup_size(size_t len);
+
+/*
+ * Same as ec_strvec_ndup(), but the new string vector is stored in
+ * memory provided by the caller, of at least ec_strvec_ndup_size(len)
+ * bytes. It must not be freed with ec_strvec_free(), but released with
+ * ec_strvec_release(). Returns NULL if the window is out of bounds.
+ */
+struct ec_strvec *
+ec_strvec_ndup_in(void *buf, const struct ec_strvec *strvec, size_t off, size_t len);
+
+/* Drop the references on the elements, without freeing the string vector. */
+void ec_strvec_release(struct ec_strvec *strvec);
+
+/*
+ * Take a reference on an element of a string vector, so that its string
+ * is not freed with the vector. Returns the element.
+ */
+struct ec_strvec_elt *ec_strvec_elt_get(const struct ec_strvec *strvec, size_t idx);
+
+/* Drop a reference taken with ec_strvec_elt_get(). Nothing is done if NULL. */
+void ec_strvec_elt_put(struct ec_strvec_elt *elt);
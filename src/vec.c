@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -56,28 +57,113 @@ ec_vec(size_t elt_size, size_t size, ec_vec_elt_copy_t elt_copy, ec_vec_elt_free
 		free(vec);
 		return NULL;
 	}
+	vec->size = size;
 
 	return vec;
 }
 
-int ec_vec_add_by_ref(struct ec_vec *vec, void *ptr)
+/* Resize the table to hold size >= len elements. */
+static int vec_resize(struct ec_vec *vec, size_t size)
 {
 	void *new_vec;
 
-	if (vec->len + 1 > vec->size) {
-		new_vec = realloc(vec->vec, vec->elt_size * (vec->len + 1));
-		if (new_vec == NULL)
-			return -1;
-		vec->size = vec->len + 1;
-		vec->vec = new_vec;
+	if (size == 0) {
+		free(vec->vec);
+		vec->vec = NULL;
+		vec->size = 0;
+		return 0;
+	}
+
+	if (vec->elt_size > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	new_vec = realloc(vec->vec, vec->elt_size * size);
+	if (new_vec == NULL)
+		return -1;
+	vec->vec = new_vec;
+	vec->size = size;
+
+	return 0;
+}
+
+/* Make room for len elements, doubling the size so that appends are O(1). */
+static int vec_grow(struct ec_vec *vec, size_t len)
+{
+	size_t size;
+
+	if (len <= vec->size)
+		return 0;
+
+	size = vec->size == 0 ? 8 : vec->size;
+	while (size < len) {
+		if (size > SIZE_MAX / 2) {
+			size = len;
+			break;
+		}
+		size *= 2;
+	}
+
+	return vec_resize(vec, size);
+}
+
+int ec_vec_reserve(struct ec_vec *vec, size_t size)
+{
+	if (vec == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (size <= vec->size)
+		return 0;
+
+	return vec_resize(vec, size);
+}
+
+int ec_vec_shrink(struct ec_vec *vec)
+{
+	if (vec == NULL) {
+		errno = EINVAL;
+		return -1;
 	}
 
+	if (vec->len == vec->size)
+		return 0;
+
+	return vec_resize(vec, vec->len);
+}
+
+int ec_vec_add_by_ref(struct ec_vec *vec, void *ptr)
+{
+	if (vec_grow(vec, vec->len + 1) < 0)
+		return -1;
+
 	memcpy(get_obj(vec, vec->len), ptr, vec->elt_size);
 	vec->len++;
 
 	return 0;
 }
 
+int ec_vec_add_array(struct ec_vec *vec, const void *array, size_t n)
+{
+	if (vec == NULL || (array == NULL && n != 0) || n > SIZE_MAX - vec->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (n == 0)
+		return 0;
+
+	if (vec_grow(vec, vec->len + n) < 0)
+		return -1;
+
+	memcpy(get_obj(vec, vec->len), array, n * vec->elt_size);
+	vec->len += n;
+
+	return 0;
+}
+
 int ec_vec_add_ptr(struct ec_vec *vec, void *elt)
 {
 	EC_CHECK_ARG(vec->elt_size == sizeof(elt), -1, EINVAL);
@@ -184,3 +270,19 @@ int ec_vec_get(void *ptr, const struct ec_vec *vec, size_t idx)
 
 	return 0;
 }
+
+void *ec_vec_at(const struct ec_vec *vec, size_t idx)
+{
+	if (vec == NULL || idx >= vec->len)
+		return NULL;
+
+	return get_obj(vec, idx);
+}
+
+void *ec_vec_data(const struct ec_vec *vec)
+{
+	if (vec == NULL || vec->len == 0)
+		return NULL;
+
+	return vec->vec;
+}
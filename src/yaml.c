@@ -17,15 +17,10 @@
 #include <ecoli/string.h>
 #include <ecoli/yaml.h>
 
-/* associate a yaml node to a ecoli node */
-struct pair {
-	const yaml_node_t *ynode;
-	struct ec_node *enode;
-};
-
 /* store the associations yaml_node <-> ec_node */
 struct enode_table {
-	struct pair *pair;
+	const yaml_node_t *ynodes; /* the nodes of the document */
+	struct ec_node **enodes; /* indexed like ynodes, NULL if not parsed */
 	size_t len;
 };
 
@@ -118,17 +113,14 @@ static int parse_bool(const char *str, bool *val)
 
 static int add_in_table(struct enode_table *table, const yaml_node_t *ynode, struct ec_node *enode)
 {
-	struct pair *pair = NULL;
+	size_t idx = ynode - table->ynodes;
 
-	pair = realloc(table->pair, (table->len + 1) * sizeof(*pair));
-	if (pair == NULL)
+	if (idx >= table->len || table->enodes[idx] != NULL) {
+		errno = EINVAL;
 		return -1;
+	}
 
-	ec_node_clone(enode);
-	pair[table->len].ynode = ynode;
-	pair[table->len].enode = enode;
-	table->pair = pair;
-	table->len++;
+	table->enodes[idx] = ec_node_clone(enode);
 
 	return 0;
 }
@@ -138,8 +130,8 @@ static void free_table(struct enode_table *table)
 	size_t i;
 
 	for (i = 0; i < table->len; i++)
-		ec_node_free(table->pair[i].enode);
-	free(table->pair);
+		ec_node_free(table->enodes[i]);
+	free(table->enodes);
 }
 
 static struct ec_config *parse_ec_config(
@@ -380,10 +372,9 @@ parse_ec_node(struct enode_table *table, const yaml_document_t *document, const
 	}
 
 	/* if it's an anchor, the node may be already parsed, reuse it */
-	for (i = 0; i < table->len; i++) {
-		if (table->pair[i].ynode == ynode)
-			return ec_node_clone(table->pair[i].enode);
-	}
+	i = ynode - table->ynodes;
+	if (i < table->len && table->enodes[i] != NULL)
+		return ec_node_clone(table->enodes[i]);
 
 	for (pair = ynode->data.mapping.pairs.start; pair < ynode->data.mapping.pairs.top; pair++) {
 		key = document->nodes.start + pair->key - 1; /* XXX -1 ? */
@@ -516,6 +507,12 @@ static struct ec_node *parse_document(struct enode_table *table, const yaml_docu
 {
 	yaml_node_t *node;
 
+	table->ynodes = document->nodes.start;
+	table->len = document->nodes.top - document->nodes.start;
+	table->enodes = calloc(table->len, sizeof(*table->enodes));
+	if (table->enodes == NULL)
+		return NULL;
+
 	node = document->nodes.start;
 	return parse_ec_node(table, document, node);
 }
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+EC_TEST_MAIN()
+{
+	const char *a1, *a2, *a3;
+	char *str = NULL;
+	int testres = 0;
+
+	errno = 0;
+	testres |= EC_TEST_CHECK(
+		ec_atom_lookup("atom_test") == NULL && errno == ENOENT, "atom should not exist"
+	);
+
+	a1 = ec_atom_get("atom_test");
+	testres |= EC_TEST_CHECK(a1 != NULL && !strcmp(a1, "atom_test"), "cannot get atom");
+
+	/* same string at another address, same atom */
+	str = strdup("atom_test");
+	if (str == NULL)
+		goto fail;
+	a2 = ec_atom_get(str);
+	testres |= EC_TEST_CHECK(a2 == a1, "atoms should be equal");
+	testres |= EC_TEST_CHECK(ec_atom_lookup(str) == a1, "lookup should return the atom");
+	free(str);
+	str = NULL;
+
+	a3 = ec_atom_get("atom_test2");
+	testres |= EC_TEST_CHECK(a3 != NULL && a3 != a1, "atoms should differ");
+	ec_atom_put(a3);
+	testres |= EC_TEST_CHECK(ec_atom_lookup("atom_test2") == NULL, "atom should be freed");
+
+	/* the atom is freed with its last reference */
+	ec_atom_put(a2);
+	testres |= EC_TEST_CHECK(ec_atom_lookup("atom_test") == a1, "atom should still exist");
+	ec_atom_put(a1);
+	testres |= EC_TEST_CHECK(ec_atom_lookup("atom_test") == NULL, "atom should be freed");
+
+	errno = 0;
+	testres |= EC_TEST_CHECK(
+		ec_atom_get(NULL) == NULL && errno == EINVAL, "NULL string should be rejected"
+	);
+	ec_atom_put(NULL);
+
+	return testres;
+
+fail:
+	free(str);
+	return -1;
+}
@@ -0,0 +1,513 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grammar.h"
+
+#define N_IFNAMES 8
+
+struct gen {
+	const struct ec_test_grammar_params *params;
+	uint64_t state; /* state of the pseudo-random generator */
+	unsigned int count; /* suffix of the next token, unique in a command */
+	struct ec_node *fan; /* innermost fan, target of the loops */
+};
+
+static const char *const words[] = {
+	"address", "area", "bridge", "clear", "counters", "detail", "disable",
+	"enable", "filter", "group", "interface", "metric", "mtu", "neighbor",
+	"nexthop", "peer", "policy", "port", "prefix", "queue", "rate",
+	"route", "set", "show", "timer", "tunnel", "vlan", "brief",
+};
+
+/* splitmix64, any seed is valid */
+static uint64_t gen_rand(struct gen *gen)
+{
+	uint64_t z = (gen->state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+static unsigned int gen_range(struct gen *gen, unsigned int n)
+{
+	return gen_rand(gen) % n;
+}
+
+/* Shuffle an array of indexes 0 to n - 1. */
+static void gen_shuffle(struct gen *gen, unsigned int *order, unsigned int n)
+{
+	unsigned int i, j, tmp;
+
+	for (i = 0; i < n; i++)
+		order[i] = i;
+	for (i = n; i > 1; i--) {
+		j = gen_range(gen, i);
+		tmp = order[i - 1];
+		order[i - 1] = order[j];
+		order[j] = tmp;
+	}
+}
+
+/* Get a new keyword, unique in the current command. */
+static const char *gen_keyword(struct gen *gen, char *buf, size_t len)
+{
+	snprintf(buf, len, "%s%u", words[gen_range(gen, EC_COUNT_OF(words))], gen->count++);
+	return buf;
+}
+
+static int sample_add(struct ec_strvec *sample, const char *str)
+{
+	if (sample == NULL)
+		return 0;
+	return ec_strvec_add(sample, str);
+}
+
+static int sample_cat(struct ec_strvec *sample, const struct ec_strvec *items)
+{
+	size_t i;
+
+	if (sample == NULL || items == NULL)
+		return 0;
+	for (i = 0; i < ec_strvec_len(items); i++) {
+		if (ec_strvec_add(sample, ec_strvec_val(items, i)) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static struct ec_strvec *get_ifnames(struct ec_pnode *pstate, void *opaque)
+{
+	(void)pstate;
+	(void)opaque;
+
+	return EC_STRVEC("eth0", "eth1", "eth2", "eth3", "eth4", "eth5", "eth6", "eth7");
+}
+
+/* A value: an integer, an IPv4 address or an interface name. */
+static struct ec_node *gen_leaf(struct gen *gen, char *id, size_t len, struct ec_strvec *sample)
+{
+	unsigned int kinds = gen->params->flags & EC_TEST_GRAMMAR_DYNLIST ? 3 : 2;
+	struct ec_node *leaf;
+	char val[32];
+
+	switch (gen_range(gen, kinds)) {
+	case 0:
+		snprintf(id, len, "int%u", gen->count++);
+		leaf = ec_node_int(id, 0, 4095, 10);
+		snprintf(val, sizeof(val), "%u", gen_range(gen, 4096));
+		break;
+	case 1:
+		snprintf(id, len, "addr%u", gen->count++);
+		leaf = ec_node_re(id, "[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+");
+		snprintf(
+			val,
+			sizeof(val),
+			"10.%u.%u.%u",
+			gen_range(gen, 256),
+			gen_range(gen, 256),
+			gen_range(gen, 256)
+		);
+		break;
+	default:
+		snprintf(id, len, "ifname%u", gen->count++);
+		leaf = ec_node_dynlist(id, get_ifnames, NULL, "eth[0-9]+", DYNLIST_MATCH_LIST);
+		snprintf(val, sizeof(val), "eth%u", gen_range(gen, N_IFNAMES));
+		break;
+	}
+
+	if (leaf == NULL)
+		return NULL;
+	if (sample_add(sample, val) < 0) {
+		ec_node_free(leaf);
+		return NULL;
+	}
+
+	return leaf;
+}
+
+/* A keyword followed by a value. */
+static struct ec_node *gen_pair(struct gen *gen, struct ec_strvec *sample)
+{
+	char kw[32], id[32];
+	struct ec_node *leaf;
+
+	gen_keyword(gen, kw, sizeof(kw));
+	if (sample_add(sample, kw) < 0)
+		return NULL;
+	leaf = gen_leaf(gen, id, sizeof(id), sample);
+
+	return EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, kw), leaf);
+}
+
+static struct ec_node *gen_body(struct gen *gen, unsigned int depth, struct ec_strvec *sample);
+
+/* A chain of keywords, some of them being optional, followed by a body. */
+static struct ec_node *gen_chain(struct gen *gen, unsigned int depth, struct ec_strvec *sample)
+{
+	struct ec_node *seq, *child;
+	unsigned int i, n;
+	bool optional;
+	char kw[32];
+
+	seq = EC_NODE_SEQ(EC_NO_ID);
+	if (seq == NULL)
+		return NULL;
+
+	n = 1 + gen_range(gen, gen->params->width);
+	for (i = 0; i < n; i++) {
+		gen_keyword(gen, kw, sizeof(kw));
+		child = ec_node_str(EC_NO_ID, kw);
+		optional = gen_range(gen, 4) == 0;
+		if (optional)
+			child = ec_node_option(EC_NO_ID, child);
+		if (ec_node_seq_add(seq, child) < 0)
+			goto fail;
+		if ((!optional || gen_range(gen, 2) == 0) && sample_add(sample, kw) < 0)
+			goto fail;
+	}
+
+	if (ec_node_seq_add(seq, gen_body(gen, depth - 1, sample)) < 0)
+		goto fail;
+
+	return seq;
+
+fail:
+	ec_node_free(seq);
+	return NULL;
+}
+
+/*
+ * A fan of alternatives, each starting with a keyword. With loops, an
+ * additional alternative refers to the enclosing fan.
+ */
+static struct ec_node *gen_fan(struct gen *gen, unsigned int depth, struct ec_strvec *sample)
+{
+	struct ec_node *fan, *outer = gen->fan, *child;
+	unsigned int i, n, chosen;
+	char kw[32];
+
+	fan = EC_NODE_OR(EC_NO_ID);
+	if (fan == NULL)
+		return NULL;
+	gen->fan = fan;
+
+	n = 1 + gen_range(gen, gen->params->width);
+	chosen = gen_range(gen, n);
+	for (i = 0; i < n; i++) {
+		gen_keyword(gen, kw, sizeof(kw));
+		if (i == chosen && sample_add(sample, kw) < 0)
+			goto fail;
+		child = EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, kw),
+			gen_body(gen, depth - 1, i == chosen ? sample : NULL)
+		);
+		if (ec_node_or_add(fan, child) < 0)
+			goto fail;
+	}
+
+	if (gen->params->flags & EC_TEST_GRAMMAR_LOOP) {
+		gen_keyword(gen, kw, sizeof(kw));
+		child = EC_NODE_SEQ(
+			EC_NO_ID, ec_node_str(EC_NO_ID, kw), ec_node_clone(outer ? outer : fan)
+		);
+		if (ec_node_or_add(fan, child) < 0)
+			goto fail;
+	}
+
+	gen->fan = outer;
+	return fan;
+
+fail:
+	gen->fan = outer;
+	ec_node_free(fan);
+	return NULL;
+}
+
+/* A bag of keyword/value options, that can be given in any order. */
+static struct ec_node *gen_bag(struct gen *gen, struct ec_strvec *sample)
+{
+	struct ec_strvec **items = NULL;
+	unsigned int *order = NULL;
+	unsigned int i, n, first;
+	struct ec_node *bag;
+
+	bag = EC_NODE_SUBSET(EC_NO_ID);
+	if (bag == NULL)
+		return NULL;
+
+	n = 1 + gen_range(gen, gen->params->width);
+	items = calloc(n, sizeof(*items));
+	order = calloc(n, sizeof(*order));
+	if (items == NULL || order == NULL)
+		goto fail;
+
+	/* a subset matches at least one element */
+	first = gen_range(gen, n);
+	for (i = 0; i < n; i++) {
+		/* always draw, so that the grammar does not depend on the sample */
+		if ((gen_range(gen, 2) == 0 || i == first) && sample != NULL) {
+			items[i] = ec_strvec();
+			if (items[i] == NULL)
+				goto fail;
+		}
+		if (ec_node_subset_add(bag, gen_pair(gen, items[i])) < 0)
+			goto fail;
+	}
+
+	gen_shuffle(gen, order, n);
+	for (i = 0; i < n; i++) {
+		if (sample_cat(sample, items[order[i]]) < 0)
+			goto fail;
+	}
+
+	for (i = 0; i < n; i++)
+		ec_strvec_free(items[i]);
+	free(items);
+	free(order);
+
+	return bag;
+
+fail:
+	if (items != NULL) {
+		for (i = 0; i < n; i++)
+			ec_strvec_free(items[i]);
+	}
+	free(items);
+	free(order);
+	ec_node_free(bag);
+	return NULL;
+}
+
+/*
+ * A command string, with the same constructs as above:
+ *   kw (alt1|alt2|...) [opt] (opt1, opt2, ...) kw value
+ */
+static struct ec_node *gen_cmd(struct gen *gen, struct ec_strvec *sample)
+{
+	struct ec_strvec *items = NULL;
+	unsigned int *order = NULL;
+	struct ec_node *leaf = NULL, *cmd;
+	unsigned int i, n, chosen;
+	char kw[32], id[32];
+	char *str = NULL;
+	size_t size = 0;
+	FILE *f;
+
+	f = open_memstream(&str, &size);
+	if (f == NULL)
+		return NULL;
+
+	fprintf(f, "%s", gen_keyword(gen, kw, sizeof(kw)));
+	if (sample_add(sample, kw) < 0)
+		goto fail;
+
+	n = 1 + gen_range(gen, gen->params->width);
+	chosen = gen_range(gen, n);
+	fprintf(f, n > 1 ? " (" : " ");
+	for (i = 0; i < n; i++) {
+		fprintf(f, "%s%s", i > 0 ? "|" : "", gen_keyword(gen, kw, sizeof(kw)));
+		if (i == chosen && sample_add(sample, kw) < 0)
+			goto fail;
+	}
+	fprintf(f, n > 1 ? ")" : "");
+
+	fprintf(f, " [%s]", gen_keyword(gen, kw, sizeof(kw)));
+	if (gen_range(gen, 2) == 0 && sample_add(sample, kw) < 0)
+		goto fail;
+
+	n = gen_range(gen, gen->params->width + 1);
+	if (n > 1) {
+		items = ec_strvec();
+		order = calloc(n, sizeof(*order));
+		if (items == NULL || order == NULL)
+			goto fail;
+		fprintf(f, " (");
+		for (i = 0; i < n; i++) {
+			fprintf(f, "%s%s", i > 0 ? ", " : "", gen_keyword(gen, kw, sizeof(kw)));
+			if (ec_strvec_add(items, kw) < 0)
+				goto fail;
+		}
+		fprintf(f, ")");
+		gen_shuffle(gen, order, n);
+		for (i = 0; i < n; i++) {
+			if (gen_range(gen, 2) == 0 && i > 0)
+				continue;
+			if (sample_add(sample, ec_strvec_val(items, order[i])) < 0)
+				goto fail;
+		}
+	}
+
+	fprintf(f, " %s", gen_keyword(gen, kw, sizeof(kw)));
+	if (sample_add(sample, kw) < 0)
+		goto fail;
+	leaf = gen_leaf(gen, id, sizeof(id), sample);
+	if (leaf == NULL)
+		goto fail;
+	fprintf(f, " %s", id);
+
+	if (fclose(f) < 0) {
+		f = NULL;
+		goto fail;
+	}
+	f = NULL;
+
+	ec_strvec_free(items);
+	free(order);
+	items = NULL;
+	order = NULL;
+
+	cmd = EC_NODE_CMD(EC_NO_ID, str, leaf);
+	free(str);
+
+	return cmd;
+
+fail:
+	if (f != NULL)
+		fclose(f);
+	free(str);
+	ec_strvec_free(items);
+	free(order);
+	ec_node_free(leaf);
+	return NULL;
+}
+
+static struct ec_node *gen_body(struct gen *gen, unsigned int depth, struct ec_strvec *sample)
+{
+	unsigned int kinds = gen->params->flags & EC_TEST_GRAMMAR_CMD ? 4 : 3;
+	char kw[32];
+
+	if (depth == 0) {
+		if (gen_range(gen, 2) == 0)
+			return gen_pair(gen, sample);
+		gen_keyword(gen, kw, sizeof(kw));
+		if (sample_add(sample, kw) < 0)
+			return NULL;
+		return ec_node_str(EC_NO_ID, kw);
+	}
+
+	switch (gen_range(gen, kinds)) {
+	case 0:
+		return gen_chain(gen, depth, sample);
+	case 1:
+		return gen_fan(gen, depth, sample);
+	case 2:
+		return gen_bag(gen, sample);
+	default:
+		return gen_cmd(gen, sample);
+	}
+}
+
+static char *sample_join(const struct ec_strvec *sample)
+{
+	size_t i, len = 0, off = 0;
+	char *line;
+
+	for (i = 0; i < ec_strvec_len(sample); i++)
+		len += strlen(ec_strvec_val(sample, i)) + 1;
+
+	line = malloc(len + 1);
+	if (line == NULL)
+		return NULL;
+
+	for (i = 0; i < ec_strvec_len(sample); i++) {
+		if (i > 0)
+			line[off++] = ' ';
+		len = strlen(ec_strvec_val(sample, i));
+		memcpy(&line[off], ec_strvec_val(sample, i), len);
+		off += len;
+	}
+	line[off] = '\0';
+
+	return line;
+}
+
+struct ec_node *
+ec_test_grammar(const struct ec_test_grammar_params *params, struct ec_strvec *lines)
+{
+	struct gen gen = {.params = params, .state = params->seed};
+	struct ec_config *config = NULL, *children = NULL;
+	struct ec_strvec *sample = NULL;
+	struct ec_node *root, *cmd;
+	char kw[32], *line;
+	unsigned int i;
+	int ret;
+
+	if (params->width == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* the commands are configured at once: ec_node_or_add() duplicates
+	 * the configuration, which would make the generation quadratic */
+	root = EC_NODE_OR(EC_NO_ID);
+	if (root == NULL)
+		return NULL;
+	children = ec_config_list();
+	if (children == NULL)
+		goto fail;
+
+	for (i = 0; i < params->n_cmds; i++) {
+		if (lines != NULL) {
+			sample = ec_strvec();
+			if (sample == NULL)
+				goto fail;
+		}
+
+		/* the loops of the first level fans go back to the root */
+		gen.fan = root;
+		gen.count = 0;
+		snprintf(kw, sizeof(kw), "%s%u", words[gen_range(&gen, EC_COUNT_OF(words))], i);
+		if (sample_add(sample, kw) < 0)
+			goto fail;
+		cmd = EC_NODE_SEQ(
+			EC_NO_ID, ec_node_str(EC_NO_ID, kw), gen_body(&gen, params->depth, sample)
+		);
+		if (ec_config_list_add(children, ec_config_node(cmd)) < 0)
+			goto fail;
+
+		if (lines != NULL) {
+			line = sample_join(sample);
+			if (line == NULL)
+				goto fail;
+			if (ec_strvec_add(lines, line) < 0) {
+				free(line);
+				goto fail;
+			}
+			free(line);
+			ec_strvec_free(sample);
+			sample = NULL;
+		}
+	}
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+	ret = ec_config_dict_set(config, "children", children);
+	children = NULL;
+	if (ret < 0)
+		goto fail;
+	ret = ec_node_set_config(root, config);
+	config = NULL;
+	if (ret < 0)
+		goto fail;
+
+	return root;
+
+fail:
+	ec_strvec_free(sample);
+	ec_config_free(config);
+	ec_config_free(children);
+	ec_node_free(root);
+	return NULL;
+}
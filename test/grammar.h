@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+/**
+ * @addtogroup ecoli_test
+ * @{
+ *
+ * @brief Synthetic grammar generator
+ *
+ * Build large grammars shaped like the command line of a network
+ * operating system, to test and benchmark the library at scale. The
+ * output only depends on the parameters: the same seed always gives
+ * the same grammar and the same sample lines.
+ *
+ * The grammar is an "or" node with one child per command. A command
+ * starts with a unique keyword, followed by a body built recursively
+ * from these constructs:
+ * - a chain of keywords (some optional), in a "seq" node;
+ * - a fan of alternatives, in an "or" node;
+ * - a bag of keyword/value options, in a "subset" node;
+ * - a command string, in a "cmd" node.
+ *
+ * Values are "int", "re" (IPv4 addresses) or "dynlist" (interface
+ * names) leaves, always preceded by a keyword.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <ecoli.h>
+
+/**
+ * Flags of the grammar generator.
+ */
+enum ec_test_grammar_flags {
+	/** Use "cmd" nodes for some command bodies. */
+	EC_TEST_GRAMMAR_CMD = 1 << 0,
+	/** Use "dynlist" leaves. The grammar cannot be exported to YAML. */
+	EC_TEST_GRAMMAR_DYNLIST = 1 << 1,
+	/**
+	 * Add alternatives that refer to an enclosing node, creating loops
+	 * in the grammar graph. The grammar cannot be exported to YAML.
+	 */
+	EC_TEST_GRAMMAR_LOOP = 1 << 2,
+};
+
+/**
+ * Parameters of the grammar generator.
+ */
+struct ec_test_grammar_params {
+	uint64_t seed; /**< Seed of the pseudo-random generator. */
+	unsigned int n_cmds; /**< Number of commands. */
+	unsigned int width; /**< Maximum number of alternatives or options (>= 1). */
+	unsigned int depth; /**< Maximum nesting depth of a command body. */
+	unsigned int flags; /**< Flags (enum ec_test_grammar_flags). */
+};
+
+/**
+ * Generate a grammar.
+ *
+ * @param params
+ *   The generator parameters.
+ * @param lines
+ *   If not NULL, one valid command line per command is appended to this
+ *   string vector. The tokens are separated by one space.
+ * @return
+ *   The "or" node containing the commands, or NULL on error (errno is
+ *   set). It must be freed by the caller with ec_node_free().
+ */
+struct ec_node *
+ec_test_grammar(const struct ec_test_grammar_params *params, struct ec_strvec *lines);
+
+/** @} */
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "grammar.h"
 #include "test.h"
 
 static unsigned int test_iter(struct ec_node *node)
@@ -24,11 +25,20 @@ static unsigned int test_iter(struct ec_node *node)
 	return count;
 }
 
+static int test_free_loops(void);
+
+/* same name than a registered type */
+static struct ec_node_type dup_type = {
+	.name = "seq",
+};
+
 EC_TEST_MAIN()
 {
 	struct ec_node *node = NULL, *expr = NULL;
 	struct ec_node *expr2 = NULL, *val = NULL, *op = NULL, *seq = NULL;
 	const struct ec_node_type *type;
+	struct ec_strvec *vec = NULL;
+	struct ec_node_stats stats;
 	struct ec_node *child;
 	unsigned int count;
 	FILE *f = NULL;
@@ -63,6 +73,56 @@ EC_TEST_MAIN()
 	free(buf);
 	buf = NULL;
 
+	/* profiling counters */
+	ec_node_stats_enable(true);
+	vec = EC_STRVEC("x", "y");
+	if (vec == NULL)
+		goto fail;
+	ec_pnode_free(ec_parse_strvec(node, vec));
+	ec_pnode_free(ec_parse_strvec_flags(node, vec, EC_PARSE_ARENA));
+	ec_strvec_free(vec);
+	vec = EC_STRVEC("x", "z");
+	if (vec == NULL)
+		goto fail;
+	ec_pnode_free(ec_parse_strvec(node, vec));
+	ec_comp_free(ec_complete_strvec(node, vec));
+	ec_strvec_free(vec);
+	vec = NULL;
+	ec_node_stats_enable(false);
+
+	ec_node_get_stats(ec_node_find(node, "id_y"), &stats);
+	testres |= EC_TEST_CHECK(
+		stats.parse_calls == 4 && stats.parse_match == 2 && stats.parse_nomatch == 2
+			&& stats.complete_calls == 1 && stats.allocs == 6
+			&& stats.total_ns == stats.self_ns,
+		"bad stats\n"
+	);
+	ec_node_get_stats(node, &stats);
+	testres |= EC_TEST_CHECK(
+		stats.parse_calls == 3 && stats.parse_match == 2 && stats.parse_nomatch == 1
+			&& stats.complete_calls == 1 && stats.total_ns >= stats.self_ns,
+		"bad stats\n"
+	);
+
+	f = open_memstream(&buf, &buflen);
+	if (f == NULL)
+		goto fail;
+	ret = ec_node_stats_dump(f, node, EC_NODE_STATS_TEXT);
+	ret |= ec_node_stats_dump(f, node, EC_NODE_STATS_JSON);
+	fclose(f);
+	f = NULL;
+	testres |= EC_TEST_CHECK(
+		ret == 0 && strstr(buf, "self_ns") && strstr(buf, " id_y\n")
+			&& strstr(buf, "{\"type\": \"str\", \"id\": \"id_x\", \"self_ns\": "),
+		"bad stats dump\n"
+	);
+	free(buf);
+	buf = NULL;
+
+	ret = ec_node_stats_reset(node);
+	ec_node_get_stats(ec_node_find(node, "id_x"), &stats);
+	testres |= EC_TEST_CHECK(ret == 0 && stats.parse_calls == 0, "stats not reset\n");
+
 	desc = ec_node_desc(node);
 	testres |= EC_TEST_CHECK(
 		!strcmp(ec_node_type(node)->name, "seq") && !strcmp(ec_node_id(node), EC_NO_ID)
@@ -104,6 +164,10 @@ EC_TEST_MAIN()
 
 	child = ec_node_find(node, "id_dezdex");
 	testres |= EC_TEST_CHECK(child == NULL, "child with wrong id should be NULL");
+	child = ec_node_find_atom(node, ec_atom_lookup("id_y"));
+	testres |= EC_TEST_CHECK(
+		child != NULL && ec_node_id(child) == ec_atom_lookup("id_y"), "bad child id_y atom"
+	);
 
 	ret = ec_dict_set(ec_node_attrs(node), "key", "val", NULL);
 	testres |= EC_TEST_CHECK(ret == 0, "cannot set node attribute\n");
@@ -116,6 +180,12 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK(
 		type != NULL && ec_node_check_type(node, type) < 0, "node type should not be str"
 	);
+	errno = 0;
+	type = ec_node_type_lookup("deznuindez");
+	testres |= EC_TEST_CHECK(type == NULL && errno == ENOENT, "type should not exist");
+	errno = 0;
+	ret = ec_node_type_register(&dup_type, false);
+	testres |= EC_TEST_CHECK(ret < 0 && errno == EEXIST, "type should already be registered");
 
 	ec_node_free(node);
 	node = NULL;
@@ -183,9 +253,28 @@ EC_TEST_MAIN()
 	ec_node_free(expr);
 	expr = NULL;
 
+	/* a loop between two nodes, one of them also looping on itself */
+	expr = ec_node("or", EC_NO_ID);
+	seq = ec_node("or", EC_NO_ID);
+	if (expr == NULL || seq == NULL)
+		goto fail;
+	if (ec_node_or_add(expr, ec_node_clone(seq)) < 0)
+		goto fail;
+	if (ec_node_or_add(seq, ec_node_clone(expr)) < 0)
+		goto fail;
+	if (ec_node_or_add(seq, ec_node_clone(seq)) < 0)
+		goto fail;
+	ec_node_free(seq);
+	seq = NULL;
+	ec_node_free(expr);
+	expr = NULL;
+
+	testres |= test_free_loops();
+
 	return testres;
 
 fail:
+	ec_strvec_free(vec);
 	ec_node_free(expr);
 	ec_node_free(expr2);
 	ec_node_free(val);
@@ -198,3 +287,76 @@ fail:
 	assert(errno != 0);
 	return -1;
 }
+
+/*
+ * Free generated grammars containing loops, while holding references
+ * to some of their nodes, released later.
+ */
+static int test_free_loops(void)
+{
+	struct ec_test_grammar_params params = {
+		.n_cmds = 20,
+		.width = 3,
+		.depth = 3,
+		.flags = EC_TEST_GRAMMAR_CMD | EC_TEST_GRAMMAR_DYNLIST | EC_TEST_GRAMMAR_LOOP,
+	};
+	struct ec_node *refs[8], *root, *lex, *node;
+	struct ec_strvec *lines = NULL;
+	struct ec_pnode *p;
+	unsigned int i, j, n_lines;
+	int testres = 0;
+	size_t idx;
+
+	for (params.seed = 0; params.seed < 16; params.seed++) {
+		lines = ec_strvec();
+		if (lines == NULL)
+			return -1;
+		root = ec_test_grammar(&params, lines);
+		if (root == NULL) {
+			ec_strvec_free(lines);
+			return -1;
+		}
+		n_lines = ec_strvec_len(lines);
+		testres |= EC_TEST_CHECK(
+			n_lines == params.n_cmds, "invalid number of lines (%u)", n_lines
+		);
+
+		lex = ec_node_sh_lex(EC_NO_ID, ec_node_clone(root));
+		for (i = 0; lex != NULL && i < n_lines; i++) {
+			p = ec_parse(lex, ec_strvec_val(lines, i));
+			testres |= EC_TEST_CHECK(
+				ec_pnode_matches(p), "<%s> does not match", ec_strvec_val(lines, i)
+			);
+			ec_pnode_free(p);
+		}
+		testres |= EC_TEST_CHECK(lex != NULL, "cannot create sh_lex node");
+
+		/* the first reference is a command, the others are deeper */
+		for (i = 0; i < EC_COUNT_OF(refs); i++) {
+			node = root;
+			for (j = 0; j <= i && ec_node_get_children_count(node) > 0; j++) {
+				idx = (params.seed + i + j) % ec_node_get_children_count(node);
+				if (ec_node_get_child(node, idx, &node) < 0)
+					break;
+			}
+			refs[i] = ec_node_clone(node);
+		}
+
+		ec_node_free(lex);
+		ec_node_free(root);
+
+		/* the command is still usable */
+		lex = ec_node_sh_lex(EC_NO_ID, refs[0]);
+		refs[0] = NULL;
+		p = ec_parse(lex, ec_strvec_val(lines, params.seed % n_lines));
+		testres |= EC_TEST_CHECK(ec_pnode_matches(p), "command does not match");
+		ec_pnode_free(p);
+		ec_node_free(lex);
+
+		for (i = EC_COUNT_OF(refs); i > 0; i--)
+			ec_node_free(refs[i - 1]);
+		ec_strvec_free(lines);
+	}
+
+	return testres;
+}
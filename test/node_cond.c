@@ -25,7 +25,119 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo", "foo", "foo", "foo");
 	ec_node_free(node);
 
-	/* XXX test completion */
+	node = ec_node_cond(
+		EC_NO_ID,
+		"or(cmp(eq, count(find(root(), id_foo)), 2), "
+		"and(find(current(), id_bar), bool(1)))",
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(
+				EC_NO_ID, ec_node_str("id_foo", "foo"), ec_node_str("id_bar", "bar")
+			),
+			0,
+			0
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 4, "foo", "foo", "foo", "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo", "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "bar", "foo");
+	ec_node_free(node);
+
+	/* nodesets larger than the local storage, merged from several subtrees */
+	node = ec_node_cond(
+		EC_NO_ID,
+		"and(cmp(eq, find(find(root(), id_item), id_foo), find(root(), id_foo)), "
+		"cmp(ge, count(find(find(root(), id_item), id_foo)), 5), "
+		"cmp(eq, first_child(find(root(), id_item)), find(root(), id_foo)))",
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(
+				"id_item",
+				ec_node_str("id_foo", "foo"),
+				ec_node_str("id_bar", "bar")
+			),
+			0,
+			0
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo", "foo", "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 5, "foo", "foo", "foo", "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 6, "foo", "foo", "foo", "foo", "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo", "foo", "foo", "foo", "foo", "bar");
+	ec_node_free(node);
+
+	/* a large stack is allocated */
+	node = ec_node_cond(
+		EC_NO_ID,
+		"or(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "
+		"find(root(), id_foo))",
+		EC_NODE_OR(EC_NO_ID, ec_node_str("id_foo", "foo"), ec_node_str(EC_NO_ID, "bar"))
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	ec_node_free(node);
+
+	/* the condition is compiled when the node is configured */
+	node = ec_node_cond(EC_NO_ID, "nosuchfunc(root())", ec_node_str(EC_NO_ID, "foo"));
+	testres |= EC_TEST_CHECK(node == NULL, "unknown function should be rejected");
+	ec_node_free(node);
+
+	/* the child of a cond node does not match */
+	node = ec_node_many(
+		EC_NO_ID,
+		EC_NODE_OR(
+			EC_NO_ID,
+			ec_node_str("id_bar", "bar"),
+			ec_node_cond(
+				EC_NO_ID,
+				"cmp(eq, count(find(root(), id_bar)), 0)",
+				ec_node_str(EC_NO_ID, "baz")
+			)
+		),
+		0,
+		0
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "baz", "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "bar", "baz");
+
+	/* a false condition that cannot become true hides the completions */
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, "bar", "baz", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "baz", "", EC_VA_END, "bar", "baz", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", "", EC_VA_END, "bar", EC_VA_END);
+	ec_node_free(node);
+
+	/* a false condition that can become true with the child is completed */
+	node = ec_node_cond(
+		EC_NO_ID,
+		"cmp(ge, count(find(root(), id_foo)), 1)",
+		ec_node_str("id_foo", "foo")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, "foo", EC_VA_END);
+	ec_node_free(node);
 
 	return testres;
 }
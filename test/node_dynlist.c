@@ -60,6 +60,11 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "");
 	ec_node_free(node);
 
+	/* invalid regular expression */
+	node = ec_node_dynlist(EC_NO_ID, get_names, NULL, "[a-z", DYNLIST_MATCH_REGEXP);
+	testres |= EC_TEST_CHECK(node == NULL, "node should not be created");
+	ec_node_free(node);
+
 	/* test completion */
 	node = ec_node_dynlist(EC_NO_ID, get_names, NULL, "[a-z]+", DYNLIST_MATCH_LIST);
 	if (node == NULL) {
@@ -6,7 +6,7 @@
 
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	struct ec_node *node, *foo;
 	int testres = 0;
 
 	node = ec_node_many(
@@ -40,5 +40,32 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", "", EC_VA_END, "foo", "bar", EC_VA_END);
 	ec_node_free(node);
 
+	/* an occurrence is forgotten when its branch is dropped */
+	foo = ec_node_str(EC_NO_ID, "foo");
+	node = ec_node_many(
+		EC_NO_ID,
+		EC_NODE_OR(
+			EC_NO_ID,
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				ec_node_once(EC_NO_ID, ec_node_clone(foo)),
+				ec_node_str(EC_NO_ID, "x")
+			),
+			ec_node_once(EC_NO_ID, ec_node_clone(foo))
+		),
+		0,
+		0
+	);
+	ec_node_free(foo);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "x", "foo");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "foo", "", EC_VA_END, "x", EC_VA_END);
+	ec_node_free(node);
+
 	return testres;
 }
@@ -2,12 +2,19 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <string.h>
+
 #include "test.h"
 
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	static const char *const expected[] = {"bar", "bar2", "baz", "b"};
+	struct ec_node *node, *baz, *grp;
+	struct ec_comp_item *item;
+	struct ec_comp *c;
+	struct ec_pnode *p;
 	int testres = 0;
+	size_t n;
 
 	node = EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "foo"), ec_node_str(EC_NO_ID, "bar"));
 	if (node == NULL) {
@@ -47,5 +54,142 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
 	ec_node_free(node);
 
+	/* enough children to use the keyword table, items keep the children order */
+	node = EC_NODE_OR(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "foo"),
+		ec_node_str(EC_NO_ID, "bar"),
+		ec_node_str(EC_NO_ID, "bar2"),
+		ec_node_int(EC_NO_ID, 0, 10, 10),
+		ec_node_str(EC_NO_ID, "toto"),
+		ec_node_str(EC_NO_ID, "baz"),
+		ec_node_str(EC_NO_ID, "titi"),
+		ec_node_str(EC_NO_ID, "b"),
+		ec_node_str(EC_NO_ID, "ab")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node,
+		"",
+		EC_VA_END,
+		"foo",
+		"bar",
+		"bar2",
+		"toto",
+		"baz",
+		"titi",
+		"b",
+		"ab",
+		EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "b", EC_VA_END, "bar", "bar2", "baz", "b", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", EC_VA_END, "bar", "bar2", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "a", EC_VA_END, "ab", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "b", "", EC_VA_END, EC_VA_END);
+	c = ec_complete(node, "b");
+	n = 0;
+	EC_COMP_FOREACH (item, c, EC_COMP_FULL) {
+		testres |= EC_TEST_CHECK(
+			n < EC_COUNT_OF(expected)
+				&& !strcmp(ec_comp_item_get_str(item), expected[n]),
+			"bad completion order\n"
+		);
+		n++;
+	}
+	testres |= EC_TEST_CHECK(n == EC_COUNT_OF(expected), "bad completion count\n");
+	ec_comp_free(c);
+	ec_node_free(node);
+
+	/* enough children to use the first token dispatch */
+	baz = ec_node_str("baz", "baz");
+	node = EC_NODE_OR(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "foo"),
+		EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "show"), ec_node_str(EC_NO_ID, "a")),
+		ec_node_int("int", 0, 100, 10),
+		ec_node_str("str12", "12"),
+		EC_NODE_CMD(EC_NO_ID, "set x|y"),
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "all")),
+			ec_node_str(EC_NO_ID, "show"),
+			ec_node_str(EC_NO_ID, "b")
+		),
+		ec_node_str(EC_NO_ID, "bar"),
+		baz,
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "opt"))
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "show", "a");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "show", "b");
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "all", "show", "b");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "set", "y");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "baz");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "opt");
+	testres |= EC_TEST_CHECK_PARSE(node, 0, "toto");
+	testres |= EC_TEST_CHECK_PARSE(node, 0);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "s", EC_VA_END, "show", "set", "show", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "a", EC_VA_END, "all", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "show", "", EC_VA_END, "a", "b", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "set", "", EC_VA_END, "x", "y", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "1", EC_VA_END, "12", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", "", EC_VA_END, EC_VA_END);
+
+	/* the first matching child wins */
+	p = ec_parse(node, "12");
+	testres |= EC_TEST_CHECK(
+		ec_pnode_find(p, "int") != NULL && ec_pnode_find(p, "str12") == NULL,
+		"int should match first\n"
+	);
+	ec_pnode_free(p);
+
+	/* the index is not used anymore when a child changes */
+	testres |= EC_TEST_CHECK(ec_node_str_set_str(baz, "qux") == 0, "cannot set string\n");
+	p = ec_parse(node, "qux");
+	testres |= EC_TEST_CHECK(
+		ec_pnode_len(p) == 1 && ec_pnode_find(p, "baz") != NULL, "qux should match\n"
+	);
+	ec_pnode_free(p);
+	testres |= EC_TEST_CHECK_PARSE(node, 0, "baz");
+	ec_node_free(node);
+
+	/* the index is not used anymore when a descendant changes */
+	grp = EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "x"));
+	node = EC_NODE_OR(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "foo"),
+		ec_node_str(EC_NO_ID, "bar"),
+		ec_node_str(EC_NO_ID, "baz"),
+		ec_node_str(EC_NO_ID, "qux"),
+		ec_node_str(EC_NO_ID, "a"),
+		ec_node_str(EC_NO_ID, "b"),
+		ec_node_str(EC_NO_ID, "c"),
+		EC_NODE_SEQ(EC_NO_ID, ec_node_clone(grp), ec_node_str(EC_NO_ID, "end"))
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		ec_node_free(grp);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "x", "end");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "y", "end");
+	testres |= EC_TEST_CHECK(
+		ec_node_or_add(grp, ec_node_str(EC_NO_ID, "y")) == 0, "cannot add child\n"
+	);
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "y", "end");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "y", EC_VA_END, "y", EC_VA_END);
+	ec_node_free(grp);
+	ec_node_free(node);
+
 	return testres;
 }
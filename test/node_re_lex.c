@@ -2,12 +2,27 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <errno.h>
+#include <string.h>
+
 #include "test.h"
 
+/* check that the invalid pattern is named in the logs */
+static int log_cb(int type, enum ec_log_level level, void *opaque, const char *str)
+{
+	(void)type;
+	(void)level;
+	if (strstr(str, "<(>") != NULL)
+		*(int *)opaque = 1;
+
+	return 0;
+}
+
 EC_TEST_MAIN()
 {
 	struct ec_node *node;
 	int ret, testres = 0;
+	int logged = 0;
 
 	node = ec_node_re_lex(
 		EC_NO_ID,
@@ -50,11 +65,51 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo bar324");
 	testres |= EC_TEST_CHECK_PARSE(node, 1, "");
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "foobar");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "324foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo?");
+
+	/* an invalid pattern is reported, the node is unchanged */
+	ec_log_fct_register(log_cb, &logged);
+	ret = ec_node_re_lex_add(node, "(", 1, NULL);
+	testres |= EC_TEST_CHECK(ret < 0 && errno == EINVAL, "should not add invalid regexp\n");
+	ec_log_fct_register(NULL, NULL);
+	testres |= EC_TEST_CHECK(logged, "the invalid regexp is not logged\n");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo bar324");
 
 	/* no completion */
 	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, EC_VA_END);
 
 	ec_node_free(node);
 
+	/* the tokens are tagged with the index of their pattern plus one */
+	node = ec_node_re_lex(
+		EC_NO_ID,
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_any_kind(EC_NO_ID, 1),
+			ec_node_str(EC_NO_ID, "="),
+			ec_node_any_kind(EC_NO_ID, 2)
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	ret = ec_node_re_lex_add(node, "[a-zA-Z]+", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[0-9]+", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "=", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[ \t]+", 0, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo = 42");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo=42");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "42 = foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo = bar");
+
+	ec_node_free(node);
+
 	return testres;
 }
@@ -29,6 +29,23 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "  foo toto bar'");
 	ec_node_free(node);
 
+	/* the tokens still have the deprecated start and end attributes */
+	node = ec_node_sh_lex(
+		EC_NO_ID,
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "foo"),
+			ec_node_any(EC_NO_ID, EC_STRVEC_ATTR_START),
+			ec_node_any(EC_NO_ID, EC_STRVEC_ATTR_END)
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo bar baz");
+	ec_node_free(node);
+
 	/* test completion */
 	node = ec_node_sh_lex(
 		EC_NO_ID,
@@ -2,12 +2,19 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <string.h>
+
 #include "test.h"
 
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	const struct ec_pnode *child;
+	struct ec_strvec *vec = NULL;
+	struct ec_pnode *p = NULL;
+	struct ec_node *node, *node2, *grp = NULL, *str = NULL;
+	char buf[16];
 	int testres = 0;
+	unsigned int i;
 
 	node = EC_NODE_SUBSET(
 		EC_NO_ID,
@@ -29,6 +36,23 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, 2, "bar", "foo");
 	testres |= EC_TEST_CHECK_PARSE(node, 0, " ");
 	testres |= EC_TEST_CHECK_PARSE(node, 0, "foox");
+
+	/* the children are stored in the configuration */
+	node2 = ec_node("subset", EC_NO_ID);
+	if (node2 == NULL
+	    || ec_node_set_config(node2, ec_config_dup(ec_node_get_config(node))) < 0
+	    || ec_node_subset_add(node2, ec_node_str(EC_NO_ID, "titi")) < 0) {
+		EC_LOG(EC_LOG_ERR, "cannot configure node\n");
+		ec_node_free(node2);
+		ec_node_free(node);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK(
+		ec_config_count(ec_config_dict_get(ec_node_get_config(node2), "children")) == 4,
+		"bad number of children in the configuration\n"
+	);
+	testres |= EC_TEST_CHECK_PARSE(node2, 4, "titi", "bar", "foo", "toto");
+	ec_node_free(node2);
 	ec_node_free(node);
 
 	/* test completion */
@@ -62,5 +86,110 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
 	ec_node_free(node);
 
+	/* many children, given in reverse order */
+	node = EC_NODE_SUBSET(EC_NO_ID);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	vec = ec_strvec();
+	if (vec == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create strvec\n");
+		ec_node_free(node);
+		return -1;
+	}
+	for (i = 0; i < 24; i++) {
+		snprintf(buf, sizeof(buf), "k%u", i);
+		if (ec_node_subset_add(node, ec_node_str(buf, buf)) < 0) {
+			EC_LOG(EC_LOG_ERR, "cannot add child\n");
+			testres = -1;
+			goto out;
+		}
+		snprintf(buf, sizeof(buf), "k%u", 23 - i);
+		if (ec_strvec_add(vec, buf) < 0) {
+			EC_LOG(EC_LOG_ERR, "cannot add string\n");
+			testres = -1;
+			goto out;
+		}
+	}
+	p = ec_parse_strvec(node, vec);
+	testres |= EC_TEST_CHECK(
+		p != NULL && ec_pnode_matches(p) && ec_pnode_len(p) == 24, "bad parsing length\n"
+	);
+	child = p ? ec_pnode_get_first_child(p) : NULL;
+	testres |= EC_TEST_CHECK(
+		child != NULL && !strcmp(ec_node_id(ec_pnode_get_node(child)), "k23"),
+		"bad first child\n"
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "k23", "k0", "k1", "k9", EC_VA_END, "k9", EC_VA_END
+	);
+	ec_pnode_free(p);
+	p = NULL;
+	ec_node_free(node);
+
+	/* the longest match wins, the first child on equality */
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		ec_node_str("short", "foo"),
+		EC_NODE_SEQ("long", ec_node_str(EC_NO_ID, "foo"), ec_node_str(EC_NO_ID, "bar")),
+		ec_node_str("bar", "bar"),
+		ec_node_str("other", "foo")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		goto out;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "foo", "bar", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "bar");
+	p = ec_parse(node, "foo");
+	child = p ? ec_pnode_get_first_child(p) : NULL;
+	testres |= EC_TEST_CHECK(
+		child != NULL && !strcmp(ec_node_id(ec_pnode_get_node(child)), "short"),
+		"bad first child\n"
+	);
+	ec_pnode_free(p);
+	p = NULL;
+
+	/* children depending on the parsing state */
+	ec_node_free(node);
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		ec_node_once(EC_NO_ID, ec_node_str("foo", "foo")),
+		ec_node_many(EC_NO_ID, ec_node_str("foo", "foo"), 0, 0)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		goto out;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "foo");
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "foo", "foo", "", EC_VA_END, "foo", "foo", "foo", EC_VA_END
+	);
+
+	/* a descendant depends on the parsing state after the configuration */
+	ec_node_free(node);
+	str = ec_node_str("foo", "foo");
+	grp = ec_node("or", EC_NO_ID);
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		EC_NODE_SEQ(EC_NO_ID, ec_node_clone(str), ec_node_str(EC_NO_ID, "bar")),
+		ec_node_clone(grp)
+	);
+	if (node == NULL || ec_node_or_add(grp, ec_node_once(EC_NO_ID, ec_node_clone(str))) < 0) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		goto out;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "foo", "foo", "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "bar", "foo");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "foo", "bar", "", EC_VA_END, EC_VA_END);
+
+out:
+	ec_pnode_free(p);
+	ec_strvec_free(vec);
+	ec_node_free(node);
+	ec_node_free(grp);
+	ec_node_free(str);
+
 	return testres;
 }
@@ -7,9 +7,62 @@
 
 #include "test.h"
 
+/* append the ids of the visited nodes to a string, skip their children */
+static int visit_enter(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	size_t start,
+	size_t len,
+	void *opaque
+)
+{
+	char *events = opaque;
+	const char *id = ec_node_id(node);
+
+	(void)strvec;
+	(void)start;
+	(void)len;
+
+	if (!strcmp(id, EC_NO_ID))
+		return 0;
+
+	strcat(events, "<");
+	strcat(events, id);
+
+	return 1;
+}
+
+static int visit_leave(
+	const struct ec_node *node,
+	const struct ec_strvec *strvec,
+	size_t start,
+	size_t len,
+	void *opaque
+)
+{
+	char *events = opaque;
+	const char *id = ec_node_id(node);
+	size_t i;
+
+	if (strcmp(id, EC_NO_ID) != 0) {
+		strcat(events, ">");
+		for (i = start; i < start + len; i++)
+			strcat(events, ec_strvec_val(strvec, i));
+	}
+
+	return 0;
+}
+
 EC_TEST_MAIN()
 {
-	struct ec_node *node = NULL;
+	struct ec_node *node = NULL, *x = NULL;
+	struct ec_parse_visitor visitor = {
+		.enter = visit_enter,
+		.leave = visit_leave,
+	};
+	struct ec_parse_memo_stats stats;
+	char events[64];
+	struct ec_strvec *vec = NULL;
 	struct ec_pnode *p = NULL, *p2 = NULL;
 	const struct ec_pnode *pc;
 	FILE *f = NULL;
@@ -39,12 +92,34 @@ EC_TEST_MAIN()
 	buf = NULL;
 	ec_pnode_free(p);
 
+	vec = EC_STRVEC("x y");
+	if (vec == NULL)
+		goto fail;
+	ret = ec_parse_matches(node, vec);
+	testres |= EC_TEST_CHECK(ret == 1, "bad match len\n");
+	ec_strvec_free(vec);
+	vec = EC_STRVEC("x", "y");
+	if (vec == NULL)
+		goto fail;
+	ret = ec_parse_matches(node, vec);
+	testres |= EC_TEST_CHECK(ret == EC_PARSE_NOMATCH, "should not match\n");
+	ec_strvec_free(vec);
+	vec = NULL;
+
 	p = ec_parse(node, "x y");
 	testres |= EC_TEST_CHECK(p != NULL && ec_pnode_matches(p), "parse should match\n");
 	testres |= EC_TEST_CHECK(ec_pnode_len(p) == 1, "bad parse len\n");
 
-	ret = ec_dict_set(ec_pnode_get_attrs(p), "key", "val", NULL);
+	testres |= EC_TEST_CHECK(
+		ec_pnode_get_attrs(p) == ec_dict_empty(), "attributes should be shared\n"
+	);
+	ret = ec_pnode_set_attr(p, "key", "val", NULL);
 	testres |= EC_TEST_CHECK(ret == 0, "cannot set parse attribute\n");
+	testres |= EC_TEST_CHECK(
+		ec_dict_len(ec_dict_empty()) == 0
+			&& !strcmp(ec_dict_get(ec_pnode_get_attrs(p), "key"), "val"),
+		"bad parse attribute\n"
+	);
 
 	p2 = ec_pnode_dup(p);
 	testres |= EC_TEST_CHECK(p2 != NULL && ec_pnode_matches(p2), "parse should match\n");
@@ -63,6 +138,17 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK(pc != NULL, "cannot find id_y");
 	pc = ec_pnode_find(p, "id_dezdezdez");
 	testres |= EC_TEST_CHECK(pc == NULL, "should not find bad id");
+	pc = ec_pnode_find_atom(p, ec_atom_lookup("id_x"));
+	testres |= EC_TEST_CHECK(
+		pc != NULL && pc == ec_pnode_find(p, "id_x"), "cannot find id_x atom"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_pnode_count_atom(p, ec_atom_lookup("id_y")) == 1, "bad id_y atom count"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_pnode_find_atom(p, NULL) == NULL && ec_pnode_count_atom(p, NULL) == 0,
+		"NULL atom should not be found"
+	);
 
 	f = open_memstream(&buf, &buflen);
 	if (f == NULL)
@@ -81,9 +167,202 @@ EC_TEST_MAIN()
 
 	ec_pnode_free(p);
 	ec_node_free(node);
+	node = NULL;
+
+	/* the same child is parsed twice at the same offset */
+	x = ec_node_str("id_x", "x");
+	if (x == NULL)
+		goto fail;
+	node = EC_NODE_OR(
+		EC_NO_ID,
+		EC_NODE_SEQ(EC_NO_ID, ec_node_clone(x), ec_node_str(EC_NO_ID, "a")),
+		EC_NODE_SEQ(EC_NO_ID, ec_node_clone(x), ec_node_str(EC_NO_ID, "b"))
+	);
+	ec_node_free(x);
+	if (node == NULL)
+		goto fail;
+
+	vec = EC_STRVEC("x", "b");
+	if (vec == NULL)
+		goto fail;
+
+	p = ec_parse_strvec_flags(node, vec, EC_PARSE_MEMO);
+	testres |= EC_TEST_CHECK(p != NULL && ec_pnode_matches(p), "parse should match\n");
+	testres |= EC_TEST_CHECK(ec_pnode_len(p) == 2, "bad parse len\n");
+	pc = ec_pnode_find(p, "id_x");
+	testres |= EC_TEST_CHECK(
+		pc != NULL && ec_pnode_get_parent(pc) != NULL
+			&& ec_pnode_get_parent(ec_pnode_get_parent(pc)) == p,
+		"invalid parent\n"
+	);
+	ret = ec_pnode_get_memo_stats(p, &stats);
+	testres |= EC_TEST_CHECK(
+		ret == 0 && stats.hits == 1 && stats.lookups > stats.hits,
+		"bad memo stats\n"
+	);
+	ec_pnode_free(p);
+
+	/* a tree allocated from an arena can be duplicated */
+	p = ec_parse_strvec_flags(node, vec, EC_PARSE_ARENA);
+	testres |= EC_TEST_CHECK(p != NULL && ec_pnode_len(p) == 2, "bad parse len\n");
+	p2 = ec_pnode_dup(ec_pnode_find(p, "id_x"));
+	ec_pnode_free(p);
+	p = NULL;
+	testres |= EC_TEST_CHECK(
+		p2 != NULL && !strcmp(ec_strvec_val(ec_pnode_get_strvec(p2), 0), "x"),
+		"bad duplicated arena node\n"
+	);
+	ec_pnode_free(ec_pnode_get_root(p2));
+	p2 = NULL;
+
+	/* only the nodes of the successful parsing are visited */
+	events[0] = '\0';
+	ret = ec_parse_strvec_visit(node, vec, 0, &visitor, events);
+	testres |= EC_TEST_CHECK(ret == 2, "bad visit len\n");
+	testres |= EC_TEST_CHECK(!strcmp(events, "<id_x>x"), "bad visit events: %s\n", events);
+	visitor.enter = NULL;
+	events[0] = '\0';
+	ret = ec_parse_strvec_visit(node, vec, EC_PARSE_MEMO, &visitor, events);
+	testres |= EC_TEST_CHECK(ret == 2, "bad visit len\n");
+	testres |= EC_TEST_CHECK(!strcmp(events, ">x"), "bad visit events: %s\n", events);
+	ec_strvec_free(vec);
+	vec = EC_STRVEC("x", "c");
+	if (vec == NULL)
+		goto fail;
+	events[0] = '\0';
+	ret = ec_parse_strvec_visit(node, vec, 0, &visitor, events);
+	testres |= EC_TEST_CHECK(
+		ret == EC_PARSE_NOMATCH && events[0] == '\0', "should not match\n"
+	);
+	ec_strvec_free(vec);
+	vec = EC_STRVEC("x", "b");
+	if (vec == NULL)
+		goto fail;
+
+	p = ec_parse_strvec(node, vec);
+	ret = ec_pnode_get_memo_stats(p, &stats);
+	testres |= EC_TEST_CHECK(
+		ret == 0 && stats.lookups == 0 && stats.hits == 0,
+		"memo stats should be empty\n"
+	);
+
+	ec_pnode_free(p);
+	p = NULL;
+	ec_node_free(node);
+	node = NULL;
+
+	/* the callbacks get the span of each node in the input */
+	ec_strvec_free(vec);
+	vec = EC_STRVEC("x", "c", "x");
+	if (vec == NULL)
+		goto fail;
+	visitor.enter = visit_enter;
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "x"),
+		ec_node_str("id_c", "c"),
+		ec_node_str("id_x", "x")
+	);
+	if (node == NULL)
+		goto fail;
+	events[0] = '\0';
+	ret = ec_parse_strvec_visit(node, vec, 0, &visitor, events);
+	testres |= EC_TEST_CHECK(ret == 3, "bad visit len\n");
+	testres |= EC_TEST_CHECK(
+		!strcmp(events, "<id_c>c<id_x>x"), "bad visit events: %s\n", events
+	);
+	ec_strvec_free(vec);
+	vec = NULL;
+	ec_node_free(node);
+
+	/* under a lexer, the spans are in the tokens of the lexer */
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_sh_lex(
+			EC_NO_ID,
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				ec_node_str("id_foo", "foo"),
+				ec_node_str(EC_NO_ID, "bar"),
+				ec_node_str("id_baz", "baz")
+			)
+		),
+		ec_node_str("id_end", "end")
+	);
+	if (node == NULL)
+		goto fail;
+	vec = EC_STRVEC("foo bar baz", "end");
+	if (vec == NULL)
+		goto fail;
+	events[0] = '\0';
+	ret = ec_parse_strvec_visit(node, vec, 0, &visitor, events);
+	testres |= EC_TEST_CHECK(ret == 2, "bad visit len\n");
+	testres |= EC_TEST_CHECK(
+		!strcmp(events, "<id_foo>foo<id_baz>baz<id_end>end"),
+		"bad visit events: %s\n",
+		events
+	);
+	ec_strvec_free(vec);
+	vec = NULL;
+	ec_node_free(node);
+
+	/* the searches give the same results with an index */
+	node = EC_NODE_SEQ(
+		"id_s",
+		ec_node_many(
+			"id_m",
+			EC_NODE_SEQ("id_p", ec_node_str("id_x", "x"), ec_node_str("id_y", "y")),
+			0,
+			0
+		),
+		ec_node_str("id_x", "x")
+	);
+	if (node == NULL)
+		goto fail;
+	vec = EC_STRVEC("x", "y", "x", "y", "x");
+	if (vec == NULL)
+		goto fail;
+
+	p = ec_parse_strvec_flags(node, vec, EC_PARSE_INDEX);
+	testres |= EC_TEST_CHECK(p != NULL && ec_pnode_len(p) == 5, "bad parse len\n");
+	testres |= EC_TEST_CHECK(
+		ec_pnode_count(p, "id_x") == 3 && ec_pnode_count(p, "id_p") == 2
+			&& ec_pnode_count(p, "id_s") == 1 && ec_pnode_count(p, "id_z") == 0,
+		"bad indexed count\n"
+	);
+	pc = ec_pnode_find(p, "id_p");
+	testres |= EC_TEST_CHECK(
+		pc != NULL && ec_pnode_count(pc, "id_x") == 1
+			&& ec_pnode_find(pc, "id_x") == ec_pnode_get_first_child(pc),
+		"bad indexed subtree search\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_pnode_find_next(p, pc, "id_p", 1) == ec_pnode_find_next(p, pc, "id_p", 0)
+			&& ec_pnode_find_next(p, pc, "id_p", 1) != NULL
+			&& ec_pnode_find_next(pc, pc, "id_x", 0) == NULL,
+		"bad indexed find next\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_pnode_find(p, "id_x") == ec_pnode_get_first_child(ec_pnode_find(p, "id_p"))
+			&& ec_pnode_find_next(p, ec_pnode_find(p, "id_s"), "id_s", 1) == NULL,
+		"bad indexed find\n"
+	);
+	ret = 0;
+	for (pc = ec_pnode_find(p, "id_x"); pc != NULL; pc = ec_pnode_find_next(p, pc, "id_x", 1))
+		ret++;
+	testres |= EC_TEST_CHECK(ret == 3, "bad indexed iteration\n");
+
+	/* the index is dropped when the tree is modified */
+	ec_pnode_del_last_child(p);
+	testres |= EC_TEST_CHECK(ec_pnode_count(p, "id_x") == 2, "bad count after modification\n");
+
+	ec_pnode_free(p);
+	ec_strvec_free(vec);
+	ec_node_free(node);
 	return testres;
 
 fail:
+	ec_strvec_free(vec);
 	ec_pnode_free(p2);
 	ec_pnode_free(p);
 	ec_node_free(node);
@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2026, libecoli contributors
+ */
+
+#include <errno.h>
+#include <locale.h>
+#include <string.h>
+
+#include "test.h"
+
+static const char *const patterns[] = {
+	"fo+|bar",
+	"^foo$",
+	"a*",
+	"(ab|a)(bc|c)?",
+	"[0-9]{1,3}(\\.[0-9]{1,3}){3}",
+	"([0-9a-fA-F]{2}:){5}[0-9a-fA-F]{2}",
+	"(eth|lo|vlan)[0-9]+(\\.[0-9]{1,4})?",
+	"[^a-c]+",
+	"[]a-]+x",
+	"[[:alpha:]_][[:alnum:]_]*",
+	"a{2,}b{0,2}",
+	".+=.*",
+	"xy|xz$",
+	"a\\+\\*",
+};
+
+/* expressions that use the dfa backend in a UTF-8 locale */
+static const char *const utf8_patterns[] = {
+	"[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+",
+	"eth[0-9]+",
+	"[a-f0-9]{2}(:[a-f0-9]{2}){5}",
+};
+
+static const char *const utf8_strings[] = {
+	"192.168.0.1",
+	"192.168.0.\xc3\xa9",
+	"eth0",
+	"eth\xd9\xa1",
+	"00:11:22:aa:bb:cc",
+	"00:11:22:aa:bb:\xc3\xa9" "e",
+};
+
+static const char *const strings[] = {
+	"",
+	"foo",
+	"fooo",
+	"bar",
+	"foobar",
+	"aaa",
+	"abc",
+	"ac",
+	"ab",
+	"192.168.0.1",
+	"1234.1.1.1",
+	"00:11:22:aa:BB:cc",
+	"00:11:22:aa:BB",
+	"eth0",
+	"vlan12.100",
+	"lo",
+	"dex",
+	"]-ax",
+	"_var1 = 2",
+	"aab",
+	"aabbb",
+	"xz",
+	"xzz",
+	"a+*",
+};
+
+/* tokens by order of priority, a digit prefix is not an identifier */
+static const char *const tokens[] = {
+	"[0-9]+",
+	"[a-z0-9]+",
+	"==?",
+	"[ \t]+",
+	"x*",
+	"end$",
+};
+
+static const char *const lines[] = {
+	"",
+	"12ab",
+	"ab12",
+	"a == 1",
+	"=x",
+	"  \t=",
+	"xx",
+	"end",
+	"endx",
+	"-",
+};
+
+EC_TEST_MAIN()
+{
+	struct ec_regex *dfa, *posix;
+	size_t i, j, k, dfa_len, posix_len;
+	bool dfa_ret, posix_ret;
+	int testres = 0;
+
+	/* the backends must give the same results */
+	for (i = 0; i < EC_COUNT_OF(patterns); i++) {
+		dfa = ec_regex(patterns[i], 0);
+		posix = ec_regex(patterns[i], EC_REGEX_POSIX);
+		if (dfa == NULL || posix == NULL) {
+			EC_TEST_ERR("cannot compile <%s>", patterns[i]);
+			ec_regex_free(dfa);
+			ec_regex_free(posix);
+			testres = -1;
+			continue;
+		}
+		testres |= EC_TEST_CHECK(
+			!strcmp(ec_regex_backend(dfa), "dfa"),
+			"<%s> should use the dfa backend",
+			patterns[i]
+		);
+		testres |= EC_TEST_CHECK(
+			!strcmp(ec_regex_backend(posix), "posix"),
+			"<%s> should use the posix backend",
+			patterns[i]
+		);
+
+		for (j = 0; j < EC_COUNT_OF(strings); j++) {
+			dfa_ret = ec_regex_match(dfa, strings[j]);
+			posix_ret = ec_regex_match(posix, strings[j]);
+			testres |= EC_TEST_CHECK(
+				dfa_ret == posix_ret,
+				"<%s> matching <%s>: dfa=%d posix=%d",
+				patterns[i],
+				strings[j],
+				dfa_ret,
+				posix_ret
+			);
+
+			dfa_len = posix_len = 0;
+			dfa_ret = ec_regex_match_prefix(dfa, strings[j], &dfa_len);
+			posix_ret = ec_regex_match_prefix(posix, strings[j], &posix_len);
+			testres |= EC_TEST_CHECK(
+				dfa_ret == posix_ret && dfa_len == posix_len,
+				"<%s> matching the start of <%s>: dfa=%d/%zu posix=%d/%zu",
+				patterns[i],
+				strings[j],
+				dfa_ret,
+				dfa_len,
+				posix_ret,
+				posix_len
+			);
+		}
+
+		ec_regex_free(dfa);
+		ec_regex_free(posix);
+	}
+
+	/* the backends must find the same tokens */
+	dfa = ec_regex_list(tokens, EC_COUNT_OF(tokens), 0);
+	posix = ec_regex_list(tokens, EC_COUNT_OF(tokens), EC_REGEX_POSIX);
+	testres |= EC_TEST_CHECK(dfa != NULL && posix != NULL, "cannot compile tokens");
+	if (dfa != NULL && posix != NULL) {
+		testres |= EC_TEST_CHECK(
+			!strcmp(ec_regex_backend(dfa), "dfa"), "tokens should use the dfa backend"
+		);
+		for (i = 0; i < EC_COUNT_OF(lines); i++) {
+			dfa_len = posix_len = j = k = 0;
+			dfa_ret = ec_regex_match_token(dfa, lines[i], &j, &dfa_len);
+			posix_ret = ec_regex_match_token(posix, lines[i], &k, &posix_len);
+			testres |= EC_TEST_CHECK(
+				dfa_ret == posix_ret && j == k && dfa_len == posix_len,
+				"token of <%s>: dfa=%d/%zu/%zu posix=%d/%zu/%zu",
+				lines[i],
+				dfa_ret,
+				j,
+				dfa_len,
+				posix_ret,
+				k,
+				posix_len
+			);
+		}
+		testres |= EC_TEST_CHECK(
+			ec_regex_match_token(dfa, "12ab", &j, &dfa_len) && j == 0 && dfa_len == 2,
+			"the first token should win"
+		);
+		testres |= EC_TEST_CHECK(
+			ec_regex_match(dfa, "ab12") && !ec_regex_match(dfa, "-"),
+			"a list should match any of its expressions"
+		);
+	}
+	ec_regex_free(dfa);
+	ec_regex_free(posix);
+
+	/* unsupported constructs fall back to posix */
+	dfa = ec_regex("(a)\\1", 0);
+	testres |= EC_TEST_CHECK(
+		dfa != NULL && !strcmp(ec_regex_backend(dfa), "posix"), "back-references use posix"
+	);
+	if (dfa != NULL) {
+		testres |= EC_TEST_CHECK(ec_regex_match(dfa, "aa"), "<(a)\\1> should match <aa>");
+		testres |= EC_TEST_CHECK(
+			!ec_regex_match(dfa, "a"), "<(a)\\1> should not match <a>"
+		);
+	}
+	ec_regex_free(dfa);
+
+	dfa = ec_regex("a(b$)", 0);
+	testres |= EC_TEST_CHECK(
+		dfa != NULL && !strcmp(ec_regex_backend(dfa), "posix"), "nested anchors use posix"
+	);
+	ec_regex_free(dfa);
+
+	dfa = ec_regex_list((const char *const[]) {"[a-z]+", "\\w+"}, 2, 0);
+	testres |= EC_TEST_CHECK(
+		dfa != NULL && !strcmp(ec_regex_backend(dfa), "posix"), "lists fall back together"
+	);
+	if (dfa != NULL) {
+		testres |= EC_TEST_CHECK(
+			ec_regex_match_token(dfa, "_a", &j, &dfa_len) && j == 1 && dfa_len == 2,
+			"<\\w+> should match <_a>"
+		);
+	}
+	ec_regex_free(dfa);
+
+	/* the ranges are supported in a UTF-8 locale sorted by code point */
+	if (setlocale(LC_ALL, "C.UTF-8") != NULL) {
+		for (i = 0; i < EC_COUNT_OF(utf8_patterns); i++) {
+			dfa = ec_regex(utf8_patterns[i], 0);
+			posix = ec_regex(utf8_patterns[i], EC_REGEX_POSIX);
+			if (dfa == NULL || posix == NULL) {
+				EC_TEST_ERR("cannot compile <%s>", utf8_patterns[i]);
+				ec_regex_free(dfa);
+				ec_regex_free(posix);
+				testres = -1;
+				continue;
+			}
+			testres |= EC_TEST_CHECK(
+				!strcmp(ec_regex_backend(dfa), "dfa"),
+				"<%s> should use the dfa backend in C.UTF-8",
+				utf8_patterns[i]
+			);
+			for (j = 0; j < EC_COUNT_OF(utf8_strings); j++) {
+				dfa_ret = ec_regex_match(dfa, utf8_strings[j]);
+				posix_ret = ec_regex_match(posix, utf8_strings[j]);
+				testres |= EC_TEST_CHECK(
+					dfa_ret == posix_ret,
+					"<%s> matching <%s> in C.UTF-8: dfa=%d posix=%d",
+					utf8_patterns[i],
+					utf8_strings[j],
+					dfa_ret,
+					posix_ret
+				);
+			}
+			ec_regex_free(dfa);
+			ec_regex_free(posix);
+		}
+		setlocale(LC_ALL, "C");
+	}
+
+	/* invalid expressions */
+	dfa = ec_regex("a[", 0);
+	testres |= EC_TEST_CHECK(dfa == NULL && errno == EINVAL, "<a[> should be invalid");
+	ec_regex_free(dfa);
+	dfa = ec_regex("a{3,2}", 0);
+	testres |= EC_TEST_CHECK(dfa == NULL && errno == EINVAL, "<a{3,2}> should be invalid");
+	ec_regex_free(dfa);
+
+	return testres;
+}
@@ -3,6 +3,7 @@
  */
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,8 +19,10 @@ EC_TEST_MAIN()
 	FILE *f = NULL;
 	char *buf = NULL;
 	size_t buflen = 0;
+	struct ec_strvec_sh_lexer *lexer = NULL;
+	const char *line = "ab  'c d'e\\ f \"g\\\"h\" # x\n i\\  ";
 	int testres = 0;
-	char quote;
+	char quote, quote2;
 
 	strvec = ec_strvec();
 	if (strvec == NULL) {
@@ -167,6 +170,42 @@ EC_TEST_MAIN()
 
 	ec_strvec_free(strvec);
 
+	/* growth, and elements of a pool outliving their vector */
+	strvec = ec_strvec();
+	if (strvec == NULL || ec_strvec_reserve(strvec, 10) < 0) {
+		EC_TEST_ERR("cannot reserve strvec\n");
+		goto fail;
+	}
+	for (unsigned i = 0; i < 1000; i++) {
+		char str[16];
+		snprintf(str, sizeof(str), "%u", i);
+		if (ec_strvec_add(strvec, str) < 0) {
+			EC_TEST_ERR("cannot add (%u) in strvec\n", i);
+			goto fail;
+		}
+	}
+	testres |= EC_TEST_CHECK(
+		ec_strvec_len(strvec) == 1000 && !strcmp(ec_strvec_val(strvec, 999), "999"),
+		"bad strvec after growth\n"
+	);
+	ec_strvec_free(strvec);
+	strvec = EC_STRVEC("x", "", "yz");
+	if (strvec == NULL) {
+		EC_TEST_ERR("cannot create strvec from array\n");
+		goto fail;
+	}
+	strvec2 = ec_strvec_ndup(strvec, 1, 2);
+	ec_strvec_free(strvec);
+	strvec = NULL;
+	testres |= EC_TEST_CHECK(
+		strvec2 != NULL && ec_strvec_len(strvec2) == 2
+			&& !strcmp(ec_strvec_val(strvec2, 0), "")
+			&& !strcmp(ec_strvec_val(strvec2, 1), "yz"),
+		"bad strvec2 after freeing strvec\n"
+	);
+	ec_strvec_free(strvec2);
+	strvec2 = NULL;
+
 	strvec = EC_STRVEC("e", "a", "f", "d", "b", "c");
 	if (strvec == NULL) {
 		EC_TEST_ERR("cannot create strvec from array\n");
@@ -198,6 +237,48 @@ EC_TEST_MAIN()
 	}
 	testres |= EC_TEST_CHECK(ec_dict_has_key(const_attrs, "key"), "cannot get attrs key\n");
 
+	/* kinds and spans are copied on write */
+	if (ec_strvec_set_kind(strvec, 0, 3) < 0 || ec_strvec_set_span(strvec, 0, 4, 5) < 0) {
+		EC_TEST_ERR("cannot set kind or span\n");
+		goto fail;
+	}
+	strvec2 = ec_strvec_dup(strvec);
+	if (strvec2 == NULL) {
+		EC_TEST_ERR("cannot duplicate strvec\n");
+		goto fail;
+	}
+	if (ec_strvec_set_kind(strvec2, 0, 4) < 0 || ec_strvec_set_span(strvec2, 0, 6, 7) < 0) {
+		EC_TEST_ERR("cannot set kind or span\n");
+		goto fail;
+	}
+	size_t start = 0, end = 0;
+	testres |= EC_TEST_CHECK(
+		ec_strvec_get_kind(strvec, 0) == 3 && ec_strvec_get_kind(strvec2, 0) == 4,
+		"bad kinds\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_strvec_get_span(strvec, 0, &start, &end) == 0 && start == 4 && end == 5,
+		"bad span\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_strvec_get_span(strvec2, 0, &start, &end) == 0 && start == 6 && end == 7,
+		"bad span of the copy\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_dict_has_key(ec_strvec_get_attrs(strvec2, 0), "key"), "attrs should be kept\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_strvec_get_kind(strvec, 1) == 0 && ec_strvec_get_span(strvec, 1, NULL, NULL) < 0
+			&& errno == ENOENT,
+		"token 1 should have no kind and no span\n"
+	);
+	testres |= EC_TEST_CHECK(
+		ec_strvec_set_span(strvec, 1, 2, 1) < 0 && errno == EINVAL,
+		"span should be invalid\n"
+	);
+	ec_strvec_free(strvec2);
+	strvec2 = NULL;
+
 	strvec2 = EC_STRVEC("a", "b", "c", "d", "e", "f");
 	if (strvec2 == NULL) {
 		EC_TEST_ERR("cannot create strvec from array\n");
@@ -244,14 +325,20 @@ EC_TEST_MAIN()
 		ec_strvec_cmp(strvec, strvec2) == 0, "strvec and strvec2 should be equal\n"
 	);
 	for (unsigned i = 0; i < ec_strvec_len(strvec); i++) {
-		const_attrs = ec_strvec_get_attrs(strvec, i);
-		testres |= EC_TEST_CHECK(const_attrs != NULL, "attrs should not be NULL\n");
-		if (const_attrs == NULL)
-			continue;
-		errno = 0;
-		unsigned s = (uintptr_t)ec_dict_get(const_attrs, EC_STRVEC_ATTR_START);
-		unsigned e = (uintptr_t)ec_dict_get(const_attrs, EC_STRVEC_ATTR_END);
-		testres |= EC_TEST_CHECK(errno == 0, "");
+		const struct ec_dict *attrs = ec_strvec_get_attrs(strvec, i);
+		size_t s = 0, e = 0;
+		testres |= EC_TEST_CHECK(
+			ec_strvec_get_span(strvec, i, &s, &e) == 0,
+			"token %u should have a span\n",
+			i
+		);
+		/* deprecated attributes */
+		testres |= EC_TEST_CHECK(
+			attrs != NULL && (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_START) == s
+				&& (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_END) == e,
+			"token %u should have start and end attributes\n",
+			i
+		);
 		switch (i) {
 		case 0:
 			testres |= EC_TEST_CHECK(s == 2 && e == 3, "");
@@ -362,6 +449,80 @@ EC_TEST_MAIN()
 	ec_strvec_free(strvec2);
 	strvec2 = NULL;
 
+	/* the quote may be opened in the middle of a token */
+	quote = '\0';
+	strvec = ec_strvec_sh_lex_str("a b\"c", EC_STRVEC_TRAILSP, &quote);
+	testres |= EC_TEST_CHECK(strvec != NULL && quote == '"', "missing quote should be \"\n");
+	ec_strvec_free(strvec);
+	strvec = NULL;
+
+	/* tokens have no length limit */
+	buf = malloc(20001);
+	if (buf == NULL)
+		goto fail;
+	memset(buf, 'x', 20000);
+	buf[20000] = '\0';
+	strvec = ec_strvec_sh_lex_str(buf, EC_STRVEC_STRICT, NULL);
+	testres |= EC_TEST_CHECK(
+		strvec != NULL && ec_strvec_len(strvec) == 1
+			&& strlen(ec_strvec_val(strvec, 0)) == 20000,
+		"cannot lex a long token\n"
+	);
+	ec_strvec_free(strvec);
+	strvec = NULL;
+
+	/* the incremental lexer gives the same result for each prefix of a line */
+	lexer = ec_strvec_sh_lexer();
+	if (lexer == NULL) {
+		EC_TEST_ERR("cannot create lexer\n");
+		goto fail;
+	}
+	for (size_t n = 0; n <= strlen(line); n++) {
+		memcpy(buf, line, n);
+		buf[n] = '\0';
+		quote = quote2 = '\0';
+		strvec = ec_strvec_sh_lex_resume(lexer, buf, EC_STRVEC_TRAILSP, &quote);
+		strvec2 = ec_strvec_sh_lex_str(buf, EC_STRVEC_TRAILSP, &quote2);
+		if (strvec == NULL || strvec2 == NULL) {
+			EC_TEST_ERR("cannot lex <%s>\n", buf);
+			goto fail;
+		}
+		testres |= EC_TEST_CHECK(
+			ec_strvec_cmp(strvec, strvec2) == 0 && quote == quote2,
+			"bad incremental lexing of <%s>\n",
+			buf
+		);
+		for (unsigned i = 0; i < ec_strvec_len(strvec) && i < ec_strvec_len(strvec2); i++) {
+			size_t s = 0, e = 0, s2 = 1, e2 = 1;
+			ec_strvec_get_span(strvec, i, &s, &e);
+			ec_strvec_get_span(strvec2, i, &s2, &e2);
+			testres |= EC_TEST_CHECK(
+				s == s2 && e == e2,
+				"bad span of token %u of <%s>\n",
+				i,
+				buf
+			);
+		}
+		ec_strvec_free(strvec);
+		strvec = NULL;
+		ec_strvec_free(strvec2);
+		strvec2 = NULL;
+	}
+
+	/* a line that does not extend the previous one is read again */
+	strvec = ec_strvec_sh_lex_resume(lexer, "x y", EC_STRVEC_STRICT, NULL);
+	strvec2 = EC_STRVEC("x", "y");
+	testres |= EC_TEST_CHECK(
+		strvec != NULL && strvec2 != NULL && ec_strvec_cmp(strvec, strvec2) == 0,
+		"bad lexing after reset\n"
+	);
+	ec_strvec_free(strvec);
+	strvec = NULL;
+	ec_strvec_free(strvec2);
+	strvec2 = NULL;
+	ec_strvec_sh_lexer_free(lexer);
+	free(buf);
+
 	return testres;
 
 fail:
@@ -370,6 +531,7 @@ fail:
 	ec_dict_free(attrs);
 	ec_strvec_free(strvec);
 	ec_strvec_free(strvec2);
+	ec_strvec_sh_lexer_free(lexer);
 	free(buf);
 
 	return -1;
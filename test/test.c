@@ -10,12 +10,20 @@
 
 EC_LOG_TYPE_REGISTER(test);
 
+/* parse options that must not change the result */
+static const ec_parse_flag_t parse_flags[] = {
+	EC_PARSE_MEMO,
+	EC_PARSE_ARENA,
+	EC_PARSE_MEMO | EC_PARSE_ARENA,
+};
+
 int ec_test_check_parse(struct ec_node *tk, int expected, ...)
 {
-	struct ec_pnode *p;
+	struct ec_pnode *p, *p_flags;
 	struct ec_strvec *vec = NULL;
 	const char *s;
-	int ret = -1, match;
+	int ret = -1, match, match_flags;
+	size_t i;
 	va_list ap;
 
 	va_start(ap, expected);
@@ -52,6 +60,34 @@ int ec_test_check_parse(struct ec_node *tk, int expected, ...)
 
 	ec_pnode_free(p);
 
+	for (i = 0; i < EC_COUNT_OF(parse_flags); i++) {
+		p_flags = ec_parse_strvec_flags(tk, vec, parse_flags[i]);
+		if (ec_pnode_matches(p_flags))
+			match_flags = ec_pnode_len(p_flags);
+		else
+			match_flags = -1;
+		if (match_flags != match) {
+			EC_LOG(EC_LOG_ERR,
+			       "parse len with flags 0x%x (%d) does not match (%d)\n",
+			       parse_flags[i],
+			       match_flags,
+			       match);
+			ret = -1;
+		}
+		ec_pnode_free(p_flags);
+	}
+
+	match_flags = ec_parse_matches(tk, vec);
+	if (match_flags == EC_PARSE_NOMATCH)
+		match_flags = -1;
+	if (match_flags != match) {
+		EC_LOG(EC_LOG_ERR,
+		       "match len (%d) does not match parse len (%d)\n",
+		       match_flags,
+		       match);
+		ret = -1;
+	}
+
 out:
 	ec_strvec_free(vec);
 	va_end(ap);
@@ -60,10 +96,11 @@ out:
 
 int ec_test_check_complete(struct ec_node *tk, enum ec_comp_type type, ...)
 {
-	struct ec_comp *c = NULL;
+	struct ec_comp *c = NULL, *c_flags = NULL;
 	struct ec_strvec *vec = NULL;
 	const char *s;
 	int ret = 0;
+	size_t i;
 	size_t count = 0;
 	va_list ap;
 
@@ -122,8 +159,27 @@ int ec_test_check_complete(struct ec_node *tk, enum ec_comp_type type, ...)
 		ret = -1;
 	}
 
+	for (i = 0; i < EC_COUNT_OF(parse_flags); i++) {
+		c_flags = ec_complete_strvec_flags(tk, vec, parse_flags[i]);
+		if (c_flags == NULL) {
+			ret = -1;
+			goto out;
+		}
+		if (ec_comp_count(c_flags, EC_COMP_ALL) != ec_comp_count(c, EC_COMP_ALL)) {
+			EC_LOG(EC_LOG_ERR,
+			       "nb_completion with flags 0x%x (%zu) does not match (%zu)\n",
+			       parse_flags[i],
+			       ec_comp_count(c_flags, EC_COMP_ALL),
+			       ec_comp_count(c, EC_COMP_ALL));
+			ret = -1;
+		}
+		ec_comp_free(c_flags);
+		c_flags = NULL;
+	}
+
 out:
 	ec_strvec_free(vec);
+	ec_comp_free(c_flags);
 	ec_comp_free(c);
 	va_end(ap);
 	return ret;
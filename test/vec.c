@@ -264,6 +264,43 @@ EC_TEST_MAIN()
 	ec_vec_free(vec);
 	vec = NULL;
 
+	/* bulk add, growth and in-place access */
+	vec = ec_vec(sizeof(val32), 2, NULL, NULL);
+	if (vec == NULL)
+		GOTO_FAIL;
+	if (ec_vec_data(vec) != NULL)
+		GOTO_FAIL;
+	if (ec_vec_add_array(vec, (uint32_t[]) {0, 1, 2}, 3) < 0)
+		GOTO_FAIL;
+	for (val32 = 3; val32 < 1000; val32++) {
+		if (ec_vec_add_u32(vec, val32) < 0)
+			GOTO_FAIL;
+	}
+	if (ec_vec_len(vec) != 1000)
+		GOTO_FAIL;
+	if (ec_vec_reserve(vec, 2000) < 0 || ec_vec_shrink(vec) < 0)
+		GOTO_FAIL;
+	if (ec_vec_add_array(vec, NULL, 1) == 0)
+		GOTO_FAIL;
+
+	uint32_t *p32;
+	val32 = 0;
+	EC_VEC_FOREACH(p32, vec) {
+		if (*p32 != val32)
+			GOTO_FAIL;
+		val32++;
+	}
+	if (val32 != 1000)
+		GOTO_FAIL;
+	p32 = ec_vec_data(vec);
+	if (p32 == NULL || p32[999] != 999 || ec_vec_at(vec, 999) != &p32[999])
+		GOTO_FAIL;
+	if (ec_vec_at(vec, 1000) != NULL)
+		GOTO_FAIL;
+
+	ec_vec_free(vec);
+	vec = NULL;
+
 	/* invalid args */
 	vec = ec_vec(0, 0, NULL, NULL);
 	if (vec != NULL)
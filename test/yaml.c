@@ -7,6 +7,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "grammar.h"
 #include "test.h"
 
 /*
@@ -20,12 +21,22 @@
 
 EC_TEST_MAIN()
 {
+	struct ec_test_grammar_params params = {
+		.seed = 1,
+		.n_cmds = 50,
+		.width = 3,
+		.depth = 3,
+		.flags = EC_TEST_GRAMMAR_CMD,
+	};
 	struct ec_node *node1 = NULL, *node2 = NULL;
 	struct ec_pnode *p1 = NULL, *p2 = NULL;
 	char tmpfile[] = "/tmp/ecoli_yaml_test_XXXXXX";
+	char tmpfile2[] = "/tmp/ecoli_yaml_test_XXXXXX";
+	struct ec_strvec *lines = NULL;
 	FILE *fp = NULL;
 	int fd = -1;
 	int testres = 0;
+	size_t i;
 
 	/* Test 1: export/import roundtrip */
 
@@ -111,5 +122,52 @@ EC_TEST_MAIN()
 		ec_yaml_export(NULL, NULL) < 0, "export should fail with NULL arguments"
 	);
 
+	/* Test 3: export/import roundtrip of a generated grammar */
+	lines = ec_strvec();
+	if (lines == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create strvec\n");
+		return -1;
+	}
+	node1 = ec_test_grammar(&params, lines);
+	if (node1 == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot generate grammar\n");
+		ec_strvec_free(lines);
+		return -1;
+	}
+
+	fd = mkstemp(tmpfile2);
+	fp = fd < 0 ? NULL : fdopen(fd, "w");
+	if (fp == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create temp file\n");
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmpfile2);
+		}
+		ec_node_free(node1);
+		ec_strvec_free(lines);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK(ec_yaml_export(fp, node1) == 0, "cannot export grammar");
+	fclose(fp);
+
+	node2 = ec_yaml_import(tmpfile2);
+	unlink(tmpfile2);
+	testres |= EC_TEST_CHECK(node2 != NULL, "cannot re-import generated grammar");
+	node2 = ec_node_sh_lex(EC_NO_ID, node2);
+
+	for (i = 0; node2 != NULL && i < ec_strvec_len(lines); i++) {
+		p2 = ec_parse(node2, ec_strvec_val(lines, i));
+		testres |= EC_TEST_CHECK(
+			p2 != NULL && ec_pnode_matches(p2),
+			"node2 should match '%s'",
+			ec_strvec_val(lines, i)
+		);
+		ec_pnode_free(p2);
+	}
+
+	ec_node_free(node1);
+	ec_node_free(node2);
+	ec_strvec_free(lines);
+
 	return testres;
 }